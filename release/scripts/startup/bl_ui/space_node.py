@@ -387,6 +387,9 @@ class NODE_MT_view(Menu):
         layout.prop(snode, "show_region_toolbar")
         layout.prop(snode, "show_region_ui")
 
+        if snode.tree_type == 'GeometryNodeTree':
+            layout.prop(snode, "show_timing")
+
         layout.separator()
 
         sub = layout.column()
@@ -838,6 +841,9 @@ class NODE_PT_quality(bpy.types.Panel):
         col = layout.column()
         if prefs.experimental.use_full_frame_compositor:
             col.prop(tree, "execution_mode")
+            if tree.execution_mode == 'FULL_FRAME':
+                col.prop(tree, "memory_limit")
+                col.prop(tree, "use_result_cache")
 
         col.prop(tree, "render_quality", text="Render")
         col.prop(tree, "edit_quality", text="Edit")
@@ -117,6 +117,8 @@ enum ePF_FileCompare BKE_packedfile_compare_to_file(const char *ref_file_name,
                                                     struct PackedFile *pf);
 
 /* read */
+bool BKE_packedfile_ensure_data(struct PackedFile *pf);
+bool BKE_packedfile_ensure_data_all(struct Main *bmain, struct ReportList *reports);
 int BKE_packedfile_seek(struct PackedFile *pf, int offset, int whence);
 void BKE_packedfile_rewind(struct PackedFile *pf);
 int BKE_packedfile_read(struct PackedFile *pf, void *data, int size);
@@ -23,6 +23,8 @@
 #include "BKE_pointcloud.h"
 #include "BKE_spline.hh"
 
+#include "BLI_task.hh"
+
 #include "DNA_collection_types.h"
 #include "DNA_layer_types.h"
 #include "DNA_mesh_types.h"
@@ -141,10 +143,23 @@ static void geometry_set_collect_recursive(const GeometrySet &geometry_set,
     Span<float4x4> transforms = instances_component.instance_transforms();
     Span<int> handles = instances_component.instance_reference_handles();
     Span<InstanceReference> references = instances_component.references();
+
+    /* Consecutive instances of the same reference without nested instances are added to the same
+     * group, to avoid creating a group for every single instance. Only consecutive instances are
+     * merged, so that the order of the realized elements does not change. */
+    int previous_handle = -1;
+    int64_t previous_group_index = -1;
+
     for (const int i : transforms.index_range()) {
       const InstanceReference &reference = references[handles[i]];
       const float4x4 instance_transform = transform * transforms[i];
 
+      if (handles[i] == previous_handle) {
+        r_sets[previous_group_index].transforms.append(instance_transform);
+        continue;
+      }
+      const int64_t groups_num_before = r_sets.size();
+
       switch (reference.type()) {
         case InstanceReference::Type::Object: {
           Object &object = reference.object();
@@ -166,6 +181,14 @@ static void geometry_set_collect_recursive(const GeometrySet &geometry_set,
           break;
         }
       }
+
+      if (r_sets.size() == groups_num_before + 1 && !r_sets.last().geometry_set.has_instances()) {
+        previous_handle = handles[i];
+        previous_group_index = r_sets.size() - 1;
+      }
+      else {
+        previous_handle = -1;
+      }
     }
   }
 }
@@ -224,6 +247,22 @@ void geometry_set_gather_instances_attribute_info(Span<GeometryInstanceGroup> se
   }
 }
 
+/**
+ * Grain size for parallel loops over instances, so that every task copies enough elements to make
+ * the overhead of the task negligible.
+ */
+static int64_t instances_grain_size(const int64_t elements_per_instance)
+{
+  return std::max<int64_t>(1, 4096 / std::max<int64_t>(1, elements_per_instance));
+}
+
+struct MeshElementOffsets {
+  int vert = 0;
+  int edge = 0;
+  int loop = 0;
+  int poly = 0;
+};
+
 static Mesh *join_mesh_topology_and_builtin_attributes(Span<GeometryInstanceGroup> set_groups,
                                                        const bool convert_points_to_vertices)
 {
@@ -231,15 +270,19 @@ static Mesh *join_mesh_topology_and_builtin_attributes(Span<GeometryInstanceGrou
   int totloops = 0;
   int totedges = 0;
   int totpolys = 0;
+  /* Where the elements of every group start in the new mesh. */
+  Array<MeshElementOffsets> group_offsets(set_groups.size());
   int64_t cd_dirty_vert = 0;
   int64_t cd_dirty_poly = 0;
   int64_t cd_dirty_edge = 0;
   int64_t cd_dirty_loop = 0;
   VectorSet<Material *> materials;
 
-  for (const GeometryInstanceGroup &set_group : set_groups) {
+  for (const int group_index : set_groups.index_range()) {
+    const GeometryInstanceGroup &set_group = set_groups[group_index];
     const GeometrySet &set = set_group.geometry_set;
     const int tot_transforms = set_group.transforms.size();
+    group_offsets[group_index] = {totverts, totedges, totloops, totpolys};
     if (set.has_mesh()) {
       const Mesh &mesh = *set.get_mesh_for_read();
       totverts += mesh.totvert * tot_transforms;
@@ -285,85 +328,103 @@ static Mesh *join_mesh_topology_and_builtin_attributes(Span<GeometryInstanceGrou
   new_mesh->runtime.cd_dirty_edge = cd_dirty_edge;
   new_mesh->runtime.cd_dirty_loop = cd_dirty_loop;
 
-  int vert_offset = 0;
-  int loop_offset = 0;
-  int edge_offset = 0;
-  int poly_offset = 0;
-  for (const GeometryInstanceGroup &set_group : set_groups) {
-    const GeometrySet &set = set_group.geometry_set;
-    if (set.has_mesh()) {
-      const Mesh &mesh = *set.get_mesh_for_read();
-
-      Array<int> material_index_map(mesh.totcol);
-      for (const int i : IndexRange(mesh.totcol)) {
-        Material *material = mesh.mat[i];
-        const int new_material_index = materials.index_of(material);
-        material_index_map[i] = new_material_index;
-      }
-
-      for (const float4x4 &transform : set_group.transforms) {
-        for (const int i : IndexRange(mesh.totvert)) {
-          const MVert &old_vert = mesh.mvert[i];
-          MVert &new_vert = new_mesh->mvert[vert_offset + i];
+  const float3 point_normal{0.0f, 0.0f, 1.0f};
+  short point_normal_short[3];
+  normal_float_to_short_v3(point_normal_short, point_normal);
 
-          new_vert = old_vert;
-
-          const float3 new_position = transform * float3(old_vert.co);
-          copy_v3_v3(new_vert.co, new_position);
-        }
-        for (const int i : IndexRange(mesh.totedge)) {
-          const MEdge &old_edge = mesh.medge[i];
-          MEdge &new_edge = new_mesh->medge[edge_offset + i];
-          new_edge = old_edge;
-          new_edge.v1 += vert_offset;
-          new_edge.v2 += vert_offset;
-        }
-        for (const int i : IndexRange(mesh.totloop)) {
-          const MLoop &old_loop = mesh.mloop[i];
-          MLoop &new_loop = new_mesh->mloop[loop_offset + i];
-          new_loop = old_loop;
-          new_loop.v += vert_offset;
-          new_loop.e += edge_offset;
-        }
-        for (const int i : IndexRange(mesh.totpoly)) {
-          const MPoly &old_poly = mesh.mpoly[i];
-          MPoly &new_poly = new_mesh->mpoly[poly_offset + i];
-          new_poly = old_poly;
-          new_poly.loopstart += loop_offset;
-          if (old_poly.mat_nr >= 0 && old_poly.mat_nr < mesh.totcol) {
-            new_poly.mat_nr = material_index_map[new_poly.mat_nr];
-          }
-          else {
-            /* The material index was invalid before. */
-            new_poly.mat_nr = 0;
-          }
+  /* All offsets are known, so every instance can be copied independently. */
+  threading::parallel_for(set_groups.index_range(), 1, [&](IndexRange groups_range) {
+    for (const int group_index : groups_range) {
+      const GeometryInstanceGroup &set_group = set_groups[group_index];
+      const GeometrySet &set = set_group.geometry_set;
+      const MeshElementOffsets &offsets = group_offsets[group_index];
+      int points_vert_offset = offsets.vert;
+
+      if (set.has_mesh()) {
+        const Mesh &mesh = *set.get_mesh_for_read();
+        points_vert_offset += mesh.totvert * set_group.transforms.size();
+
+        Array<int> material_index_map(mesh.totcol);
+        for (const int i : IndexRange(mesh.totcol)) {
+          Material *material = mesh.mat[i];
+          const int new_material_index = materials.index_of(material);
+          material_index_map[i] = new_material_index;
         }
 
-        vert_offset += mesh.totvert;
-        loop_offset += mesh.totloop;
-        edge_offset += mesh.totedge;
-        poly_offset += mesh.totpoly;
+        const int64_t elements_per_instance = mesh.totvert + mesh.totedge + mesh.totloop +
+                                              mesh.totpoly;
+        threading::parallel_for(
+            set_group.transforms.index_range(),
+            instances_grain_size(elements_per_instance),
+            [&](IndexRange transforms_range) {
+              for (const int transform_index : transforms_range) {
+                const float4x4 &transform = set_group.transforms[transform_index];
+                const int vert_offset = offsets.vert + transform_index * mesh.totvert;
+                const int edge_offset = offsets.edge + transform_index * mesh.totedge;
+                const int loop_offset = offsets.loop + transform_index * mesh.totloop;
+                const int poly_offset = offsets.poly + transform_index * mesh.totpoly;
+
+                for (const int i : IndexRange(mesh.totvert)) {
+                  const MVert &old_vert = mesh.mvert[i];
+                  MVert &new_vert = new_mesh->mvert[vert_offset + i];
+
+                  new_vert = old_vert;
+
+                  const float3 new_position = transform * float3(old_vert.co);
+                  copy_v3_v3(new_vert.co, new_position);
+                }
+                for (const int i : IndexRange(mesh.totedge)) {
+                  const MEdge &old_edge = mesh.medge[i];
+                  MEdge &new_edge = new_mesh->medge[edge_offset + i];
+                  new_edge = old_edge;
+                  new_edge.v1 += vert_offset;
+                  new_edge.v2 += vert_offset;
+                }
+                for (const int i : IndexRange(mesh.totloop)) {
+                  const MLoop &old_loop = mesh.mloop[i];
+                  MLoop &new_loop = new_mesh->mloop[loop_offset + i];
+                  new_loop = old_loop;
+                  new_loop.v += vert_offset;
+                  new_loop.e += edge_offset;
+                }
+                for (const int i : IndexRange(mesh.totpoly)) {
+                  const MPoly &old_poly = mesh.mpoly[i];
+                  MPoly &new_poly = new_mesh->mpoly[poly_offset + i];
+                  new_poly = old_poly;
+                  new_poly.loopstart += loop_offset;
+                  if (old_poly.mat_nr >= 0 && old_poly.mat_nr < mesh.totcol) {
+                    new_poly.mat_nr = material_index_map[new_poly.mat_nr];
+                  }
+                  else {
+                    /* The material index was invalid before. */
+                    new_poly.mat_nr = 0;
+                  }
+                }
+              }
+            });
       }
-    }
-
-    const float3 point_normal{0.0f, 0.0f, 1.0f};
-    short point_normal_short[3];
-    normal_float_to_short_v3(point_normal_short, point_normal);
 
-    if (convert_points_to_vertices && set.has_pointcloud()) {
-      const PointCloud &pointcloud = *set.get_pointcloud_for_read();
-      for (const float4x4 &transform : set_group.transforms) {
-        for (const int i : IndexRange(pointcloud.totpoint)) {
-          MVert &new_vert = new_mesh->mvert[vert_offset + i];
-          const float3 old_position = pointcloud.co[i];
-          const float3 new_position = transform * old_position;
-          copy_v3_v3(new_vert.co, new_position);
-          memcpy(&new_vert.no, point_normal_short, sizeof(point_normal_short));
-        }
-        vert_offset += pointcloud.totpoint;
+      if (convert_points_to_vertices && set.has_pointcloud()) {
+        const PointCloud &pointcloud = *set.get_pointcloud_for_read();
+        threading::parallel_for(
+            set_group.transforms.index_range(),
+            instances_grain_size(pointcloud.totpoint),
+            [&](IndexRange transforms_range) {
+              for (const int transform_index : transforms_range) {
+                const float4x4 &transform = set_group.transforms[transform_index];
+                const int vert_offset = points_vert_offset + transform_index * pointcloud.totpoint;
+                for (const int i : IndexRange(pointcloud.totpoint)) {
+                  MVert &new_vert = new_mesh->mvert[vert_offset + i];
+                  const float3 old_position = pointcloud.co[i];
+                  const float3 new_position = transform * old_position;
+                  copy_v3_v3(new_vert.co, new_position);
+                  memcpy(&new_vert.no, point_normal_short, sizeof(point_normal_short));
+                }
+              }
+            });
       }
     }
-  }
+  });
 
   /* A possible optimization is to only tag the normals dirty when there are transforms that change
    * normals. */
@@ -394,34 +455,57 @@ static void join_attributes(Span<GeometryInstanceGroup> set_groups,
 
     fn::GVMutableArray_GSpan dst_span{*write_attribute.varray};
 
+    /* Compute where the values of every group start, so that the groups can be copied in
+     * parallel. */
+    Array<int> group_offsets(set_groups.size());
     int offset = 0;
-    for (const GeometryInstanceGroup &set_group : set_groups) {
+    for (const int group_index : set_groups.index_range()) {
+      const GeometryInstanceGroup &set_group = set_groups[group_index];
       const GeometrySet &set = set_group.geometry_set;
+      group_offsets[group_index] = offset;
       for (const GeometryComponentType component_type : component_types) {
         if (set.has(component_type)) {
+          const GeometryComponent &component = *set.get_component_for_read(component_type);
+          offset += component.attribute_domain_size(domain_output) * set_group.transforms.size();
+        }
+      }
+    }
+
+    threading::parallel_for(set_groups.index_range(), 1, [&](IndexRange groups_range) {
+      for (const int group_index : groups_range) {
+        const GeometryInstanceGroup &set_group = set_groups[group_index];
+        const GeometrySet &set = set_group.geometry_set;
+        int component_offset = group_offsets[group_index];
+        for (const GeometryComponentType component_type : component_types) {
+          if (!set.has(component_type)) {
+            continue;
+          }
           const GeometryComponent &component = *set.get_component_for_read(component_type);
           const int domain_size = component.attribute_domain_size(domain_output);
           if (domain_size == 0) {
             continue; /* Domain size is 0, so no need to increment the offset. */
           }
+          const int start_offset = component_offset;
+          component_offset += domain_size * set_group.transforms.size();
+
           GVArrayPtr source_attribute = component.attribute_try_get_for_read(
               attribute_id, domain_output, data_type_output);
-
-          if (source_attribute) {
-            fn::GVArray_GSpan src_span{*source_attribute};
-            const void *src_buffer = src_span.data();
-            for (const int UNUSED(i) : set_group.transforms.index_range()) {
-              void *dst_buffer = dst_span[offset];
-              cpp_type->copy_assign_n(src_buffer, dst_buffer, domain_size);
-              offset += domain_size;
-            }
-          }
-          else {
-            offset += domain_size * set_group.transforms.size();
+          if (!source_attribute) {
+            continue;
           }
+          fn::GVArray_GSpan src_span{*source_attribute};
+          const void *src_buffer = src_span.data();
+          threading::parallel_for(set_group.transforms.index_range(),
+                                  instances_grain_size(domain_size),
+                                  [&](IndexRange transforms_range) {
+                                    for (const int i : transforms_range) {
+                                      void *dst_buffer = dst_span[start_offset + i * domain_size];
+                                      cpp_type->copy_assign_n(src_buffer, dst_buffer, domain_size);
+                                    }
+                                  });
         }
       }
-    }
+    });
 
     dst_span.save();
   }
@@ -429,13 +513,17 @@ static void join_attributes(Span<GeometryInstanceGroup> set_groups,
 
 static PointCloud *join_pointcloud_position_attribute(Span<GeometryInstanceGroup> set_groups)
 {
-  /* Count the total number of points. */
+  /* Count the total number of points and where the points of every group start. */
   int totpoint = 0;
-  for (const GeometryInstanceGroup &set_group : set_groups) {
+  Array<int> group_offsets(set_groups.size());
+  for (const int group_index : set_groups.index_range()) {
+    const GeometryInstanceGroup &set_group = set_groups[group_index];
     const GeometrySet &set = set_group.geometry_set;
+    group_offsets[group_index] = totpoint;
     if (set.has<PointCloudComponent>()) {
       const PointCloudComponent &component = *set.get_component_for_read<PointCloudComponent>();
-      totpoint += component.attribute_domain_size(ATTR_DOMAIN_POINT);
+      totpoint += component.attribute_domain_size(ATTR_DOMAIN_POINT) *
+                  set_group.transforms.size();
     }
   }
   if (totpoint == 0) {
@@ -446,20 +534,29 @@ static PointCloud *join_pointcloud_position_attribute(Span<GeometryInstanceGroup
   MutableSpan new_positions{(float3 *)new_pointcloud->co, new_pointcloud->totpoint};
 
   /* Transform each instance's point locations into the new point cloud. */
-  int offset = 0;
-  for (const GeometryInstanceGroup &set_group : set_groups) {
-    const GeometrySet &set = set_group.geometry_set;
-    const PointCloud *pointcloud = set.get_pointcloud_for_read();
-    if (pointcloud == nullptr) {
-      continue;
-    }
-    for (const float4x4 &transform : set_group.transforms) {
-      for (const int i : IndexRange(pointcloud->totpoint)) {
-        new_positions[offset + i] = transform * float3(pointcloud->co[i]);
+  threading::parallel_for(set_groups.index_range(), 1, [&](IndexRange groups_range) {
+    for (const int group_index : groups_range) {
+      const GeometryInstanceGroup &set_group = set_groups[group_index];
+      const GeometrySet &set = set_group.geometry_set;
+      const PointCloud *pointcloud = set.get_pointcloud_for_read();
+      if (pointcloud == nullptr) {
+        continue;
       }
-      offset += pointcloud->totpoint;
+      threading::parallel_for(
+          set_group.transforms.index_range(),
+          instances_grain_size(pointcloud->totpoint),
+          [&](IndexRange transforms_range) {
+            for (const int transform_index : transforms_range) {
+              const float4x4 &transform = set_group.transforms[transform_index];
+              const int offset = group_offsets[group_index] +
+                                 transform_index * pointcloud->totpoint;
+              for (const int i : IndexRange(pointcloud->totpoint)) {
+                new_positions[offset + i] = transform * float3(pointcloud->co[i]);
+              }
+            }
+          });
     }
-  }
+  });
 
   return new_pointcloud;
 }
@@ -473,9 +570,11 @@ static CurveEval *join_curve_splines_and_builtin_attributes(Span<GeometryInstanc
       continue;
     }
 
+    /* The splines of every instance have to be next to each other, because that is the order
+     * that is used when joining the attributes. */
     const CurveEval &source_curve = *set.get_curve_for_read();
-    for (const SplinePtr &source_spline : source_curve.splines()) {
-      for (const float4x4 &transform : set_group.transforms) {
+    for (const float4x4 &transform : set_group.transforms) {
+      for (const SplinePtr &source_spline : source_curve.splines()) {
         SplinePtr new_spline = source_spline->copy_without_attributes();
         new_spline->transform(transform);
         new_splines.append(std::move(new_spline));
@@ -33,6 +33,8 @@
 #include "MEM_guardedalloc.h"
 #include <string.h>
 
+#include "CLG_log.h"
+
 #include "DNA_ID.h"
 #include "DNA_image_types.h"
 #include "DNA_packedFile_types.h"
@@ -41,6 +43,7 @@
 #include "DNA_volume_types.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
 #include "BKE_image.h"
@@ -56,6 +59,80 @@
 
 #include "BLO_read_write.h"
 
+static CLG_LogRef LOG = {"bke.packedfile"};
+
+static ThreadMutex packedfile_lazy_data_mutex = BLI_MUTEX_INITIALIZER;
+
+/**
+ * Packed files read with #BLO_READ_LAZY_DATA keep their content in the .blend file
+ * until it is needed. This has to be called before accessing #PackedFile.data,
+ * returns false when the data could not be read.
+ */
+bool BKE_packedfile_ensure_data(PackedFile *pf)
+{
+  if (pf->data != NULL) {
+    return true;
+  }
+  if (pf->lazy_data == NULL) {
+    return false;
+  }
+
+  BLI_mutex_lock(&packedfile_lazy_data_mutex);
+  if (pf->data == NULL && pf->lazy_data != NULL) {
+    void *data = BLO_lazy_data_read(pf->lazy_data);
+    if (data != NULL) {
+      BLO_lazy_data_free(pf->lazy_data);
+      pf->lazy_data = NULL;
+      pf->data = data;
+    }
+  }
+  BLI_mutex_unlock(&packedfile_lazy_data_mutex);
+
+  return pf->data != NULL;
+}
+
+static bool packedfile_ensure_data_report(PackedFile *pf, const ID *id, ReportList *reports)
+{
+  if (pf == NULL || BKE_packedfile_ensure_data(pf)) {
+    return true;
+  }
+  BKE_reportf(reports,
+              RPT_ERROR,
+              "Cannot read packed data of '%s', the file it was loaded from was modified",
+              id->name + 2);
+  return false;
+}
+
+/**
+ * Read the data of all packed files which is still in the .blend file it was loaded from.
+ * Returns false and reports the packed files that could not be read, in that case their data
+ * would be lost when saving.
+ */
+bool BKE_packedfile_ensure_data_all(Main *bmain, ReportList *reports)
+{
+  bool ok = true;
+
+  LISTBASE_FOREACH (Image *, ima, &bmain->images) {
+    LISTBASE_FOREACH (ImagePackedFile *, imapf, &ima->packedfiles) {
+      ok &= packedfile_ensure_data_report(imapf->packedfile, &ima->id, reports);
+    }
+  }
+  LISTBASE_FOREACH (VFont *, vfont, &bmain->fonts) {
+    ok &= packedfile_ensure_data_report(vfont->packedfile, &vfont->id, reports);
+  }
+  LISTBASE_FOREACH (bSound *, sound, &bmain->sounds) {
+    ok &= packedfile_ensure_data_report(sound->packedfile, &sound->id, reports);
+  }
+  LISTBASE_FOREACH (Volume *, volume, &bmain->volumes) {
+    ok &= packedfile_ensure_data_report(volume->packedfile, &volume->id, reports);
+  }
+  LISTBASE_FOREACH (Library *, lib, &bmain->libraries) {
+    ok &= packedfile_ensure_data_report(lib->packedfile, &lib->id, reports);
+  }
+
+  return ok;
+}
+
 int BKE_packedfile_seek(PackedFile *pf, int offset, int whence)
 {
   int oldseek = -1, seek = 0;
@@ -95,7 +172,7 @@ void BKE_packedfile_rewind(PackedFile *pf)
 
 int BKE_packedfile_read(PackedFile *pf, void *data, int size)
 {
-  if ((pf != NULL) && (size >= 0) && (data != NULL)) {
+  if ((pf != NULL) && (size >= 0) && (data != NULL) && BKE_packedfile_ensure_data(pf)) {
     if (size + pf->seek > pf->size) {
       size = pf->size - pf->seek;
     }
@@ -155,9 +232,12 @@ int BKE_packedfile_count_all(Main *bmain)
 void BKE_packedfile_free(PackedFile *pf)
 {
   if (pf) {
-    BLI_assert(pf->data != NULL);
+    BLI_assert(pf->data != NULL || pf->lazy_data != NULL);
 
     MEM_SAFE_FREE(pf->data);
+    if (pf->lazy_data) {
+      BLO_lazy_data_free(pf->lazy_data);
+    }
     MEM_freeN(pf);
   }
   else {
@@ -168,12 +248,16 @@ void BKE_packedfile_free(PackedFile *pf)
 PackedFile *BKE_packedfile_duplicate(const PackedFile *pf_src)
 {
   BLI_assert(pf_src != NULL);
-  BLI_assert(pf_src->data != NULL);
+  BLI_assert(pf_src->data != NULL || pf_src->lazy_data != NULL);
 
   PackedFile *pf_dst;
 
   pf_dst = MEM_dupallocN(pf_src);
-  pf_dst->data = MEM_dupallocN(pf_src->data);
+  /* Copies of data that wasn't read yet stay lazy (e.g. copy-on-write copies). */
+  BLI_mutex_lock(&packedfile_lazy_data_mutex);
+  pf_dst->data = pf_src->data ? MEM_dupallocN(pf_src->data) : NULL;
+  pf_dst->lazy_data = pf_src->lazy_data ? BLO_lazy_data_copy(pf_src->lazy_data) : NULL;
+  BLI_mutex_unlock(&packedfile_lazy_data_mutex);
 
   return pf_dst;
 }
@@ -333,7 +417,9 @@ int BKE_packedfile_write_to_file(ReportList *reports,
   /* make sure the path to the file exists... */
   BLI_make_existing_file(name);
 
-  file = BLI_open(name, O_BINARY + O_WRONLY + O_CREAT + O_TRUNC, 0666);
+  file = BKE_packedfile_ensure_data(pf) ?
+             BLI_open(name, O_BINARY + O_WRONLY + O_CREAT + O_TRUNC, 0666) :
+             -1;
   if (file == -1) {
     BKE_reportf(reports, RPT_ERROR, "Error creating file '%s'", name);
     ret_value = RET_ERROR;
@@ -396,7 +482,7 @@ enum ePF_FileCompare BKE_packedfile_compare_to_file(const char *ref_file_name,
   if (BLI_stat(name, &st) == -1) {
     ret_val = PF_CMP_NOFILE;
   }
-  else if (st.st_size != pf->size) {
+  else if (st.st_size != pf->size || !BKE_packedfile_ensure_data(pf)) {
     ret_val = PF_CMP_DIFFERS;
   }
   else {
@@ -534,7 +620,8 @@ static void unpack_generate_paths(const char *name,
     /* For images we can add the file extension based on the file magic. */
     if (id_type == ID_IM) {
       ImagePackedFile *imapf = ((Image *)id)->packedfiles.last;
-      if (imapf != NULL && imapf->packedfile != NULL) {
+      if (imapf != NULL && imapf->packedfile != NULL &&
+          BKE_packedfile_ensure_data(imapf->packedfile)) {
         const PackedFile *pf = imapf->packedfile;
         enum eImbFileType ftype = IMB_ispic_type_from_memory((const uchar *)pf->data, pf->size);
         if (ftype != IMB_FTYPE_NONE) {
@@ -881,18 +968,54 @@ void BKE_packedfile_blend_write(BlendWriter *writer, PackedFile *pf)
   if (pf == NULL) {
     return;
   }
-  BLO_write_struct(writer, PackedFile, pf);
+  if (BLO_write_is_undo(writer) && pf->data == NULL) {
+    /* Don't read the data for undo steps, the packed file is restored from the current Main
+     * together with its lazy data, see #BKE_packedfile_blend_read. */
+    BLO_write_struct(writer, PackedFile, pf);
+    return;
+  }
+  if (!BKE_packedfile_ensure_data(pf)) {
+    /* Saving is refused before this, see #BKE_packedfile_ensure_data_all. */
+    CLOG_ERROR(&LOG, "Unable to read packed file data, it will not be saved");
+  }
+  /* Clear runtime data. */
+  PackedFile pf_tmp = *pf;
+  pf_tmp.lazy_data = NULL;
+  BLO_write_struct_at_address(writer, PackedFile, pf, &pf_tmp);
   BLO_write_raw(writer, pf->size, pf->data);
 }
 
 void BKE_packedfile_blend_read(BlendDataReader *reader, PackedFile **pf_p)
 {
+  const PackedFile *pf_old = *pf_p;
   BLO_read_packed_address(reader, pf_p);
   PackedFile *pf = *pf_p;
   if (pf == NULL) {
     return;
   }
 
+  if (BLO_read_data_is_undo(reader)) {
+    if (pf == pf_old) {
+      /* Restored from the old Main, including its runtime data. */
+      if (pf->data == NULL) {
+        return;
+      }
+    }
+    else {
+      /* Read from the undo step, the lazy data of packed files that don't exist anymore was
+       * freed with them, such packed files are cleaned up below. */
+      pf->lazy_data = NULL;
+    }
+  }
+  else {
+    pf->lazy_data = BLO_read_lazy_data(reader, pf->data);
+    if (pf->lazy_data != NULL) {
+      /* Data is read on first access, see #BKE_packedfile_ensure_data. */
+      pf->data = NULL;
+      return;
+    }
+  }
+
   BLO_read_packed_address(reader, &pf->data);
   if (pf->data == NULL) {
     /* We cannot allow a PackedFile with a NULL data field,
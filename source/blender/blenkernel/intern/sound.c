@@ -553,7 +553,9 @@ static void sound_load_audio(Main *bmain, bSound *sound, bool free_waveform)
 
     /* but we need a packed file then */
     if (pf) {
-      sound->handle = AUD_Sound_bufferFile((unsigned char *)pf->data, pf->size);
+      if (BKE_packedfile_ensure_data(pf)) {
+        sound->handle = AUD_Sound_bufferFile((unsigned char *)pf->data, pf->size);
+      }
     }
     else {
       /* or else load it from disk */
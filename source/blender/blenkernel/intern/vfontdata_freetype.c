@@ -44,6 +44,7 @@
 #include "BLI_utildefines.h"
 
 #include "BKE_curve.h"
+#include "BKE_packedFile.h"
 #include "BKE_vfontdata.h"
 
 #include "DNA_curve_types.h"
@@ -264,7 +265,7 @@ static VChar *objchr_to_ftvfontdata(VFont *vfont, FT_ULong charcode)
   FT_Face face;
 
   /* Load the font to memory */
-  if (vfont->temp_pf) {
+  if (vfont->temp_pf && BKE_packedfile_ensure_data(vfont->temp_pf)) {
     err = FT_New_Memory_Face(library, vfont->temp_pf->data, vfont->temp_pf->size, 0, &face);
     if (err) {
       return NULL;
@@ -291,6 +292,10 @@ static VFontData *objfnt_to_ftvfontdata(PackedFile *pf)
   FT_UInt glyph_index;
   VFontData *vfd;
 
+  if (!BKE_packedfile_ensure_data(pf)) {
+    return NULL;
+  }
+
   /* load the freetype font */
   err = FT_New_Memory_Face(library, pf->data, pf->size, 0, &face);
 
@@ -377,6 +382,10 @@ static bool check_freetypefont(PackedFile *pf)
   FT_UInt glyph_index = 0;
   bool success = false;
 
+  if (!BKE_packedfile_ensure_data(pf)) {
+    return false;
+  }
+
   err = FT_New_Memory_Face(library, pf->data, pf->size, 0, &face);
   if (err) {
     return false;
@@ -28,9 +28,34 @@
 #include "BLI_endian_switch.h"
 #include "BLI_filereader.h"
 #include "BLI_math_base.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
 
 #include "MEM_guardedalloc.h"
 
+/* Upper limit for the number of frames that are decoded ahead of the read position.
+ * Frames written by Blender are ~1mb each, so this bounds the extra memory use. */
+#define ZSTD_PREFETCH_MAX_FRAMES 16
+
+typedef enum eZstdSlotState {
+  /** Slot holds no frame and can be reused. */
+  ZSTD_SLOT_FREE = 0,
+  /** A prefetch task was pushed for the frame, but did not start decoding yet. */
+  ZSTD_SLOT_QUEUED,
+  /** The frame is being decoded, either by a prefetch task or by the reading thread. */
+  ZSTD_SLOT_RUNNING,
+  /** The frame is decoded and its content can be read. */
+  ZSTD_SLOT_READY,
+  /** Reading or decoding the frame failed. */
+  ZSTD_SLOT_FAILED,
+} eZstdSlotState;
+
+typedef struct ZstdFrameSlot {
+  int frame;
+  eZstdSlotState state;
+  char *content;
+} ZstdFrameSlot;
+
 typedef struct {
   FileReader reader;
 
@@ -45,9 +70,24 @@ typedef struct {
     size_t *compressed_ofs;
     size_t *uncompressed_ofs;
 
-    char *cached_content;
-    int cached_frame;
+    /* Decoded frames: the one currently being read plus the ones prefetched ahead of it. */
+    ZstdFrameSlot *slots;
+    int num_slots;
+    /* Last frame that was requested, used to detect sequential reading. */
+    int last_frame;
   } seek;
+
+  /* Parallel decoding of the frames following the read position, only used when
+   * the seek table is available and more than one thread can be used. */
+  struct {
+    TaskPool *pool;
+    /* Protects the slot states. */
+    ThreadMutex mutex;
+    /* Signaled whenever a slot finished decoding. */
+    ThreadCondition condition;
+    /* Serializes access to the base reader. */
+    ThreadMutex io_mutex;
+  } prefetch;
 } ZstdReader;
 
 static bool zstd_read_u32(FileReader *base, uint32_t *val)
@@ -142,7 +182,7 @@ static bool zstd_read_seek_table(ZstdReader *zstd)
     return false;
   }
 
-  zstd->seek.cached_frame = -1;
+  zstd->seek.last_frame = -1;
 
   return true;
 }
@@ -170,43 +210,215 @@ static int zstd_frame_from_pos(ZstdReader *zstd, size_t pos)
   return low;
 }
 
-/* Ensure that the currently loaded frame is the correct one. */
-static const char *zstd_ensure_cache(ZstdReader *zstd, int frame)
+/* Read the compressed data of the given frame and decode it using `ctx`.
+ * Returns the decoded content or NULL on failure. */
+static char *zstd_decode_frame(ZstdReader *zstd, ZSTD_DCtx *ctx, int frame)
 {
-  if (zstd->seek.cached_frame == frame) {
-    /* Cached frame matches, so just return it. */
-    return zstd->seek.cached_content;
-  }
-
-  /* Cached frame doesn't match, so discard it and cache the wanted one instead. */
-  MEM_SAFE_FREE(zstd->seek.cached_content);
-
   size_t compressed_size = zstd->seek.compressed_ofs[frame + 1] - zstd->seek.compressed_ofs[frame];
   size_t uncompressed_size = zstd->seek.uncompressed_ofs[frame + 1] -
                              zstd->seek.uncompressed_ofs[frame];
 
   char *uncompressed_data = MEM_mallocN(uncompressed_size, __func__);
   char *compressed_data = MEM_mallocN(compressed_size, __func__);
-  if (zstd->base->seek(zstd->base, zstd->seek.compressed_ofs[frame], SEEK_SET) < 0 ||
-      zstd->base->read(zstd->base, compressed_data, compressed_size) < compressed_size) {
+
+  if (zstd->prefetch.pool) {
+    BLI_mutex_lock(&zstd->prefetch.io_mutex);
+  }
+  bool read_ok = zstd->base->seek(zstd->base, zstd->seek.compressed_ofs[frame], SEEK_SET) >= 0 &&
+                 zstd->base->read(zstd->base, compressed_data, compressed_size) >=
+                     compressed_size;
+  if (zstd->prefetch.pool) {
+    BLI_mutex_unlock(&zstd->prefetch.io_mutex);
+  }
+
+  if (!read_ok) {
     MEM_freeN(compressed_data);
     MEM_freeN(uncompressed_data);
     return NULL;
   }
 
   size_t res = ZSTD_decompressDCtx(
-      zstd->ctx, uncompressed_data, uncompressed_size, compressed_data, compressed_size);
+      ctx, uncompressed_data, uncompressed_size, compressed_data, compressed_size);
   MEM_freeN(compressed_data);
   if (ZSTD_isError(res) || res < uncompressed_size) {
     MEM_freeN(uncompressed_data);
     return NULL;
   }
 
-  zstd->seek.cached_frame = frame;
-  zstd->seek.cached_content = uncompressed_data;
   return uncompressed_data;
 }
 
+static ZstdFrameSlot *zstd_slot_find(ZstdReader *zstd, int frame)
+{
+  for (int i = 0; i < zstd->seek.num_slots; i++) {
+    ZstdFrameSlot *slot = &zstd->seek.slots[i];
+    if (slot->state != ZSTD_SLOT_FREE && slot->frame == frame) {
+      return slot;
+    }
+  }
+  return NULL;
+}
+
+/* Find a slot that can be reused for a new frame, without discarding any frame
+ * in the range `[keep_first, keep_last]`. Slots that are being decoded are never reused.
+ * Returns NULL if no slot is available. */
+static ZstdFrameSlot *zstd_slot_claim(ZstdReader *zstd, int keep_first, int keep_last)
+{
+  ZstdFrameSlot *best = NULL;
+  for (int i = 0; i < zstd->seek.num_slots; i++) {
+    ZstdFrameSlot *slot = &zstd->seek.slots[i];
+    if (slot->state == ZSTD_SLOT_FREE) {
+      return slot;
+    }
+    if (slot->state == ZSTD_SLOT_RUNNING) {
+      continue;
+    }
+    if (slot->frame >= keep_first && slot->frame <= keep_last) {
+      continue;
+    }
+    /* Prefer discarding frames that are behind the read position. */
+    if (best == NULL || slot->frame < best->frame) {
+      best = slot;
+    }
+  }
+
+  if (best) {
+    MEM_SAFE_FREE(best->content);
+    best->state = ZSTD_SLOT_FREE;
+  }
+  return best;
+}
+
+static void zstd_prefetch_task(TaskPool *__restrict pool, void *taskdata)
+{
+  ZstdReader *zstd = BLI_task_pool_user_data(pool);
+  ZstdFrameSlot *slot = taskdata;
+
+  BLI_mutex_lock(&zstd->prefetch.mutex);
+  if (slot->state != ZSTD_SLOT_QUEUED) {
+    /* The reading thread already took over this frame, or it was discarded. */
+    BLI_mutex_unlock(&zstd->prefetch.mutex);
+    return;
+  }
+  slot->state = ZSTD_SLOT_RUNNING;
+  const int frame = slot->frame;
+  BLI_mutex_unlock(&zstd->prefetch.mutex);
+
+  ZSTD_DCtx *ctx = ZSTD_createDCtx();
+  char *content = zstd_decode_frame(zstd, ctx, frame);
+  ZSTD_freeDCtx(ctx);
+
+  BLI_mutex_lock(&zstd->prefetch.mutex);
+  slot->content = content;
+  slot->state = content ? ZSTD_SLOT_READY : ZSTD_SLOT_FAILED;
+  BLI_mutex_unlock(&zstd->prefetch.mutex);
+  BLI_condition_notify_all(&zstd->prefetch.condition);
+}
+
+/* Ensure that the wanted frame is decoded, single threaded variant. */
+static const char *zstd_ensure_cache_serial(ZstdReader *zstd, int frame)
+{
+  ZstdFrameSlot *slot = &zstd->seek.slots[0];
+  if (slot->state == ZSTD_SLOT_READY && slot->frame == frame) {
+    /* Cached frame matches, so just return it. */
+    return slot->content;
+  }
+
+  /* Cached frame doesn't match, so discard it and cache the wanted one instead. */
+  MEM_SAFE_FREE(slot->content);
+  slot->state = ZSTD_SLOT_FREE;
+
+  char *content = zstd_decode_frame(zstd, zstd->ctx, frame);
+  if (content == NULL) {
+    return NULL;
+  }
+
+  slot->frame = frame;
+  slot->state = ZSTD_SLOT_READY;
+  slot->content = content;
+  return content;
+}
+
+/* Ensure that the wanted frame is decoded. When the file is read sequentially, the following
+ * frames are pushed to the task pool so they get decoded in parallel while the current one
+ * is being parsed. The returned content stays valid until the next call. */
+static const char *zstd_ensure_cache(ZstdReader *zstd, int frame)
+{
+  if (zstd->prefetch.pool == NULL) {
+    return zstd_ensure_cache_serial(zstd, frame);
+  }
+
+  const int last_prefetch = min_ii(frame + zstd->seek.num_slots - 1, zstd->seek.num_frames - 1);
+  const bool is_sequential = (frame == zstd->seek.last_frame + 1);
+  zstd->seek.last_frame = frame;
+
+  BLI_mutex_lock(&zstd->prefetch.mutex);
+
+  ZstdFrameSlot *slot;
+  while ((slot = zstd_slot_find(zstd, frame)) == NULL) {
+    /* The wanted frame takes priority over any prefetched one. */
+    slot = zstd_slot_claim(zstd, frame, frame - 1);
+    if (slot) {
+      slot->frame = frame;
+      slot->state = ZSTD_SLOT_QUEUED;
+      break;
+    }
+    /* All slots are being decoded by prefetch tasks, wait for one of them. */
+    BLI_condition_wait(&zstd->prefetch.condition, &zstd->prefetch.mutex);
+  }
+
+  /* Queue the frames following this one, so they are ready by the time they are needed. */
+  ZstdFrameSlot *queued[ZSTD_PREFETCH_MAX_FRAMES];
+  int num_queued = 0;
+  if (is_sequential) {
+    for (int next = frame + 1; next <= last_prefetch; next++) {
+      if (zstd_slot_find(zstd, next)) {
+        continue;
+      }
+      ZstdFrameSlot *next_slot = zstd_slot_claim(zstd, frame, last_prefetch);
+      if (next_slot == NULL) {
+        break;
+      }
+      next_slot->frame = next;
+      next_slot->state = ZSTD_SLOT_QUEUED;
+      queued[num_queued++] = next_slot;
+    }
+  }
+
+  /* Decode the wanted frame on this thread if no task started on it yet,
+   * rather than waiting for a worker to pick it up. */
+  const bool decode_here = (slot->state == ZSTD_SLOT_QUEUED);
+  if (decode_here) {
+    slot->state = ZSTD_SLOT_RUNNING;
+  }
+  BLI_mutex_unlock(&zstd->prefetch.mutex);
+
+  /* Push outside of the lock, tasks may be executed immediately. */
+  for (int i = 0; i < num_queued; i++) {
+    BLI_task_pool_push(zstd->prefetch.pool, zstd_prefetch_task, queued[i], false, NULL);
+  }
+
+  if (decode_here) {
+    char *content = zstd_decode_frame(zstd, zstd->ctx, frame);
+
+    BLI_mutex_lock(&zstd->prefetch.mutex);
+    slot->content = content;
+    slot->state = content ? ZSTD_SLOT_READY : ZSTD_SLOT_FAILED;
+    BLI_mutex_unlock(&zstd->prefetch.mutex);
+    BLI_condition_notify_all(&zstd->prefetch.condition);
+    return content;
+  }
+
+  BLI_mutex_lock(&zstd->prefetch.mutex);
+  while (slot->state == ZSTD_SLOT_RUNNING) {
+    BLI_condition_wait(&zstd->prefetch.condition, &zstd->prefetch.mutex);
+  }
+  const char *content = (slot->state == ZSTD_SLOT_READY) ? slot->content : NULL;
+  BLI_mutex_unlock(&zstd->prefetch.mutex);
+
+  return content;
+}
+
 static ssize_t zstd_read_seekable(FileReader *reader, void *buffer, size_t size)
 {
   ZstdReader *zstd = (ZstdReader *)reader;
@@ -293,11 +505,31 @@ static void zstd_close(FileReader *reader)
 {
   ZstdReader *zstd = (ZstdReader *)reader;
 
+  if (zstd->prefetch.pool) {
+    /* Discard pending prefetches and wait for the running ones. */
+    BLI_mutex_lock(&zstd->prefetch.mutex);
+    for (int i = 0; i < zstd->seek.num_slots; i++) {
+      if (zstd->seek.slots[i].state == ZSTD_SLOT_QUEUED) {
+        zstd->seek.slots[i].state = ZSTD_SLOT_FREE;
+      }
+    }
+    BLI_mutex_unlock(&zstd->prefetch.mutex);
+
+    BLI_task_pool_work_and_wait(zstd->prefetch.pool);
+    BLI_task_pool_free(zstd->prefetch.pool);
+    BLI_mutex_end(&zstd->prefetch.mutex);
+    BLI_mutex_end(&zstd->prefetch.io_mutex);
+    BLI_condition_end(&zstd->prefetch.condition);
+  }
+
   ZSTD_freeDCtx(zstd->ctx);
   if (zstd->reader.seek) {
     MEM_freeN(zstd->seek.uncompressed_ofs);
     MEM_freeN(zstd->seek.compressed_ofs);
-    MEM_freeN(zstd->seek.cached_content);
+    for (int i = 0; i < zstd->seek.num_slots; i++) {
+      MEM_SAFE_FREE(zstd->seek.slots[i].content);
+    }
+    MEM_freeN(zstd->seek.slots);
   }
   else {
     MEM_freeN((void *)zstd->in_buf.src);
@@ -317,6 +549,21 @@ FileReader *BLI_filereader_new_zstd(FileReader *base)
   if (zstd_read_seek_table(zstd)) {
     zstd->reader.read = zstd_read_seekable;
     zstd->reader.seek = zstd_seek;
+
+    /* Decode frames ahead of the read position in parallel, one per available thread. */
+    const int num_threads = BLI_task_scheduler_num_threads();
+    if (num_threads > 1 && zstd->seek.num_frames > 1) {
+      zstd->seek.num_slots = min_iii(num_threads, ZSTD_PREFETCH_MAX_FRAMES, zstd->seek.num_frames);
+      zstd->prefetch.pool = BLI_task_pool_create(zstd, TASK_PRIORITY_HIGH);
+      BLI_mutex_init(&zstd->prefetch.mutex);
+      BLI_mutex_init(&zstd->prefetch.io_mutex);
+      BLI_condition_init(&zstd->prefetch.condition);
+    }
+    else {
+      zstd->seek.num_slots = 1;
+    }
+    zstd->seek.slots = MEM_calloc_arrayN(
+        zstd->seek.num_slots, sizeof(ZstdFrameSlot), "zstd frame slots");
   }
   else {
     zstd->reader.read = zstd_read;
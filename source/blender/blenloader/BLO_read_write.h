@@ -51,6 +51,7 @@ extern "C" {
 
 typedef struct BlendDataReader BlendDataReader;
 typedef struct BlendExpander BlendExpander;
+typedef struct BlendLazyData BlendLazyData;
 typedef struct BlendLibReader BlendLibReader;
 typedef struct BlendWriter BlendWriter;
 
@@ -212,6 +213,17 @@ void BLO_read_float3_array(BlendDataReader *reader, int array_size, float **ptr_
 void BLO_read_double_array(BlendDataReader *reader, int array_size, double **ptr_p);
 void BLO_read_pointer_array(BlendDataReader *reader, void **ptr_p);
 
+/* Lazy data (see #BLO_READ_LAZY_DATA).
+ *
+ * Returns a handle to read the raw data block at old_address from the file later on, or NULL
+ * when the data is available in memory already and has to be read with the regular functions
+ * above. The handle owns a reference to the file and is freed with #BLO_lazy_data_free. */
+BlendLazyData *BLO_read_lazy_data(BlendDataReader *reader, const void *old_address);
+/* Read the data from the file, returns NULL when the file changed since it was opened. */
+void *BLO_lazy_data_read(const BlendLazyData *lazy_data);
+BlendLazyData *BLO_lazy_data_copy(const BlendLazyData *lazy_data);
+void BLO_lazy_data_free(BlendLazyData *lazy_data);
+
 /* Misc. */
 bool BLO_read_requires_endian_switch(BlendDataReader *reader);
 bool BLO_read_data_is_undo(BlendDataReader *reader);
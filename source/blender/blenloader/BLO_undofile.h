@@ -27,14 +27,42 @@
 #include "BLI_filereader.h"
 
 struct GHash;
+struct GSet;
 struct Scene;
 
+/**
+ * Memory of a #MemFileChunk, stored once per content in a #MemFileChunkStore
+ * and shared by all chunks (of any #MemFile using that store) with the same content.
+ */
+typedef struct MemFileChunkBuffer {
+  const char *buf;
+  /** Size in bytes. */
+  size_t size;
+  uint hash;
+  /** Number of #MemFileChunk (and #MemFileWriteCache) using this buffer. */
+  uint users;
+} MemFileChunkBuffer;
+
+/**
+ * Content-addressed storage of #MemFileChunkBuffer,
+ * shared by a #MemFile and all the ones written using it as reference.
+ */
+typedef struct MemFileChunkStore {
+  /** Set of #MemFileChunkBuffer, hashed by content. */
+  struct GSet *buffers;
+  /** Number of #MemFile using this store. */
+  uint users;
+} MemFileChunkStore;
+
 typedef struct {
   void *next, *prev;
   const char *buf;
   /** Size in bytes. */
   size_t size;
-  /** When true, this chunk doesn't own the memory, it's shared with a previous #MemFileChunk */
+  /** The shared memory #MemFileChunk.buf belongs to. */
+  MemFileChunkBuffer *buffer;
+  /** When true, this chunk is identical to the one at the same position in the previous step
+   * (and shares its memory). */
   bool is_identical;
   /** When true, this chunk is also identical to the one in the next step (used by undo code to
    * detect unchanged IDs).
@@ -47,7 +75,9 @@ typedef struct {
 
 typedef struct MemFile {
   ListBase chunks;
+  /** Size in bytes of the chunk memory allocated when writing this #MemFile. */
   size_t size;
+  MemFileChunkStore *chunk_store;
 } MemFile;
 
 typedef struct MemFileWriteData {
@@ -97,4 +127,10 @@ extern struct Main *BLO_memfile_main_get(struct MemFile *memfile,
                                          struct Scene **r_scene);
 extern bool BLO_memfile_write_file(struct MemFile *memfile, const char *filename);
 
+typedef struct MemFileWriteCache MemFileWriteCache;
+extern bool BLO_memfile_write_file_incremental(struct MemFile *memfile,
+                                               const char *filename,
+                                               MemFileWriteCache **r_cache);
+extern void BLO_memfile_write_cache_free(MemFileWriteCache *cache);
+
 FileReader *BLO_memfile_new_filereader(MemFile *memfile, int undo_direction);
@@ -61,6 +61,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "BLI_blenlib.h"
 #include "BLI_endian_defines.h"
 #include "BLI_endian_switch.h"
@@ -195,6 +197,7 @@ static void read_libraries(FileData *basefd, ListBase *mainlist);
 static void *read_struct(FileData *fd, BHead *bh, const char *blockname);
 static BHead *find_bhead_from_code_name(FileData *fd, const short idcode, const char *name);
 static BHead *find_bhead_from_idname(FileData *fd, const char *idname);
+static void lazy_source_decref(struct BlendLazySource *source);
 static bool library_link_idcode_needs_tag_check(const short idcode, const int flag);
 
 typedef struct BHeadN {
@@ -1218,7 +1221,8 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
   rawfile->seek(rawfile, 0, SEEK_SET);
 
   /* Check if we have a regular file. */
-  if (memcmp(header, "BLENDER", sizeof(header)) == 0) {
+  const bool is_uncompressed = (memcmp(header, "BLENDER", sizeof(header)) == 0);
+  if (is_uncompressed) {
     /* Try opening the file with memory-mapped IO. */
     file = BLI_filereader_new_mmap(filedes);
     if (file == NULL) {
@@ -1251,6 +1255,9 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
 
   FileData *fd = filedata_new(reports);
   fd->file = file;
+  if (is_uncompressed) {
+    fd->flags |= FD_FLAGS_IS_UNCOMPRESSED;
+  }
 
   return fd;
 }
@@ -1385,6 +1392,12 @@ void blo_filedata_free(FileData *fd)
     if (fd->packedmap) {
       oldnewmap_free(fd->packedmap);
     }
+    if (fd->lazymap) {
+      oldnewmap_free(fd->lazymap);
+    }
+    if (fd->lazy_source) {
+      lazy_source_decref(fd->lazy_source);
+    }
     if (fd->libmap && !(fd->flags & FD_FLAGS_NOT_MY_LIBMAP)) {
       oldnewmap_free(fd->libmap);
     }
@@ -1536,6 +1549,175 @@ BlendThumbnail *BLO_thumbnail_from_file(const char *filepath)
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Lazy Data
+ *
+ * With #BLO_READ_LAZY_DATA, large raw data blocks of uncompressed files (in practice the
+ * content of packed files) are not read together with the ID they belong to. Only their
+ * location in the file is kept, and the data is read when first needed.
+ * Code that does not know about lazy data still gets the data read on access,
+ * see #lazy_data_read_into_datamap.
+ * \{ */
+
+/* Smaller blocks are cheap enough to read right away. */
+#define LAZY_DATA_MIN_SIZE (1 << 16) /* 64kb */
+
+/* File that lazy data is read from, shared by the #FileData and all #BlendLazyData. */
+typedef struct BlendLazySource {
+  int32_t users;
+  char filepath[FILE_MAX];
+  /* Used to detect that the file was modified since it was opened. */
+  int64_t file_size;
+  int64_t file_mtime;
+} BlendLazySource;
+
+struct BlendLazyData {
+  BlendLazySource *source;
+  off64_t offset;
+  size_t size;
+};
+
+static void lazy_source_decref(BlendLazySource *source)
+{
+  if (atomic_sub_and_fetch_int32(&source->users, 1) == 0) {
+    MEM_freeN(source);
+  }
+}
+
+void blo_filedata_lazy_data_init(FileData *fd, const char *filepath)
+{
+#ifdef USE_BHEAD_READ_ON_DEMAND
+  if (!(fd->flags & FD_FLAGS_IS_UNCOMPRESSED) || fd->file->seek == NULL) {
+    return;
+  }
+
+  BLI_stat_t st;
+  if (BLI_stat(filepath, &st) != 0) {
+    return;
+  }
+
+  BlendLazySource *source = MEM_callocN(sizeof(*source), __func__);
+  source->users = 1;
+  BLI_strncpy(source->filepath, filepath, sizeof(source->filepath));
+  source->file_size = (int64_t)st.st_size;
+  source->file_mtime = (int64_t)st.st_mtime;
+
+  fd->lazy_source = source;
+  fd->lazymap = oldnewmap_new();
+#else
+  UNUSED_VARS(fd, filepath);
+#endif
+}
+
+static bool blo_bhead_use_lazy_data(FileData *fd, BHead *bhead)
+{
+#ifdef USE_BHEAD_READ_ON_DEMAND
+  /* Only raw data (written with #BLO_write_raw) does not need any conversion. */
+  return fd->lazymap != NULL && bhead->SDNAnr == 0 && bhead->len >= LAZY_DATA_MIN_SIZE &&
+         BHEADN_FROM_BHEAD(bhead)->has_data == false;
+#else
+  UNUSED_VARS(fd, bhead);
+  return false;
+#endif
+}
+
+/* Read a block kept in the file when it is accessed through the regular pointer lookup.
+ * Returns false if there is no such block. */
+static bool lazy_data_read_into_datamap(FileData *fd, const void *adr)
+{
+  BHead *bhead = oldnewmap_lookup_and_inc(fd->lazymap, adr, false);
+  if (bhead == NULL) {
+    return false;
+  }
+  void *data = read_struct(fd, bhead, "lazy data");
+  if (data == NULL) {
+    return false;
+  }
+  oldnewmap_insert(fd->datamap, adr, data, 0);
+  return true;
+}
+
+BlendLazyData *BLO_read_lazy_data(BlendDataReader *reader, const void *old_address)
+{
+  FileData *fd = reader->fd;
+  if (fd->lazymap == NULL || old_address == NULL) {
+    return NULL;
+  }
+  if (oldnewmap_lookup_entry(fd->datamap, old_address)) {
+    /* Already read because other code accessed it. */
+    return NULL;
+  }
+  BHead *bhead = oldnewmap_lookup_and_inc(fd->lazymap, old_address, false);
+  if (bhead == NULL) {
+    return NULL;
+  }
+
+  BlendLazyData *lazy_data = MEM_mallocN(sizeof(*lazy_data), __func__);
+  lazy_data->source = fd->lazy_source;
+  lazy_data->offset = BHEADN_FROM_BHEAD(bhead)->file_offset;
+  lazy_data->size = (size_t)bhead->len;
+  atomic_add_and_fetch_int32(&lazy_data->source->users, 1);
+  return lazy_data;
+}
+
+void *BLO_lazy_data_read(const BlendLazyData *lazy_data)
+{
+  const BlendLazySource *source = lazy_data->source;
+
+  BLI_stat_t st;
+  if (BLI_stat(source->filepath, &st) != 0 || (int64_t)st.st_size != source->file_size ||
+      (int64_t)st.st_mtime != source->file_mtime) {
+    CLOG_WARN(&LOG, "File '%s' changed, cannot read data from it", source->filepath);
+    return NULL;
+  }
+
+  const int file = BLI_open(source->filepath, O_BINARY | O_RDONLY, 0);
+  if (file == -1) {
+    CLOG_WARN(&LOG, "Unable to open '%s': %s", source->filepath, strerror(errno));
+    return NULL;
+  }
+
+  char *data = MEM_mallocN(lazy_data->size, __func__);
+  size_t size_read = 0;
+  if (BLI_lseek(file, lazy_data->offset, SEEK_SET) == lazy_data->offset) {
+    /* Reads may return less than requested, e.g. for large sizes or when interrupted. */
+    while (size_read < lazy_data->size) {
+      const size_t size_chunk = MIN2(lazy_data->size - size_read, (size_t)INT_MAX);
+      const int64_t result = (int64_t)read(file, data + size_read, size_chunk);
+      if (result > 0) {
+        size_read += (size_t)result;
+      }
+      else if (result == 0 || errno != EINTR) {
+        break;
+      }
+    }
+  }
+  close(file);
+
+  if (size_read != lazy_data->size) {
+    CLOG_WARN(&LOG, "Unable to read data from '%s'", source->filepath);
+    MEM_freeN(data);
+    return NULL;
+  }
+
+  return data;
+}
+
+BlendLazyData *BLO_lazy_data_copy(const BlendLazyData *lazy_data)
+{
+  BlendLazyData *lazy_data_copy = MEM_dupallocN(lazy_data);
+  atomic_add_and_fetch_int32(&lazy_data_copy->source->users, 1);
+  return lazy_data_copy;
+}
+
+void BLO_lazy_data_free(BlendLazyData *lazy_data)
+{
+  lazy_source_decref(lazy_data->source);
+  MEM_freeN(lazy_data);
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Old/New Pointer Map
  * \{ */
@@ -1543,13 +1725,21 @@ BlendThumbnail *BLO_thumbnail_from_file(const char *filepath)
 /* Only direct data-blocks. */
 static void *newdataadr(FileData *fd, const void *adr)
 {
-  return oldnewmap_lookup_and_inc(fd->datamap, adr, true);
+  void *newadr = oldnewmap_lookup_and_inc(fd->datamap, adr, true);
+  if (UNLIKELY(newadr == NULL && adr && fd->lazymap && lazy_data_read_into_datamap(fd, adr))) {
+    newadr = oldnewmap_lookup_and_inc(fd->datamap, adr, true);
+  }
+  return newadr;
 }
 
 /* Only direct data-blocks. */
 static void *newdataadr_no_us(FileData *fd, const void *adr)
 {
-  return oldnewmap_lookup_and_inc(fd->datamap, adr, false);
+  void *newadr = oldnewmap_lookup_and_inc(fd->datamap, adr, false);
+  if (UNLIKELY(newadr == NULL && adr && fd->lazymap && lazy_data_read_into_datamap(fd, adr))) {
+    newadr = oldnewmap_lookup_and_inc(fd->datamap, adr, false);
+  }
+  return newadr;
 }
 
 /* Direct datablocks with global linking. */
@@ -1565,7 +1755,7 @@ static void *newpackedadr(FileData *fd, const void *adr)
     return oldnewmap_lookup_and_inc(fd->packedmap, adr, true);
   }
 
-  return oldnewmap_lookup_and_inc(fd->datamap, adr, true);
+  return newdataadr(fd, adr);
 }
 
 /* only lib data */
@@ -1637,7 +1827,10 @@ void blo_clear_proxy_pointers_from_lib(Main *oldmain)
 static void insert_packedmap(FileData *fd, PackedFile *pf)
 {
   oldnewmap_insert(fd->packedmap, pf, pf, 0);
-  oldnewmap_insert(fd->packedmap, pf->data, pf->data, 0);
+  /* Data still in the file is restored with the packed file, see #BKE_packedfile_blend_read. */
+  if (pf->data != NULL) {
+    oldnewmap_insert(fd->packedmap, pf->data, pf->data, 0);
+  }
 }
 
 void blo_make_packed_pointer_map(FileData *fd, Main *oldmain)
@@ -3123,6 +3316,14 @@ static BHead *read_data_into_datamap(FileData *fd, BHead *bhead, const char *all
     }
 #endif
 
+    if (blo_bhead_use_lazy_data(fd, bhead)) {
+      /* Keep the data in the file, see #BLO_read_lazy_data. The #BHead is owned by the
+       * #FileData, insert it as used so #oldnewmap_clear doesn't free it. */
+      oldnewmap_insert(fd->lazymap, bhead->old, bhead, 1);
+      bhead = blo_bhead_next(fd, bhead);
+      continue;
+    }
+
     void *data = read_struct(fd, bhead, allocname);
     if (data) {
       oldnewmap_insert(fd->datamap, bhead->old, data, 0);
@@ -3486,6 +3687,9 @@ static BHead *read_libblock(FileData *fd,
   bhead = read_data_into_datamap(fd, bhead, allocname);
   const bool success = direct_link_id(fd, main, id_tag, id, id_old);
   oldnewmap_clear(fd->datamap);
+  if (fd->lazymap) {
+    oldnewmap_clear(fd->lazymap);
+  }
 
   if (!success) {
     /* XXX This is probably working OK currently given the very limited scope of that flag.
@@ -3529,6 +3733,9 @@ BHead *blo_read_asset_data_block(FileData *fd, BHead *bhead, AssetMetaData **r_a
   BKE_asset_metadata_read(&reader, *r_asset_data);
 
   oldnewmap_clear(fd->datamap);
+  if (fd->lazymap) {
+    oldnewmap_clear(fd->lazymap);
+  }
 
   return bhead;
 }
@@ -3876,6 +4083,9 @@ static BHead *read_userdef(BlendFileData *bfd, FileData *fd, BHead *bhead)
 
   /* free fd->datamap again */
   oldnewmap_clear(fd->datamap);
+  if (fd->lazymap) {
+    oldnewmap_clear(fd->lazymap);
+  }
 
   return bhead;
 }
@@ -5284,10 +5494,14 @@ static FileData *read_library_file_data(FileData *basefd,
                      TIP_("Read packed library:  '%s', parent '%s'"),
                      mainptr->curlib->filepath,
                      library_parent_filepath(mainptr->curlib));
-    fd = blo_filedata_from_memory(pf->data, pf->size, basefd->reports);
+    if (BKE_packedfile_ensure_data(pf)) {
+      fd = blo_filedata_from_memory(pf->data, pf->size, basefd->reports);
+    }
 
     /* Needed for library_append and read_libraries. */
-    BLI_strncpy(fd->relabase, mainptr->curlib->filepath_abs, sizeof(fd->relabase));
+    if (fd != NULL) {
+      BLI_strncpy(fd->relabase, mainptr->curlib->filepath_abs, sizeof(fd->relabase));
+    }
   }
   else {
     /* Read file on disk. */
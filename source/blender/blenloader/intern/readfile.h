@@ -53,6 +53,8 @@ enum eFileDataFlag {
   FD_FLAGS_IS_MEMFILE = 1 << 4,
   /* XXX Unused in practice (checked once but never set). */
   FD_FLAGS_NOT_MY_LIBMAP = 1 << 5,
+  /** File offsets match the file on disk, see #blo_filedata_lazy_data_init. */
+  FD_FLAGS_IS_UNCOMPRESSED = 1 << 6,
 };
 
 /* Disallow since it's 32bit on ms-windows. */
@@ -106,6 +108,9 @@ typedef struct FileData {
   struct OldNewMap *globmap;
   struct OldNewMap *libmap;
   struct OldNewMap *packedmap;
+  /** Data blocks kept in the file for #BLO_READ_LAZY_DATA, maps old address to #BHead. */
+  struct OldNewMap *lazymap;
+  struct BlendLazySource *lazy_source;
   struct BLOCacheStorage *cache_storage;
 
   struct BHeadSort *bheadmap;
@@ -139,6 +144,8 @@ FileData *blo_filedata_from_memfile(struct MemFile *memfile,
                                     const struct BlendFileReadParams *params,
                                     struct BlendFileReadReport *reports);
 
+void blo_filedata_lazy_data_init(FileData *fd, const char *filepath);
+
 void blo_clear_proxy_pointers_from_lib(struct Main *oldmain);
 void blo_make_packed_pointer_map(FileData *fd, struct Main *oldmain);
 void blo_end_packed_pointer_map(FileData *fd, struct Main *oldmain);
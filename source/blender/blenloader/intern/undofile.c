@@ -42,6 +42,7 @@
 
 #include "BLI_blenlib.h"
 #include "BLI_ghash.h"
+#include "BLI_hash_mm2a.h"
 
 #include "BLO_readfile.h"
 #include "BLO_undofile.h"
@@ -55,53 +56,133 @@
 
 /* **************** support for memory-write, for undo buffers *************** */
 
+/* -------------------------------------------------------------------- */
+/** \name Chunk Store
+ *
+ * Chunk memory is de-duplicated by content across all undo steps, not only against the chunk at
+ * the same position in the previous step, so that data going back to an earlier state (or moved
+ * around in the file) does not need to be stored again.
+ * \{ */
+
+static uint memfile_chunk_buffer_hash(const void *key)
+{
+  return ((const MemFileChunkBuffer *)key)->hash;
+}
+
+static bool memfile_chunk_buffer_cmp(const void *a, const void *b)
+{
+  const MemFileChunkBuffer *buffer_a = a;
+  const MemFileChunkBuffer *buffer_b = b;
+  return (buffer_a->hash != buffer_b->hash) || (buffer_a->size != buffer_b->size) ||
+         (memcmp(buffer_a->buf, buffer_b->buf, buffer_a->size) != 0);
+}
+
+static MemFileChunkStore *memfile_chunk_store_new(void)
+{
+  MemFileChunkStore *store = MEM_callocN(sizeof(MemFileChunkStore), __func__);
+  store->buffers = BLI_gset_new(memfile_chunk_buffer_hash, memfile_chunk_buffer_cmp, __func__);
+  return store;
+}
+
+static void memfile_chunk_store_decref(MemFileChunkStore *store)
+{
+  BLI_assert(store->users > 0);
+  if (--store->users == 0) {
+    /* All chunks using the store have been freed already. */
+    BLI_assert(BLI_gset_len(store->buffers) == 0);
+    BLI_gset_free(store->buffers, NULL);
+    MEM_freeN(store);
+  }
+}
+
+/**
+ * Get the shared buffer with the same content as \a buf, adding a copy of it to the store if
+ * there is none yet.
+ *
+ * \param r_is_new: Set when a new buffer had to be allocated.
+ */
+static MemFileChunkBuffer *memfile_chunk_store_ensure(MemFileChunkStore *store,
+                                                      const char *buf,
+                                                      const size_t size,
+                                                      bool *r_is_new)
+{
+  MemFileChunkBuffer key = {
+      .buf = buf,
+      .size = size,
+      .hash = BLI_hash_mm2((const uchar *)buf, size, 0),
+  };
+
+  MemFileChunkBuffer *buffer = BLI_gset_lookup(store->buffers, &key);
+  *r_is_new = (buffer == NULL);
+  if (buffer == NULL) {
+    char *buf_new = MEM_mallocN(size, "Chunk buffer");
+    memcpy(buf_new, buf, size);
+
+    buffer = MEM_mallocN(sizeof(MemFileChunkBuffer), __func__);
+    *buffer = key;
+    buffer->buf = buf_new;
+    BLI_gset_insert(store->buffers, buffer);
+  }
+  buffer->users++;
+  return buffer;
+}
+
+static void memfile_chunk_store_buffer_decref(MemFileChunkStore *store, MemFileChunkBuffer *buffer)
+{
+  BLI_assert(buffer->users > 0);
+  if (--buffer->users == 0) {
+    BLI_gset_remove(store->buffers, buffer, NULL);
+    MEM_freeN((void *)buffer->buf);
+    MEM_freeN(buffer);
+  }
+}
+
+/** \} */
+
 /* not memfile itself */
 void BLO_memfile_free(MemFile *memfile)
 {
   MemFileChunk *chunk;
 
   while ((chunk = BLI_pophead(&memfile->chunks))) {
-    if (chunk->is_identical == false) {
-      MEM_freeN((void *)chunk->buf);
-    }
+    memfile_chunk_store_buffer_decref(memfile->chunk_store, chunk->buffer);
     MEM_freeN(chunk);
   }
   memfile->size = 0;
+
+  if (memfile->chunk_store != NULL) {
+    memfile_chunk_store_decref(memfile->chunk_store);
+    memfile->chunk_store = NULL;
+  }
 }
 
 /* to keep list of memfiles consistent, 'first' is always first in list */
 /* result is that 'first' is being freed */
 void BLO_memfile_merge(MemFile *first, MemFile *second)
 {
-  /* We use this mapping to store the memory buffers from second memfile chunks which are not owned
-   * by it (i.e. shared with some previous memory steps). */
-  GHash *buffer_to_second_memchunk = BLI_ghash_new(
-      BLI_ghashutil_ptrhash, BLI_ghashutil_ptrcmp, __func__);
-
-  /* First, detect all memchunks in second memfile that are not owned by it. */
-  for (MemFileChunk *sc = second->chunks.first; sc != NULL; sc = sc->next) {
-    if (sc->is_identical) {
-      BLI_ghash_insert(buffer_to_second_memchunk, (void *)sc->buf, sc);
+  /* Chunks of the second memfile identical to the first one share their buffer with their
+   * counterpart in the first memfile. Since buffers are de-duplicated by content, several chunks
+   * of both memfiles may share the same buffer, so gather all buffers which were changed in the
+   * first memfile (the one we are removing). */
+  GSet *changed_buffers = BLI_gset_ptr_new(__func__);
+  for (MemFileChunk *fc = first->chunks.first; fc != NULL; fc = fc->next) {
+    if (!fc->is_identical) {
+      BLI_gset_add(changed_buffers, fc->buffer);
     }
   }
 
-  /* Now, check all chunks from first memfile (the one we are removing), and if a memchunk owned by
-   * it is also used by the second memfile, transfer the ownership. */
-  for (MemFileChunk *fc = first->chunks.first; fc != NULL; fc = fc->next) {
-    if (!fc->is_identical) {
-      MemFileChunk *sc = BLI_ghash_lookup(buffer_to_second_memchunk, fc->buf);
-      if (sc != NULL) {
-        BLI_assert(sc->is_identical);
-        sc->is_identical = false;
-        fc->is_identical = true;
-      }
-      /* Note that if the second memfile does not use that chunk, we assume that the first one
-       * fully owns it without sharing it with any other memfile, and hence it should be freed with
-       * it. */
+  /* A chunk of the second memfile using one of these buffers as-is may be identical to a changed
+   * chunk, so it is not identical to the step before the first memfile anymore. This can also
+   * clear chunks identical to another (unchanged) chunk with the same content, which only means
+   * their data is read again on undo. Memory itself is reference counted, see
+   * #MemFileChunkBuffer. */
+  for (MemFileChunk *sc = second->chunks.first; sc != NULL; sc = sc->next) {
+    if (sc->is_identical && BLI_gset_haskey(changed_buffers, sc->buffer)) {
+      sc->is_identical = false;
     }
   }
 
-  BLI_ghash_free(buffer_to_second_memchunk, NULL, NULL);
+  BLI_gset_free(changed_buffers, NULL);
 
   BLO_memfile_free(first);
 }
@@ -122,6 +203,14 @@ void BLO_memfile_write_init(MemFileWriteData *mem_data,
   mem_data->reference_memfile = reference_memfile;
   mem_data->reference_current_chunk = reference_memfile ? reference_memfile->chunks.first : NULL;
 
+  /* Share chunk memory with the reference memfile (and all the ones it shares it with). */
+  if (written_memfile->chunk_store == NULL) {
+    written_memfile->chunk_store = (reference_memfile && reference_memfile->chunk_store) ?
+                                       reference_memfile->chunk_store :
+                                       memfile_chunk_store_new();
+    written_memfile->chunk_store->users++;
+  }
+
   /* If we have a reference memfile, we generate a mapping between the session_uuid's of the
    * IDs stored in that previous undo step, and its first matching memchunk. This will allow
    * us to easily find the existing undo memory storage of IDs even when some re-ordering in
@@ -163,6 +252,7 @@ void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t s
   MemFileChunk *curchunk = MEM_mallocN(sizeof(MemFileChunk), "MemFileChunk");
   curchunk->size = size;
   curchunk->buf = NULL;
+  curchunk->buffer = NULL;
   curchunk->is_identical = false;
   /* This is unsafe in the sense that an app handler or other code that does not
    * perform an undo push may make changes after the last undo push that
@@ -177,6 +267,8 @@ void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t s
     if (compchunk->size == curchunk->size) {
       if (memcmp(compchunk->buf, buf, size) == 0) {
         curchunk->buf = compchunk->buf;
+        curchunk->buffer = compchunk->buffer;
+        curchunk->buffer->users++;
         curchunk->is_identical = true;
         compchunk->is_identical_future = true;
       }
@@ -184,12 +276,14 @@ void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t s
     *compchunk_step = compchunk->next;
   }
 
-  /* not equal... */
+  /* not equal, look for the same content anywhere in the previous steps... */
   if (curchunk->buf == NULL) {
-    char *buf_new = MEM_mallocN(size, "Chunk buffer");
-    memcpy(buf_new, buf, size);
-    curchunk->buf = buf_new;
-    memfile->size += size;
+    bool is_new;
+    curchunk->buffer = memfile_chunk_store_ensure(memfile->chunk_store, buf, size, &is_new);
+    curchunk->buf = curchunk->buffer->buf;
+    if (is_new) {
+      memfile->size += size;
+    }
   }
 }
 
@@ -216,23 +310,18 @@ struct Main *BLO_memfile_main_get(struct MemFile *memfile,
   return bmain_undo;
 }
 
-/**
- * Saves .blend using undo buffer.
- *
- * \return success.
- */
-bool BLO_memfile_write_file(struct MemFile *memfile, const char *filename)
+static int memfile_file_open(const char *filename, const bool truncate)
 {
-  MemFileChunk *chunk;
-  int file, oflags;
+  int oflags = O_BINARY | O_WRONLY | O_CREAT;
+  if (truncate) {
+    oflags |= O_TRUNC;
+  }
 
   /* NOTE: This is currently used for autosave and 'quit.blend',
    * where _not_ following symlinks is OK,
    * however if this is ever executed explicitly by the user,
    * we may want to allow writing to symlinks.
    */
-
-  oflags = O_BINARY | O_WRONLY | O_CREAT | O_TRUNC;
 #ifdef O_NOFOLLOW
   /* use O_NOFOLLOW to avoid writing to a symlink - use 'O_EXCL' (CVE-2008-1103) */
   oflags |= O_NOFOLLOW;
@@ -242,23 +331,42 @@ bool BLO_memfile_write_file(struct MemFile *memfile, const char *filename)
 #    warning "Symbolic links will be followed on undo save, possibly causing CVE-2008-1103"
 #  endif
 #endif
-  file = BLI_open(filename, oflags, 0666);
+  const int file = BLI_open(filename, oflags, 0666);
 
   if (file == -1) {
     fprintf(stderr,
             "Unable to save '%s': %s\n",
             filename,
             errno ? strerror(errno) : "Unknown error opening file");
-    return false;
   }
+  return file;
+}
 
-  for (chunk = memfile->chunks.first; chunk; chunk = chunk->next) {
+static bool memfile_file_write_chunk(int file, const MemFileChunk *chunk)
+{
 #ifdef _WIN32
-    if ((size_t)write(file, chunk->buf, (uint)chunk->size) != chunk->size)
+  return (size_t)write(file, chunk->buf, (uint)chunk->size) == chunk->size;
 #else
-    if ((size_t)write(file, chunk->buf, chunk->size) != chunk->size)
+  return (size_t)write(file, chunk->buf, chunk->size) == chunk->size;
 #endif
-    {
+}
+
+/**
+ * Saves .blend using undo buffer.
+ *
+ * \return success.
+ */
+bool BLO_memfile_write_file(struct MemFile *memfile, const char *filename)
+{
+  MemFileChunk *chunk;
+
+  const int file = memfile_file_open(filename, true);
+  if (file == -1) {
+    return false;
+  }
+
+  for (chunk = memfile->chunks.first; chunk; chunk = chunk->next) {
+    if (!memfile_file_write_chunk(file, chunk)) {
       break;
     }
   }
@@ -275,6 +383,213 @@ bool BLO_memfile_write_file(struct MemFile *memfile, const char *filename)
   return true;
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Incremental MemFile Writing
+ *
+ * Repeatedly saving undo buffers to the same file (as done by autosave) mostly writes
+ * the same data again, since usually only a few data-blocks change in-between.
+ * Here the file is updated in place instead: only the chunks which don't match the chunk written
+ * at the same file offset last time are written.
+ * The resulting file is identical to the one written by #BLO_memfile_write_file.
+ *
+ * Chunks are compared by content: the cache keeps a reference to the buffers that were written,
+ * so they stay in memory (at most one extra copy of the file). Since buffers of a store are
+ * de-duplicated by content, chunks of the same store are unchanged when they use the same buffer.
+ * Other buffers are compared byte by byte.
+ * \{ */
+
+typedef struct MemFileWrittenChunk {
+  size_t offset;
+  MemFileChunkBuffer *buffer;
+} MemFileWrittenChunk;
+
+struct MemFileWriteCache {
+  char filename[FILE_MAX];
+  /** Size and modification time of the written file, to detect external changes to it. */
+  int64_t file_size;
+  int64_t file_mtime;
+
+  /** Store owning the buffers of #chunks, the cache holds a reference to both. */
+  MemFileChunkStore *chunk_store;
+  MemFileWrittenChunk *chunks;
+  uint chunks_len;
+};
+
+static bool memfile_chunk_is_unchanged(const MemFileWriteCache *cache,
+                                       const MemFileWrittenChunk *cache_chunk,
+                                       const MemFileChunkStore *chunk_store,
+                                       const MemFileChunkBuffer *buffer)
+{
+  if (cache_chunk->buffer == buffer) {
+    return true;
+  }
+  if (cache_chunk->buffer->size != buffer->size || cache->chunk_store == chunk_store) {
+    return false;
+  }
+  return memcmp(cache_chunk->buffer->buf, buffer->buf, buffer->size) == 0;
+}
+
+/**
+ * Check the file written last time is still there, unchanged.
+ */
+static bool memfile_write_cache_is_valid(const MemFileWriteCache *cache, const char *filename)
+{
+  if (cache->chunks == NULL || !STREQ(cache->filename, filename)) {
+    return false;
+  }
+  BLI_stat_t st;
+  if (BLI_stat(filename, &st) == -1) {
+    return false;
+  }
+  return ((int64_t)st.st_size == cache->file_size) && ((int64_t)st.st_mtime == cache->file_mtime);
+}
+
+static void memfile_written_chunks_free(MemFileChunkStore *chunk_store,
+                                        MemFileWrittenChunk *chunks,
+                                        const uint chunks_len)
+{
+  for (uint i = 0; i < chunks_len; i++) {
+    memfile_chunk_store_buffer_decref(chunk_store, chunks[i].buffer);
+  }
+  MEM_freeN(chunks);
+  memfile_chunk_store_decref(chunk_store);
+}
+
+static void memfile_write_cache_clear(MemFileWriteCache *cache)
+{
+  if (cache->chunks != NULL) {
+    memfile_written_chunks_free(cache->chunk_store, cache->chunks, cache->chunks_len);
+    cache->chunks = NULL;
+  }
+  cache->chunk_store = NULL;
+  cache->chunks_len = 0;
+  cache->filename[0] = '\0';
+}
+
+/**
+ * Saves .blend using undo buffer, only writing the parts of the file which changed since the
+ * last save to the same file using the same \a cache.
+ *
+ * \param r_cache: Information about the previously written file, created on first use.
+ * Free with #BLO_memfile_write_cache_free.
+ * \return success.
+ */
+bool BLO_memfile_write_file_incremental(struct MemFile *memfile,
+                                        const char *filename,
+                                        MemFileWriteCache **r_cache)
+{
+  if (*r_cache == NULL) {
+    *r_cache = MEM_callocN(sizeof(MemFileWriteCache), __func__);
+  }
+  MemFileWriteCache *cache = *r_cache;
+
+  const bool use_cache = memfile_write_cache_is_valid(cache, filename);
+
+  const int file = memfile_file_open(filename, !use_cache);
+  if (file == -1) {
+    memfile_write_cache_clear(cache);
+    return false;
+  }
+
+  MemFileChunkStore *chunk_store = memfile->chunk_store;
+  BLI_assert(chunk_store != NULL);
+  chunk_store->users++;
+
+  const uint chunks_len = (uint)BLI_listbase_count(&memfile->chunks);
+  MemFileWrittenChunk *chunks = MEM_malloc_arrayN(chunks_len, sizeof(*chunks), __func__);
+  /* Number of chunks referencing their buffer. */
+  uint chunks_num = 0;
+  /* Index of the previously written chunk which may start at the current offset. */
+  uint cache_index = 0;
+  /* Current offset in the file, may be ahead of the actual file position when skipping. */
+  size_t offset = 0;
+  bool file_offset_valid = true;
+  bool ok = true;
+
+  uint i = 0;
+  for (MemFileChunk *chunk = memfile->chunks.first; chunk; chunk = chunk->next, i++) {
+    MemFileWrittenChunk *written_chunk = &chunks[i];
+    written_chunk->offset = offset;
+    written_chunk->buffer = chunk->buffer;
+    chunk->buffer->users++;
+    chunks_num++;
+
+    bool is_unchanged = false;
+    if (use_cache) {
+      while (cache_index < cache->chunks_len && cache->chunks[cache_index].offset < offset) {
+        cache_index++;
+      }
+      if (cache_index < cache->chunks_len) {
+        const MemFileWrittenChunk *cache_chunk = &cache->chunks[cache_index];
+        is_unchanged = (cache_chunk->offset == offset) &&
+                       memfile_chunk_is_unchanged(cache, cache_chunk, chunk_store, chunk->buffer);
+      }
+    }
+
+    if (is_unchanged) {
+      file_offset_valid = false;
+    }
+    else {
+      if (!file_offset_valid) {
+        if (BLI_lseek(file, (int64_t)offset, SEEK_SET) == -1) {
+          ok = false;
+          break;
+        }
+        file_offset_valid = true;
+      }
+      if (!memfile_file_write_chunk(file, chunk)) {
+        ok = false;
+        break;
+      }
+    }
+    offset += chunk->size;
+  }
+
+  if (ok && use_cache && (int64_t)offset != cache->file_size) {
+#ifdef _WIN32
+    ok = _chsize_s(file, (int64_t)offset) == 0;
+#else
+    ok = ftruncate(file, (off_t)offset) == 0;
+#endif
+  }
+
+  close(file);
+
+  memfile_write_cache_clear(cache);
+
+  if (!ok) {
+    fprintf(stderr,
+            "Unable to save '%s': %s\n",
+            filename,
+            errno ? strerror(errno) : "Unknown error writing file");
+    memfile_written_chunks_free(chunk_store, chunks, chunks_num);
+    return false;
+  }
+
+  BLI_stat_t st;
+  if (BLI_stat(filename, &st) == -1) {
+    memfile_written_chunks_free(chunk_store, chunks, chunks_num);
+    return true;
+  }
+
+  BLI_strncpy(cache->filename, filename, sizeof(cache->filename));
+  cache->file_size = (int64_t)st.st_size;
+  cache->file_mtime = (int64_t)st.st_mtime;
+  cache->chunk_store = chunk_store;
+  cache->chunks = chunks;
+  cache->chunks_len = chunks_len;
+
+  return true;
+}
+
+void BLO_memfile_write_cache_free(MemFileWriteCache *cache)
+{
+  memfile_write_cache_clear(cache);
+  MEM_freeN(cache);
+}
+
+/** \} */
+
 static ssize_t undo_read(FileReader *reader, void *buffer, size_t size)
 {
   UndoReader *undo = (UndoReader *)reader;
@@ -105,9 +105,12 @@
 #include "BLI_linklist.h"
 #include "BLI_math_base.h"
 #include "BLI_mempool.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 #include "MEM_guardedalloc.h" /* MEM_freeN */
 
+#include "atomic_ops.h"
+
 #include "BKE_blender_version.h"
 #include "BKE_bpath.h"
 #include "BKE_global.h" /* for G */
@@ -149,6 +152,17 @@
 
 #define ZSTD_COMPRESSION_LEVEL 3
 
+/**
+ * Maximum number of IDs of a same type serialized in parallel before their data is appended to
+ * the file.
+ */
+#define ID_PARALLEL_BATCH_SIZE 64
+/**
+ * No more IDs of a batch are serialized once their data exceeds this size, this bounds the extra
+ * memory used to hold the serialized IDs (plus the size of the IDs being serialized already).
+ */
+#define ID_PARALLEL_BATCH_MEMORY (1 << 26) /* 64mb */
+
 /** Use if we want to store how many bytes have been written to the file. */
 // #define USE_WRITE_DATA_LEN
 
@@ -434,6 +448,18 @@ typedef struct {
   /** When true, write to #WriteData.current, could also call 'is_undo'. */
   bool use_memfile;
 
+  /**
+   * Data of a single ID serialized in parallel with other IDs,
+   * appended to the actual file in order afterwards, see #write_id_list_parallel.
+   */
+  struct {
+    char *data;
+    size_t len;
+    size_t max_len;
+  } id_memory;
+  /** When true, write to #WriteData.id_memory. */
+  bool use_id_memory;
+
   /**
    * Wrap writing, so we can use zstd or
    * other compression types later, see: G_FILE_COMPRESS
@@ -469,6 +495,35 @@ static WriteData *writedata_new(WriteWrap *ww)
   return wd;
 }
 
+/**
+ * Write data used to serialize a single ID into memory, see #write_id_list_parallel.
+ * Writes are unbuffered since all data ends up in #WriteData.id_memory anyway.
+ */
+static WriteData *writedata_new_id_memory(void)
+{
+  WriteData *wd = MEM_callocN(sizeof(*wd), "writedata_id_memory");
+
+  wd->sdna = DNA_sdna_current_get();
+  wd->use_id_memory = true;
+
+  return wd;
+}
+
+static void writedata_id_memory_append(WriteData *wd, const void *mem, size_t memlen)
+{
+  if (wd->id_memory.len + memlen > wd->id_memory.max_len) {
+    wd->id_memory.max_len = MAX2(wd->id_memory.len + memlen, wd->id_memory.max_len * 2);
+    if (wd->id_memory.data == NULL) {
+      wd->id_memory.data = MEM_mallocN(wd->id_memory.max_len, "wd->id_memory.data");
+    }
+    else {
+      wd->id_memory.data = MEM_reallocN(wd->id_memory.data, wd->id_memory.max_len);
+    }
+  }
+  memcpy(&wd->id_memory.data[wd->id_memory.len], mem, memlen);
+  wd->id_memory.len += memlen;
+}
+
 static void writedata_do_write(WriteData *wd, const void *mem, size_t memlen)
 {
   if ((wd == NULL) || wd->error || (mem == NULL) || memlen < 1) {
@@ -488,6 +543,9 @@ static void writedata_do_write(WriteData *wd, const void *mem, size_t memlen)
   if (wd->use_memfile) {
     BLO_memfile_chunk_add(&wd->mem, mem, memlen);
   }
+  else if (wd->use_id_memory) {
+    writedata_id_memory_append(wd, mem, memlen);
+  }
   else {
     if (wd->ww->write(wd->ww, mem, memlen) != memlen) {
       wd->error = true;
@@ -500,6 +558,9 @@ static void writedata_free(WriteData *wd)
   if (wd->buffer.buf) {
     MEM_freeN(wd->buffer.buf);
   }
+  if (wd->id_memory.data) {
+    MEM_freeN(wd->id_memory.data);
+  }
   MEM_freeN(wd);
 }
 
@@ -1086,6 +1147,208 @@ static void write_thumb(WriteData *wd, const BlendThumbnail *thumb)
 /** \name File Writing (Private)
  * \{ */
 
+#define ID_BUFFER_STATIC_SIZE 8192
+
+/**
+ * Write an ID (from a copy of it with runtime data cleared) and its associated data.
+ */
+static void write_id(BlendWriter *writer,
+                     ID *id,
+                     void *id_buffer,
+                     const size_t idtype_struct_size)
+{
+  memcpy(id_buffer, id, idtype_struct_size);
+
+  /* Clear runtime data to reduce false detection of changed data in undo/redo context. */
+  ((ID *)id_buffer)->tag = 0;
+  ((ID *)id_buffer)->us = 0;
+  ((ID *)id_buffer)->icon_id = 0;
+  /* Those listbase data change every time we add/remove an ID, and also often when
+   * renaming one (due to re-sorting). This avoids generating a lot of false 'is changed'
+   * detections between undo steps. */
+  ((ID *)id_buffer)->prev = NULL;
+  ((ID *)id_buffer)->next = NULL;
+  /* Those runtime pointers should never be set during writing stage, but just in case clear
+   * them too. */
+  ((ID *)id_buffer)->orig_id = NULL;
+  ((ID *)id_buffer)->newid = NULL;
+  /* Even though in theory we could be able to preserve this python instance across undo even
+   * when we need to re-read the ID into its original address, this is currently cleared in
+   * #direct_link_id_common in `readfile.c` anyway, */
+  ((ID *)id_buffer)->py_instance = NULL;
+
+  const IDTypeInfo *id_type = BKE_idtype_get_info_from_id(id);
+  if (id_type->blend_write != NULL) {
+    id_type->blend_write(writer, (ID *)id_buffer, id);
+  }
+}
+
+/**
+ * Serialize a single ID into its own #WriteData memory.
+ * Only used when writing to file (never for undo).
+ */
+static WriteData *write_id_to_memory(ID *id,
+                                     const size_t idtype_struct_size,
+                                     Main *bmain,
+                                     OverrideLibraryStorage *override_storage)
+{
+  WriteData *wd = writedata_new_id_memory();
+  BlendWriter writer = {wd};
+
+  char id_buffer_static[ID_BUFFER_STATIC_SIZE];
+  void *id_buffer = id_buffer_static;
+  if (idtype_struct_size > ID_BUFFER_STATIC_SIZE) {
+    BLI_assert(0);
+    id_buffer = MEM_mallocN(idtype_struct_size, __func__);
+  }
+
+  if (override_storage != NULL) {
+    BKE_lib_override_library_operations_store_start(bmain, override_storage, id);
+  }
+
+  write_id(&writer, id, id_buffer, idtype_struct_size);
+
+  if (override_storage != NULL) {
+    BKE_lib_override_library_operations_store_end(override_storage, id);
+  }
+
+  if (id_buffer != id_buffer_static) {
+    MEM_freeN(id_buffer);
+  }
+
+  return wd;
+}
+
+/**
+ * ID types which writing code was checked to only modify the ID copy being written and to not
+ * access other data that could be modified concurrently, so that multiple IDs can be written in
+ * parallel. Note that node trees are not, their writing code updates node storage.
+ */
+static bool write_id_type_is_thread_safe(const short id_code)
+{
+  return ELEM(id_code,
+              ID_ME,
+              ID_CU,
+              ID_MB,
+              ID_LT,
+              ID_KE,
+              ID_AC,
+              ID_IM,
+              ID_GD,
+              ID_PT,
+              ID_HA,
+              ID_VO);
+}
+
+typedef struct WriteIDListParallelData {
+  ID **ids;
+  /** Serialized data of each ID, already set for IDs written on the calling thread. */
+  WriteData **id_wds;
+  size_t idtype_struct_size;
+  /** Size of the data serialized in the batch, see #ID_PARALLEL_BATCH_MEMORY. */
+  size_t memory_used;
+} WriteIDListParallelData;
+
+static void write_id_list_parallel_fn(void *__restrict userdata,
+                                      const int index,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  WriteIDListParallelData *data = userdata;
+  if (data->id_wds[index] != NULL) {
+    return;
+  }
+  /* Leave the remaining IDs to the next batch, the first one is always written so that every
+   * batch makes progress. */
+  if (index != 0 && atomic_add_and_fetch_z(&data->memory_used, 0) >= ID_PARALLEL_BATCH_MEMORY) {
+    return;
+  }
+  WriteData *id_wd = write_id_to_memory(data->ids[index], data->idtype_struct_size, NULL, NULL);
+  atomic_add_and_fetch_z(&data->memory_used, id_wd->id_memory.len);
+  data->id_wds[index] = id_wd;
+}
+
+/**
+ * Write all IDs of a list, serializing them in parallel into memory and appending the result
+ * to the file in list order, so the output is identical to writing them one after the other.
+ *
+ * IDs are serialized in batches bounded by #ID_PARALLEL_BATCH_SIZE and
+ * #ID_PARALLEL_BATCH_MEMORY. IDs storing library override operations are serialized on the
+ * calling thread, since this modifies the override storage #Main.
+ *
+ * \note Only for writing to file, undo relies on writing IDs in order into the #MemFile
+ * to detect unchanged chunks.
+ */
+static void write_id_list_parallel(WriteData *wd,
+                                   Main *bmain,
+                                   OverrideLibraryStorage *override_storage,
+                                   ListBase *lb,
+                                   const size_t idtype_struct_size)
+{
+  ID *ids[ID_PARALLEL_BATCH_SIZE];
+  WriteData *id_wds[ID_PARALLEL_BATCH_SIZE];
+  WriteIDListParallelData data = {ids, id_wds, idtype_struct_size, 0};
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+
+  ID *id = lb->first;
+  /* IDs left over from the previous batch, at the start of the arrays. */
+  int ids_num = 0;
+  while ((id != NULL || ids_num != 0) && !wd->error) {
+    for (; id != NULL && ids_num < ID_PARALLEL_BATCH_SIZE; id = id->next) {
+      BLI_assert(
+          (id->tag & (LIB_TAG_NO_MAIN | LIB_TAG_NO_USER_REFCOUNT | LIB_TAG_NOT_ALLOCATED)) == 0);
+
+      /* Unused IDs are only written in undo case, see #write_file_handle. */
+      if (id->us == 0) {
+        BLI_assert(!ELEM(GS(id->name), ID_SCE, ID_WM, ID_WS));
+        continue;
+      }
+
+      ids[ids_num] = id;
+      id_wds[ids_num] = NULL;
+      if (!ELEM(override_storage, NULL, bmain) && ID_IS_OVERRIDE_LIBRARY_REAL(id)) {
+        id_wds[ids_num] = write_id_to_memory(id, idtype_struct_size, bmain, override_storage);
+      }
+      ids_num++;
+    }
+
+    data.memory_used = 0;
+    for (int i = 0; i < ids_num; i++) {
+      if (id_wds[i] != NULL) {
+        data.memory_used += id_wds[i]->id_memory.len;
+      }
+    }
+
+    BLI_task_parallel_range(0, ids_num, &data, write_id_list_parallel_fn, &settings);
+
+    /* Append the serialized IDs in list order, up to the first one left for the next batch. */
+    int ids_written = 0;
+    for (; ids_written < ids_num && id_wds[ids_written] != NULL; ids_written++) {
+      WriteData *id_wd = id_wds[ids_written];
+      if (id_wd->error) {
+        wd->error = true;
+      }
+      else if (id_wd->id_memory.len != 0) {
+        mywrite(wd, id_wd->id_memory.data, id_wd->id_memory.len);
+      }
+      writedata_free(id_wd);
+    }
+
+    ids_num -= ids_written;
+    memmove(ids, &ids[ids_written], sizeof(*ids) * (size_t)ids_num);
+    memmove(id_wds, &id_wds[ids_written], sizeof(*id_wds) * (size_t)ids_num);
+  }
+
+  /* Only left over on errors. */
+  for (int i = 0; i < ids_num; i++) {
+    if (id_wds[i] != NULL) {
+      writedata_free(id_wds[i]);
+    }
+  }
+}
+
 /* if MemFile * there's filesave to memory */
 static bool write_file_handle(Main *mainvar,
                               WriteWrap *ww,
@@ -1125,7 +1388,9 @@ static bool write_file_handle(Main *mainvar,
                                                  NULL :
                                                  BKE_lib_override_library_operations_store_init();
 
-#define ID_BUFFER_STATIC_SIZE 8192
+  /* Serializing IDs in parallel only pays off (and is only valid) when writing to file. */
+  const bool use_parallel = !wd->use_memfile && (BLI_system_thread_count() > 1);
+
   /* This outer loop allows to save first data-blocks from real mainvar,
    * then the temp ones from override process,
    * if needed, without duplicating whole code. */
@@ -1140,9 +1405,16 @@ static bool write_file_handle(Main *mainvar,
         continue; /* Libraries are handled separately below. */
       }
 
+      const size_t idtype_struct_size = BKE_idtype_get_info_from_id(id)->struct_size;
+
+      if (use_parallel && write_id_type_is_thread_safe(GS(id->name))) {
+        write_id_list_parallel(wd, bmain, override_storage, lbarray[a], idtype_struct_size);
+        mywrite_flush(wd);
+        continue;
+      }
+
       char id_buffer_static[ID_BUFFER_STATIC_SIZE];
       void *id_buffer = id_buffer_static;
-      const size_t idtype_struct_size = BKE_idtype_get_info_from_id(id)->struct_size;
       if (idtype_struct_size > ID_BUFFER_STATIC_SIZE) {
         BLI_assert(0);
         id_buffer = MEM_mallocN(idtype_struct_size, __func__);
@@ -1193,30 +1465,7 @@ static bool write_file_handle(Main *mainvar,
 
         mywrite_id_begin(wd, id);
 
-        memcpy(id_buffer, id, idtype_struct_size);
-
-        /* Clear runtime data to reduce false detection of changed data in undo/redo context. */
-        ((ID *)id_buffer)->tag = 0;
-        ((ID *)id_buffer)->us = 0;
-        ((ID *)id_buffer)->icon_id = 0;
-        /* Those listbase data change every time we add/remove an ID, and also often when
-         * renaming one (due to re-sorting). This avoids generating a lot of false 'is changed'
-         * detections between undo steps. */
-        ((ID *)id_buffer)->prev = NULL;
-        ((ID *)id_buffer)->next = NULL;
-        /* Those runtime pointers should never be set during writing stage, but just in case clear
-         * them too. */
-        ((ID *)id_buffer)->orig_id = NULL;
-        ((ID *)id_buffer)->newid = NULL;
-        /* Even though in theory we could be able to preserve this python instance across undo even
-         * when we need to re-read the ID into its original address, this is currently cleared in
-         * #direct_link_id_common in `readfile.c` anyway, */
-        ((ID *)id_buffer)->py_instance = NULL;
-
-        const IDTypeInfo *id_type = BKE_idtype_get_info_from_id(id);
-        if (id_type->blend_write != NULL) {
-          id_type->blend_write(&writer, (ID *)id_buffer, id);
-        }
+        write_id(&writer, id, id_buffer, idtype_struct_size);
 
         if (do_override) {
           BKE_lib_override_library_operations_store_end(override_storage, id);
@@ -1340,6 +1589,13 @@ bool BLO_write_file(Main *mainvar,
     BLO_main_validate_shapekeys(mainvar, reports);
   }
 
+  /* Packed data that is still in the file it was loaded from would be lost, this may be the
+   * file being overwritten. */
+  if (!BKE_packedfile_ensure_data_all(mainvar, reports)) {
+    BKE_report(reports, RPT_ERROR, "Not saving, packed data can't be read");
+    return 0;
+  }
+
   /* open temporary file, so we preserve the original in case we crash */
   BLI_snprintf(tempname, sizeof(tempname), "%s@", filepath);
 
@@ -0,0 +1,284 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup blenloader
+ *
+ * Write and read back generated #Main databases, through all file reading paths
+ * (memory-mapped uncompressed files, zstd compressed files, in-memory data and undo #MemFile).
+ */
+
+#include "blendfile_loading_base_test.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "MEM_guardedalloc.h"
+
+#include "BKE_appdir.h"
+#include "BKE_collection.h"
+#include "BKE_customdata.h"
+#include "BKE_global.h"
+#include "BKE_lib_id.h"
+#include "BKE_main.h"
+#include "BKE_material.h"
+#include "BKE_mesh.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+
+#include "BLI_fileops.h"
+#include "BLI_listbase.h"
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+#include "BLI_threads.h"
+
+#include "BLO_readfile.h"
+#include "BLO_undofile.h"
+#include "BLO_writefile.h"
+
+#include "DNA_collection_types.h"
+#include "DNA_material_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+namespace blender::blenloader::tests {
+
+struct GeneratedMainParams {
+  /** Number of meshes with `mesh_grid_size * mesh_grid_size` vertices. */
+  int meshes_num;
+  int mesh_grid_size;
+  /** Number of objects, using the meshes above in turn. */
+  int objects_num;
+  /** Number of small IDs (materials) without much data. */
+  int small_ids_num;
+};
+
+static Mesh *mesh_grid_add(Main *bmain, const char *name, const int grid_size)
+{
+  Mesh *mesh = BKE_mesh_add(bmain, name);
+  mesh->totvert = grid_size * grid_size;
+  mesh->totpoly = (grid_size - 1) * (grid_size - 1);
+  mesh->totloop = mesh->totpoly * 4;
+  CustomData_add_layer(&mesh->vdata, CD_MVERT, CD_CALLOC, nullptr, mesh->totvert);
+  CustomData_add_layer(&mesh->pdata, CD_MPOLY, CD_CALLOC, nullptr, mesh->totpoly);
+  CustomData_add_layer(&mesh->ldata, CD_MLOOP, CD_CALLOC, nullptr, mesh->totloop);
+  BKE_mesh_update_customdata_pointers(mesh, false);
+
+  for (int y = 0; y < grid_size; y++) {
+    for (int x = 0; x < grid_size; x++) {
+      MVert &vert = mesh->mvert[y * grid_size + x];
+      vert.co[0] = float(x);
+      vert.co[1] = float(y);
+      vert.co[2] = float((x * y) % 7);
+    }
+  }
+  int poly_index = 0;
+  for (int y = 0; y < grid_size - 1; y++) {
+    for (int x = 0; x < grid_size - 1; x++, poly_index++) {
+      MPoly &poly = mesh->mpoly[poly_index];
+      poly.loopstart = poly_index * 4;
+      poly.totloop = 4;
+      MLoop *loops = &mesh->mloop[poly.loopstart];
+      loops[0].v = y * grid_size + x;
+      loops[1].v = y * grid_size + x + 1;
+      loops[2].v = (y + 1) * grid_size + x + 1;
+      loops[3].v = (y + 1) * grid_size + x;
+    }
+  }
+  BKE_mesh_calc_edges(mesh, false, false);
+
+  return mesh;
+}
+
+class BlendfileWriteReadTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+
+  void SetUp() override
+  {
+    BlendfileLoadingBaseTest::SetUp();
+    BKE_tempdir_init(nullptr);
+  }
+
+  void TearDown() override
+  {
+    if (bmain != nullptr) {
+      BKE_main_free(bmain);
+      bmain = nullptr;
+    }
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  void main_generate(const GeneratedMainParams &params)
+  {
+    bmain = BKE_main_new();
+    Scene *scene = BKE_scene_add(bmain, "Scene");
+
+    Mesh **meshes = static_cast<Mesh **>(
+        MEM_malloc_arrayN(params.meshes_num, sizeof(Mesh *), __func__));
+    for (int i = 0; i < params.meshes_num; i++) {
+      meshes[i] = mesh_grid_add(bmain, "Mesh", params.mesh_grid_size);
+    }
+    for (int i = 0; i < params.objects_num; i++) {
+      Object *ob = BKE_object_add_only_object(bmain, OB_MESH, "Object");
+      ob->data = meshes[i % params.meshes_num];
+      id_us_plus(static_cast<ID *>(ob->data));
+      BKE_collection_object_add(bmain, scene->master_collection, ob);
+    }
+    for (int i = 0; i < params.small_ids_num; i++) {
+      Material *ma = BKE_material_add(bmain, "Material");
+      id_fake_user_set(&ma->id);
+    }
+    MEM_freeN(meshes);
+
+    /* Meshes are only used by objects, remove the user from their creation. */
+    LISTBASE_FOREACH (Mesh *, mesh, &bmain->meshes) {
+      id_us_min(&mesh->id);
+    }
+  }
+
+  std::string temp_filepath(const char *filename)
+  {
+    char filepath[FILE_MAX];
+    BLI_join_dirfile(filepath, sizeof(filepath), BKE_tempdir_session(), filename);
+    return filepath;
+  }
+
+  bool main_write(const std::string &filepath, const bool use_compress)
+  {
+    const int fileflags = use_compress ? G_FILE_COMPRESS : 0;
+    const BlendFileWriteParams params = {BLO_WRITE_PATH_REMAP_NONE};
+    return BLO_write_file(bmain, filepath.c_str(), fileflags, &params, nullptr);
+  }
+
+  bool main_read(const std::string &filepath)
+  {
+    blendfile_free();
+    BlendFileReadReport bf_reports = {nullptr};
+    bfile = BLO_read_from_file(filepath.c_str(), BLO_READ_SKIP_NONE, &bf_reports);
+    return bfile != nullptr;
+  }
+
+  /** Check the data read in #bfile matches the generated data. */
+  void expect_main_equal(const GeneratedMainParams &params)
+  {
+    ASSERT_NE(bfile, nullptr);
+    const Main *bmain_read = bfile->main;
+    EXPECT_EQ(BLI_listbase_count(&bmain_read->meshes), params.meshes_num);
+    EXPECT_EQ(BLI_listbase_count(&bmain_read->objects), params.objects_num);
+    EXPECT_EQ(BLI_listbase_count(&bmain_read->materials), params.small_ids_num);
+
+    const Mesh *mesh_orig = static_cast<const Mesh *>(bmain->meshes.first);
+    const Mesh *mesh_read = static_cast<const Mesh *>(bmain_read->meshes.first);
+    ASSERT_NE(mesh_read, nullptr);
+    EXPECT_EQ(mesh_read->totvert, mesh_orig->totvert);
+    EXPECT_EQ(mesh_read->totedge, mesh_orig->totedge);
+    EXPECT_EQ(mesh_read->totpoly, mesh_orig->totpoly);
+    EXPECT_EQ(mesh_read->totloop, mesh_orig->totloop);
+    for (int i = 0; i < mesh_orig->totvert; i++) {
+      EXPECT_EQ(mesh_read->mvert[i].co[2], mesh_orig->mvert[i].co[2]);
+    }
+    for (int i = 0; i < mesh_orig->totloop; i++) {
+      EXPECT_EQ(mesh_read->mloop[i].v, mesh_orig->mloop[i].v);
+    }
+  }
+};
+
+static const GeneratedMainParams small_main_params = {4, 32, 64, 256};
+
+TEST_F(BlendfileWriteReadTest, uncompressed)
+{
+  main_generate(small_main_params);
+  const std::string filepath = temp_filepath("uncompressed.blend");
+  ASSERT_TRUE(main_write(filepath, false));
+  ASSERT_TRUE(main_read(filepath));
+  expect_main_equal(small_main_params);
+}
+
+TEST_F(BlendfileWriteReadTest, zstd)
+{
+  main_generate(small_main_params);
+  const std::string filepath = temp_filepath("zstd.blend");
+  ASSERT_TRUE(main_write(filepath, true));
+  ASSERT_TRUE(main_read(filepath));
+  expect_main_equal(small_main_params);
+}
+
+TEST_F(BlendfileWriteReadTest, memory)
+{
+  main_generate(small_main_params);
+  const std::string filepath = temp_filepath("memory.blend");
+  ASSERT_TRUE(main_write(filepath, false));
+
+  size_t size;
+  void *mem = BLI_file_read_binary_as_mem(filepath.c_str(), 0, &size);
+  ASSERT_NE(mem, nullptr);
+  bfile = BLO_read_from_memory(mem, int(size), BLO_READ_SKIP_NONE, nullptr);
+  MEM_freeN(mem);
+  expect_main_equal(small_main_params);
+}
+
+TEST_F(BlendfileWriteReadTest, memfile)
+{
+  main_generate(small_main_params);
+
+  MemFile memfile_a = {{nullptr}};
+  MemFile memfile_b = {{nullptr}};
+  ASSERT_TRUE(BLO_write_file_mem(bmain, nullptr, &memfile_a, 0));
+  ASSERT_TRUE(BLO_write_file_mem(bmain, &memfile_a, &memfile_b, 0));
+  /* Nothing changed, all memory is shared with the previous step. */
+  EXPECT_EQ(memfile_b.size, 0u);
+
+  /* Read all data from the memfile, instead of re-using unchanged IDs from #bmain. */
+  BlendFileReadParams params = {0};
+  params.skip_flags = BLO_READ_SKIP_UNDO_OLD_MAIN;
+  bfile = BLO_read_from_memfile(bmain, "", &memfile_b, &params, nullptr);
+  expect_main_equal(small_main_params);
+
+  BLO_memfile_merge(&memfile_a, &memfile_b);
+  BLO_memfile_free(&memfile_b);
+}
+
+/* IDs are serialized in parallel when writing to file with multiple threads,
+ * the result has to be identical to writing them one after the other. */
+TEST_F(BlendfileWriteReadTest, parallel_write_identical)
+{
+  main_generate(small_main_params);
+  const std::string filepath_serial = temp_filepath("serial.blend");
+  const std::string filepath_parallel = temp_filepath("parallel.blend");
+
+  const int threads_override = BLI_system_num_threads_override_get();
+  BLI_system_num_threads_override_set(1);
+  const bool serial_ok = main_write(filepath_serial, false);
+  BLI_system_num_threads_override_set(threads_override);
+  ASSERT_TRUE(serial_ok);
+  ASSERT_TRUE(main_write(filepath_parallel, false));
+
+  size_t size_serial, size_parallel;
+  void *mem_serial = BLI_file_read_binary_as_mem(filepath_serial.c_str(), 0, &size_serial);
+  void *mem_parallel = BLI_file_read_binary_as_mem(filepath_parallel.c_str(), 0, &size_parallel);
+  ASSERT_NE(mem_serial, nullptr);
+  ASSERT_NE(mem_parallel, nullptr);
+  EXPECT_EQ(size_serial, size_parallel);
+  EXPECT_EQ(memcmp(mem_serial, mem_parallel, std::min(size_serial, size_parallel)), 0);
+  MEM_freeN(mem_serial);
+  MEM_freeN(mem_parallel);
+}
+
+}  // namespace blender::blenloader::tests
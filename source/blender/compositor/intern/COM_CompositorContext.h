@@ -31,6 +31,8 @@
 
 namespace blender::compositor {
 
+class ResultCache;
+
 /**
  * \brief Overall context of the compositor
  */
@@ -91,6 +93,11 @@ class CompositorContext {
    */
   const char *m_viewName;
 
+  /**
+   * \brief Cache of operations results kept between executions, may be null.
+   */
+  ResultCache *result_cache_;
+
  public:
   /**
    * \brief constructor initializes the context with default values.
@@ -279,6 +286,24 @@ class CompositorContext {
     return (this->getbNodeTree()->flag & NTREE_COM_GROUPNODE_BUFFER) != 0;
   }
 
+  /**
+   * Memory limit in bytes for buffers of full frame execution, 0 when unlimited.
+   */
+  size_t get_memory_limit() const
+  {
+    return (size_t)this->getbNodeTree()->memory_limit * 1024 * 1024;
+  }
+
+  void set_result_cache(ResultCache *result_cache)
+  {
+    result_cache_ = result_cache;
+  }
+
+  ResultCache *get_result_cache() const
+  {
+    return result_cache_;
+  }
+
   /**
    * \brief Get the render percentage as a factor.
    * The compositor uses a factor i.o. a percentage.
@@ -25,6 +25,7 @@
 #include "COM_FullFrameExecutionModel.h"
 #include "COM_NodeOperation.h"
 #include "COM_NodeOperationBuilder.h"
+#include "COM_ResultCache.h"
 #include "COM_TiledExecutionModel.h"
 #include "COM_WorkScheduler.h"
 
@@ -41,7 +42,8 @@ ExecutionSystem::ExecutionSystem(RenderData *rd,
                                  bool fastcalculation,
                                  const ColorManagedViewSettings *viewSettings,
                                  const ColorManagedDisplaySettings *displaySettings,
-                                 const char *viewName)
+                                 const char *viewName,
+                                 ResultCache *result_cache)
 {
   num_work_threads_ = WorkScheduler::get_num_cpu_threads();
   this->m_context.setViewName(viewName);
@@ -64,6 +66,13 @@ ExecutionSystem::ExecutionSystem(RenderData *rd,
   this->m_context.setViewSettings(viewSettings);
   this->m_context.setDisplaySettings(displaySettings);
 
+  /* Results are only cached by the full frame execution model. */
+  if (result_cache && m_context.get_execution_model() != eExecutionModel::FullFrame) {
+    result_cache->clear();
+    result_cache = nullptr;
+  }
+  this->m_context.set_result_cache(result_cache);
+
   BLI_mutex_init(&work_mutex_);
   BLI_condition_init(&work_finished_cond_);
 
@@ -119,6 +119,7 @@ namespace blender::compositor {
 
 /* Forward declarations. */
 class ExecutionModel;
+class ResultCache;
 
 /**
  * \brief the ExecutionSystem contains the whole compositor tree.
@@ -174,7 +175,8 @@ class ExecutionSystem {
                   bool fastcalculation,
                   const ColorManagedViewSettings *viewSettings,
                   const ColorManagedDisplaySettings *displaySettings,
-                  const char *viewName);
+                  const char *viewName,
+                  ResultCache *result_cache);
 
   /**
    * Destructor
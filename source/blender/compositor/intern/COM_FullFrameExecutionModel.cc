@@ -17,12 +17,21 @@
  */
 
 #include "COM_FullFrameExecutionModel.h"
+#include "COM_ConstantOperation.h"
 #include "COM_Debug.h"
 #include "COM_ExecutionGroup.h"
 #include "COM_ReadBufferOperation.h"
+#include "COM_ResultCache.h"
 #include "COM_ViewerOperation.h"
 #include "COM_WorkScheduler.h"
 
+#include "BLI_array.hh"
+#include "BLI_ghash.h"
+#include "BLI_hash_mm2a.h"
+#include "BLI_math_base.h"
+#include "BLI_set.hh"
+#include "BLI_task.hh"
+
 #include "BLT_translation.h"
 
 #ifdef WITH_CXX_GUARDEDALLOC
@@ -31,18 +40,40 @@
 
 namespace blender::compositor {
 
+/**
+ * Smallest band height when rendering in bands, avoids the overhead of areas of interest
+ * overlapping between many thin bands.
+ */
+constexpr int COM_MIN_BAND_HEIGHT = 16;
+
 FullFrameExecutionModel::FullFrameExecutionModel(CompositorContext &context,
                                                  SharedOperationBuffers &shared_buffers,
                                                  Span<NodeOperation *> operations)
     : ExecutionModel(context, operations),
       active_buffers_(shared_buffers),
-      num_operations_finished_(0)
+      num_operations_finished_(0),
+      memory_limit_(context.get_memory_limit()),
+      use_bands_(false),
+      num_bands_(0),
+      num_bands_finished_(0),
+      result_cache_(nullptr)
 {
+  /* Results are not kept for fast calculations which may skip work. */
+  if (!context.isFastCalculation()) {
+    result_cache_ = context.get_result_cache();
+  }
+
   priorities_.append(eCompositorPriority::High);
   if (!context.isFastCalculation()) {
     priorities_.append(eCompositorPriority::Medium);
     priorities_.append(eCompositorPriority::Low);
   }
+
+  use_bands_ = memory_limit_ > 0 && exceeds_memory_limit();
+  if (use_bands_) {
+    /* Results are not complete when rendering in bands. */
+    result_cache_ = nullptr;
+  }
 }
 
 void FullFrameExecutionModel::execute(ExecutionSystem &exec_system)
@@ -52,8 +83,17 @@ void FullFrameExecutionModel::execute(ExecutionSystem &exec_system)
 
   DebugInfo::graphviz(&exec_system, "compositor_prior_rendering");
 
-  determine_areas_to_render_and_reads();
-  render_operations();
+  if (use_bands_) {
+    render_operations_in_bands();
+  }
+  else {
+    determine_areas_to_render_and_reads();
+    render_operations();
+  }
+
+  if (result_cache_ && !exec_system.is_breaked()) {
+    result_cache_->remove_unused_results();
+  }
 }
 
 void FullFrameExecutionModel::determine_areas_to_render_and_reads()
@@ -107,6 +147,18 @@ MemoryBuffer *FullFrameExecutionModel::create_operation_buffer(NodeOperation *op
 
   const DataType data_type = op->getOutputSocket(0)->getDataType();
   const bool is_a_single_elem = op->get_flags().is_constant_operation;
+
+  if (use_bands_ && !is_a_single_elem && op->getWidth() > 0 && op->getHeight() > 0) {
+    /* Only allocate the areas rendered in current band. */
+    if (active_buffers_.get_areas_bounds(op, rect)) {
+      BLI_rcti_translate(
+          &rect, output_x - op->get_canvas().xmin, output_y - op->get_canvas().ymin);
+    }
+    else {
+      BLI_rcti_init(&rect, output_x, output_x + 1, output_y, output_y + 1);
+    }
+  }
+
   return new MemoryBuffer(data_type, rect, is_a_single_elem);
 }
 
@@ -129,6 +181,10 @@ void FullFrameExecutionModel::render_operation(NodeOperation *op)
     for (MemoryBuffer *buf : input_bufs) {
       delete buf;
     }
+
+    if (result_cache_ && has_outputs) {
+      op_buf = cache_result(op, op_buf);
+    }
   }
   /* Even if operation has no resolution set the empty buffer. It will be clipped with a
    * TranslateOperation from convert resolutions if linked to an operation with resolution. */
@@ -162,6 +218,189 @@ void FullFrameExecutionModel::render_operations()
   WorkScheduler::stop();
 }
 
+/**
+ * Gets the band of given area, splitting its rows in equal parts.
+ */
+static rcti get_band_area(const rcti &area, const int band, const int num_bands)
+{
+  const int area_height = BLI_rcti_size_y(&area);
+  rcti band_area = area;
+  band_area.ymin = area.ymin + (int)((int64_t)area_height * band / num_bands);
+  band_area.ymax = area.ymin + (int)((int64_t)area_height * (band + 1) / num_bands);
+  return band_area;
+}
+
+/**
+ * Render all output operations in horizontal bands small enough for the buffers of a band to fit
+ * in the memory limit. Each band is rendered for all outputs at once so that their shared
+ * dependencies are rendered once per band.
+ */
+void FullFrameExecutionModel::render_operations_in_bands()
+{
+  const bool is_rendering = context_.isRendering();
+  const bNodeTree *node_tree = context_.getbNodeTree();
+  for (NodeOperation *op : operations_) {
+    op->setbNodeTree(node_tree);
+  }
+
+  Vector<NodeOperation *> output_ops;
+  Vector<rcti> output_areas;
+  int max_area_height = 0;
+  for (eCompositorPriority priority : priorities_) {
+    for (NodeOperation *op : operations_) {
+      const bool has_size = op->getWidth() > 0 && op->getHeight() > 0;
+      const bool is_priority_output = op->isOutputOperation(is_rendering) &&
+                                      op->getRenderPriority() == priority;
+      if (is_priority_output && has_size) {
+        rcti area;
+        get_output_render_area(op, area);
+        if (!BLI_rcti_is_empty(&area)) {
+          output_ops.append(op);
+          output_areas.append(area);
+          max_area_height = max_ii(max_area_height, BLI_rcti_size_y(&area));
+        }
+      }
+      else if (is_priority_output && !has_size && op->isActiveViewerOutput()) {
+        static_cast<ViewerOperation *>(op)->clear_display_buffer();
+      }
+    }
+  }
+  if (output_ops.is_empty()) {
+    return;
+  }
+
+  const int num_bands = get_num_bands(output_ops, max_area_height);
+
+  WorkScheduler::start(this->context_);
+
+  /* Operations needing their inputs entirely are rendered first, with their inputs rendered in
+   * bands too, so that only their own buffers are kept for the whole frame. */
+  Map<NodeOperation *, Vector<rcti>> visited_areas;
+  VectorSet<NodeOperation *> whole_frame_ops;
+  for (const int band : IndexRange(num_bands)) {
+    for (const int i : output_ops.index_range()) {
+      find_whole_frame_dependent_operations(output_ops[i],
+                                            get_band_area(output_areas[i], band, num_bands),
+                                            visited_areas,
+                                            whole_frame_ops);
+    }
+  }
+  for (NodeOperation *op : whole_frame_ops) {
+    render_whole_frame(op);
+  }
+
+  num_bands_ = num_bands;
+  num_bands_finished_ = 0;
+  for (const int band : IndexRange(num_bands)) {
+    num_operations_finished_ = 0;
+    Vector<NodeOperation *> band_ops;
+    for (const int i : output_ops.index_range()) {
+      const rcti band_area = get_band_area(output_areas[i], band, num_bands);
+      if (!BLI_rcti_is_empty(&band_area)) {
+        determine_areas_to_render(output_ops[i], band_area);
+        band_ops.append(output_ops[i]);
+      }
+    }
+    for (NodeOperation *op : band_ops) {
+      determine_reads(op);
+    }
+    for (NodeOperation *op : band_ops) {
+      render_output_dependencies(op);
+      render_operation(op);
+    }
+
+    /* Dispose band buffers that were not freed by reads, e.g. those of the output operations. */
+    active_buffers_.clear_band();
+    num_bands_finished_++;
+  }
+  num_bands_ = 0;
+
+  WorkScheduler::stop();
+}
+
+static Vector<NodeOperation *> get_operation_dependencies(NodeOperation *operation);
+
+/**
+ * Whether the buffers all output operations dependencies would use for the whole frame exceed
+ * the memory limit.
+ */
+bool FullFrameExecutionModel::exceeds_memory_limit()
+{
+  const bool is_rendering = context_.isRendering();
+  Vector<NodeOperation *> output_ops;
+  for (NodeOperation *op : operations_) {
+    if (op->isOutputOperation(is_rendering) && priorities_.contains(op->getRenderPriority())) {
+      output_ops.append(op);
+    }
+  }
+  return get_frame_memory(output_ops) > memory_limit_;
+}
+
+/**
+ * Gets the memory given operations and all their dependencies would use for the whole frame.
+ */
+size_t FullFrameExecutionModel::get_frame_memory(Span<NodeOperation *> ops)
+{
+  Set<NodeOperation *> counted_ops;
+  size_t frame_memory = 0;
+  auto count_operation = [&](NodeOperation *op) {
+    if (!counted_ops.add(op) || op->getNumberOfOutputSockets() == 0 ||
+        op->get_flags().is_constant_operation) {
+      return;
+    }
+    const int num_channels = COM_data_type_num_channels(op->getOutputSocket(0)->getDataType());
+    frame_memory += sizeof(float) * num_channels * (size_t)op->getWidth() * op->getHeight();
+  };
+
+  for (NodeOperation *op : ops) {
+    for (NodeOperation *dependency : get_operation_dependencies(op)) {
+      count_operation(dependency);
+    }
+    count_operation(op);
+  }
+  return frame_memory;
+}
+
+/**
+ * Gets the number of bands to render given operations in for their buffers to fit in the memory
+ * limit, estimated from the memory they would use for the whole frame.
+ */
+int FullFrameExecutionModel::get_num_bands(Span<NodeOperation *> ops, const int area_height)
+{
+  const size_t frame_memory = get_frame_memory(ops);
+  if (frame_memory <= memory_limit_) {
+    return 1;
+  }
+  const size_t num_bands = (frame_memory + memory_limit_ - 1) / memory_limit_;
+  const int max_num_bands = max_ii(area_height / COM_MIN_BAND_HEIGHT, 1);
+  return (int)min_zz(num_bands, (size_t)max_num_bands);
+}
+
+/**
+ * Whether rendering given area of an operation needs any of its inputs entirely. Such operations
+ * are rendered for their whole canvas once and kept when rendering in bands.
+ */
+bool FullFrameExecutionModel::is_whole_frame_dependent(NodeOperation *op, const rcti &render_area)
+{
+  if (op->getNumberOfOutputSockets() == 0) {
+    return false;
+  }
+
+  const int num_inputs = op->getNumberOfInputSockets();
+  for (int i = 0; i < num_inputs; i++) {
+    NodeOperation *input_op = op->get_input_operation(i);
+    const rcti &input_canvas = input_op->get_canvas();
+    rcti input_area;
+    op->get_area_of_interest(input_op, render_area, input_area);
+    BLI_rcti_isect(&input_area, &input_canvas, &input_area);
+    if (BLI_rcti_compare(&input_area, &input_canvas) &&
+        BLI_rcti_size_y(&input_canvas) > BLI_rcti_size_y(&render_area)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 /**
  * Returns all dependencies from inputs to outputs. A dependency may be repeated when
  * several operations depend on it.
@@ -189,33 +428,342 @@ static Vector<NodeOperation *> get_operation_dependencies(NodeOperation *operati
   return dependencies;
 }
 
+/**
+ * Finds operations that need whole inputs to render given area, ordered from inputs to outputs.
+ * Inputs of those operations are visited in bands as they are rendered in bands too.
+ */
+void FullFrameExecutionModel::find_whole_frame_dependent_operations(
+    NodeOperation *op,
+    const rcti &area,
+    Map<NodeOperation *, Vector<rcti>> &visited_areas,
+    VectorSet<NodeOperation *> &r_ops)
+{
+  if (BLI_rcti_is_empty(&area)) {
+    return;
+  }
+  Vector<rcti> &op_areas = visited_areas.lookup_or_add_default(op);
+  for (const rcti &visited_area : op_areas) {
+    if (BLI_rcti_inside_rcti(&visited_area, &area)) {
+      return;
+    }
+  }
+  op_areas.append(area);
+
+  const bool is_whole_frame = is_whole_frame_dependent(op, area);
+  const int num_inputs = op->getNumberOfInputSockets();
+  for (int i = 0; i < num_inputs; i++) {
+    NodeOperation *input_op = op->get_input_operation(i);
+    const rcti &input_canvas = input_op->get_canvas();
+    if (is_whole_frame) {
+      const int num_bands = get_num_bands({input_op}, BLI_rcti_size_y(&input_canvas));
+      for (const int band : IndexRange(num_bands)) {
+        find_whole_frame_dependent_operations(
+            input_op, get_band_area(input_canvas, band, num_bands), visited_areas, r_ops);
+      }
+    }
+    else {
+      rcti input_area;
+      op->get_area_of_interest(input_op, area, input_area);
+      BLI_rcti_isect(&input_area, &input_canvas, &input_area);
+      find_whole_frame_dependent_operations(input_op, input_area, visited_areas, r_ops);
+    }
+  }
+
+  if (is_whole_frame) {
+    r_ops.add(op);
+  }
+}
+
+/**
+ * Renders an operation that needs its inputs entirely for its whole canvas and keeps it for all
+ * bands. Its inputs are rendered in bands into whole frame buffers, which are freed once read, so
+ * that their own dependencies don't have to be kept for the whole frame.
+ */
+void FullFrameExecutionModel::render_whole_frame(NodeOperation *op)
+{
+  Vector<NodeOperation *> frame_ops;
+  Vector<std::unique_ptr<MemoryBuffer>> frame_bufs;
+  const int num_inputs = op->getNumberOfInputSockets();
+  for (int i = 0; i < num_inputs; i++) {
+    NodeOperation *input_op = op->get_input_operation(i);
+    /* Constant and empty operations are cheap, persistent ones are already rendered. */
+    if (input_op->get_flags().is_constant_operation || input_op->getWidth() == 0 ||
+        input_op->getHeight() == 0 || active_buffers_.is_operation_rendered(input_op) ||
+        frame_ops.contains(input_op)) {
+      continue;
+    }
+
+    rcti frame_rect;
+    BLI_rcti_init(&frame_rect, 0, input_op->getWidth(), 0, input_op->getHeight());
+    std::unique_ptr<MemoryBuffer> frame_buf = std::make_unique<MemoryBuffer>(
+        input_op->getOutputSocket(0)->getDataType(), frame_rect);
+
+    const rcti &input_canvas = input_op->get_canvas();
+    const int num_bands = get_num_bands({input_op}, BLI_rcti_size_y(&input_canvas));
+    for (const int band : IndexRange(num_bands)) {
+      const rcti band_area = get_band_area(input_canvas, band, num_bands);
+      if (BLI_rcti_is_empty(&band_area)) {
+        continue;
+      }
+      determine_areas_to_render(input_op, band_area);
+      determine_reads(input_op);
+      render_operation_dependencies(input_op);
+      render_operation(input_op);
+
+      MemoryBuffer *band_buf = active_buffers_.get_rendered_buffer(input_op);
+      frame_buf->copy_from(band_buf, band_buf->get_rect());
+      active_buffers_.clear_band();
+    }
+
+    frame_ops.append(input_op);
+    frame_bufs.append(std::move(frame_buf));
+  }
+
+  for (const int i : frame_ops.index_range()) {
+    active_buffers_.register_area(frame_ops[i], frame_ops[i]->get_canvas());
+    active_buffers_.set_rendered_buffer(frame_ops[i], std::move(frame_bufs[i]));
+  }
+
+  active_buffers_.set_persistent(op);
+  determine_areas_to_render(op, op->get_canvas());
+  determine_reads(op);
+  render_operation_dependencies(op);
+  render_operation(op);
+  active_buffers_.clear_band();
+}
+
 void FullFrameExecutionModel::render_output_dependencies(NodeOperation *output_op)
 {
   BLI_assert(output_op->isOutputOperation(context_.isRendering()));
-  Vector<NodeOperation *> dependencies = get_operation_dependencies(output_op);
+  if (result_cache_) {
+    render_cached_output_dependencies(output_op, get_operation_dependencies(output_op));
+    return;
+  }
+  render_operation_dependencies(output_op);
+}
+
+void FullFrameExecutionModel::render_operation_dependencies(NodeOperation *op)
+{
+  for (NodeOperation *dependency : get_operation_dependencies(op)) {
+    /* Operations without reads are only needed by already rendered persistent operations. */
+    if (!active_buffers_.is_operation_rendered(dependency) &&
+        active_buffers_.has_registered_reads(dependency)) {
+      render_operation(dependency);
+    }
+  }
+}
+
+static bool is_source_operation(NodeOperation *op)
+{
+  return op->getNumberOfInputSockets() == 0 && op->getNumberOfOutputSockets() > 0 &&
+         !op->get_flags().is_constant_operation;
+}
+
+/**
+ * Render output dependencies taking results from cache when available. Sources are rendered
+ * first as their buffers content identify the results of their dependents, then only
+ * operations needed by results that are not cached are rendered.
+ */
+void FullFrameExecutionModel::render_cached_output_dependencies(
+    NodeOperation *output_op, Span<NodeOperation *> dependencies)
+{
+  for (NodeOperation *op : dependencies) {
+    if (is_source_operation(op) && !active_buffers_.is_operation_rendered(op) &&
+        active_buffers_.has_registered_reads(op)) {
+      render_operation(op);
+    }
+  }
+
+  /* Find operations to take from cache and operations to render, from outputs to inputs. */
+  Set<NodeOperation *> cached_ops;
+  Set<NodeOperation *> ops_to_render;
+  Vector<NodeOperation *> stack;
+  stack.append(output_op);
+  while (!stack.is_empty()) {
+    NodeOperation *op = stack.pop_last();
+    const int num_inputs = op->getNumberOfInputSockets();
+    for (int i = 0; i < num_inputs; i++) {
+      NodeOperation *input_op = op->get_input_operation(i);
+      if (active_buffers_.is_operation_rendered(input_op) || cached_ops.contains(input_op) ||
+          ops_to_render.contains(input_op)) {
+        continue;
+      }
+
+      const std::shared_ptr<const ResultKey> result_key = get_result_key(input_op);
+      if (result_key && !input_op->get_flags().is_constant_operation &&
+          result_cache_->has_result(result_key)) {
+        cached_ops.add(input_op);
+      }
+      else {
+        ops_to_render.add(input_op);
+        stack.append(input_op);
+      }
+    }
+  }
+
+  /* Operations only read by cached operations are not rendered. */
   for (NodeOperation *op : dependencies) {
-    if (!active_buffers_.is_operation_rendered(op)) {
+    if (active_buffers_.is_operation_rendered(op)) {
+      continue;
+    }
+    if (cached_ops.contains(op)) {
+      use_cached_result(op);
+    }
+    else if (ops_to_render.contains(op)) {
       render_operation(op);
     }
   }
 }
 
+static std::shared_ptr<const ResultKey> create_constant_result_key(NodeOperation *op)
+{
+  const DataType data_type = op->getOutputSocket()->getDataType();
+  const float *elem = static_cast<ConstantOperation *>(op)->get_constant_elem();
+  Vector<size_t> params = {get_default_hash(data_type)};
+  for (const int i : IndexRange(COM_data_type_num_channels(data_type))) {
+    params.append(get_default_hash(elem[i]));
+  }
+  return std::make_shared<const ResultKey>(typeid(*op).hash_code(), std::move(params),
+                                           Vector<std::shared_ptr<const ResultKey>>());
+}
+
 /**
- * Determines all operations areas needed to render given output area.
+ * Creates a key identifying a source operation result by its buffer content. Each row content is
+ * hashed separately so that the key is not a single hash.
  */
-void FullFrameExecutionModel::determine_areas_to_render(NodeOperation *output_op,
-                                                        const rcti &output_area)
+static std::shared_ptr<const ResultKey> create_content_result_key(NodeOperation *op,
+                                                                  MemoryBuffer *buf)
 {
-  BLI_assert(output_op->isOutputOperation(context_.isRendering()));
+  const int width = buf->getWidth();
+  const int height = buf->getHeight();
+  const size_t row_size = sizeof(float) * buf->elem_stride * width;
+  Vector<size_t> params = {(size_t)width, (size_t)height, (size_t)buf->get_num_channels()};
+  params.resize(params.size() + height);
+  MutableSpan<size_t> rows_hashes = params.as_mutable_span().take_back(height);
+  threading::parallel_for(IndexRange(height), 32, [&](const IndexRange rows) {
+    for (const int64_t y : rows) {
+      const float *row = buf->getBuffer() + y * buf->row_stride;
+      rows_hashes[y] = BLI_hash_mm2((const unsigned char *)row, row_size, (uint32_t)y);
+    }
+  });
+
+  return std::make_shared<const ResultKey>(typeid(*op).hash_code(), std::move(params),
+                                           Vector<std::shared_ptr<const ResultKey>>());
+}
+
+/**
+ * Gets the key identifying given operation result across executions. Results of source
+ * operations are identified by their buffer content, so they must have been rendered for their
+ * whole canvas. Keys already in the cache are shared so that dependent keys compare faster.
+ */
+std::shared_ptr<const ResultKey> FullFrameExecutionModel::get_result_key(NodeOperation *op)
+{
+  const std::shared_ptr<const ResultKey> *cached_key = result_keys_.lookup_ptr(op);
+  if (cached_key) {
+    return *cached_key;
+  }
+
+  std::shared_ptr<const ResultKey> result_key;
+  if (op->get_flags().is_constant_operation) {
+    result_key = create_constant_result_key(op);
+  }
+  else if (is_source_operation(op)) {
+    if (active_buffers_.is_operation_rendered(op) &&
+        active_buffers_.is_area_registered(op, op->get_canvas())) {
+      result_key = create_content_result_key(op, active_buffers_.get_rendered_buffer(op));
+    }
+  }
+  else {
+    const int num_inputs = op->getNumberOfInputSockets();
+    Vector<std::shared_ptr<const ResultKey>> inputs_keys;
+    for (int i = 0; i < num_inputs; i++) {
+      std::shared_ptr<const ResultKey> input_key = get_result_key(op->get_input_operation(i));
+      if (!input_key) {
+        break;
+      }
+      inputs_keys.append(std::move(input_key));
+    }
+    if (inputs_keys.size() == num_inputs) {
+      result_key = op->generate_result_key(inputs_keys);
+    }
+  }
+
+  if (result_key) {
+    result_key = result_cache_->get_cached_key(result_key);
+  }
+  result_keys_.add(op, result_key);
+  return result_key;
+}
+
+/**
+ * Moves the buffer of a rendered operation to the result cache when its result can be identified
+ * and is complete. Returns the buffer to use for current execution. When an equal result is
+ * already cached its buffer is used instead, as it may be in use by current execution.
+ */
+MemoryBuffer *FullFrameExecutionModel::cache_result(NodeOperation *op, MemoryBuffer *op_buf)
+{
+  /* Sources are rendered on every execution to identify their results. */
+  if (op_buf->is_a_single_elem() || is_source_operation(op) ||
+      !active_buffers_.is_area_registered(op, op->get_canvas())) {
+    return op_buf;
+  }
+
+  /* A cancelled execution may have skipped work. */
+  const bNodeTree *tree = context_.getbNodeTree();
+  if (tree->test_break(tree->tbh)) {
+    return op_buf;
+  }
+
+  const std::shared_ptr<const ResultKey> result_key = get_result_key(op);
+  if (!result_key) {
+    return op_buf;
+  }
+
+  if (result_cache_->has_result(result_key)) {
+    delete op_buf;
+    MemoryBuffer *cached_buf = result_cache_->get_result(result_key);
+    return new MemoryBuffer(
+        cached_buf->getBuffer(), cached_buf->get_num_channels(), cached_buf->get_rect());
+  }
+
+  MemoryBuffer *shared_buf = new MemoryBuffer(
+      op_buf->getBuffer(), op_buf->get_num_channels(), op_buf->get_rect());
+  result_cache_->add_result(result_key, std::unique_ptr<MemoryBuffer>(op_buf));
+  return shared_buf;
+}
 
+void FullFrameExecutionModel::use_cached_result(NodeOperation *op)
+{
+  MemoryBuffer *cached_buf = result_cache_->get_result(get_result_key(op));
+  /* Buffer memory is owned by the cache. */
+  MemoryBuffer *shared_buf = new MemoryBuffer(
+      cached_buf->getBuffer(), cached_buf->get_num_channels(), cached_buf->get_rect());
+  active_buffers_.set_rendered_buffer(op, std::unique_ptr<MemoryBuffer>(shared_buf));
+  operation_finished(op);
+}
+
+/**
+ * Determines all operations areas needed to render given operation area.
+ */
+void FullFrameExecutionModel::determine_areas_to_render(NodeOperation *op, const rcti &area)
+{
   Vector<std::pair<NodeOperation *, const rcti>> stack;
-  stack.append({output_op, output_area});
+  stack.append({op, area});
   while (stack.size() > 0) {
     std::pair<NodeOperation *, rcti> pair = stack.pop_last();
     NodeOperation *operation = pair.first;
-    const rcti &render_area = pair.second;
-    if (BLI_rcti_is_empty(&render_area) ||
-        active_buffers_.is_area_registered(operation, render_area)) {
+    rcti render_area = pair.second;
+    if (BLI_rcti_is_empty(&render_area)) {
+      continue;
+    }
+
+    if (use_bands_ && (active_buffers_.is_persistent(operation) ||
+                       is_whole_frame_dependent(operation, render_area))) {
+      active_buffers_.set_persistent(operation);
+      render_area = operation->get_canvas();
+    }
+
+    if (active_buffers_.is_area_registered(operation, render_area)) {
       continue;
     }
 
@@ -236,21 +784,21 @@ void FullFrameExecutionModel::determine_areas_to_render(NodeOperation *output_op
 }
 
 /**
- * Determines reads to receive by operations in output operation tree (i.e: Number of dependent
+ * Determines reads to receive by operations in given operation tree (i.e: Number of dependent
  * operations each operation has).
  */
-void FullFrameExecutionModel::determine_reads(NodeOperation *output_op)
+void FullFrameExecutionModel::determine_reads(NodeOperation *op)
 {
-  BLI_assert(output_op->isOutputOperation(context_.isRendering()));
-
   Vector<NodeOperation *> stack;
-  stack.append(output_op);
+  stack.append(op);
   while (stack.size() > 0) {
     NodeOperation *operation = stack.pop_last();
     const int num_inputs = operation->getNumberOfInputSockets();
     for (int i = 0; i < num_inputs; i++) {
       NodeOperation *input_op = operation->get_input_operation(i);
-      if (!active_buffers_.has_registered_reads(input_op)) {
+      /* Inputs of rendered operations kept from previous bands aren't needed anymore. */
+      if (!active_buffers_.has_registered_reads(input_op) &&
+          !active_buffers_.is_operation_rendered(input_op)) {
         stack.append(input_op);
       }
       active_buffers_.register_read(input_op);
@@ -304,15 +852,24 @@ void FullFrameExecutionModel::update_progress_bar()
 {
   const bNodeTree *tree = context_.getbNodeTree();
   if (tree) {
-    const float progress = num_operations_finished_ / static_cast<float>(operations_.size());
-    tree->progress(tree->prh, progress);
-
+    float progress = num_operations_finished_ / static_cast<float>(operations_.size());
     char buf[128];
-    BLI_snprintf(buf,
-                 sizeof(buf),
-                 TIP_("Compositing | Operation %i-%li"),
-                 num_operations_finished_ + 1,
-                 operations_.size());
+    if (num_bands_ > 0) {
+      progress = (num_bands_finished_ + min_ff(progress, 1.0f)) / num_bands_;
+      BLI_snprintf(buf,
+                   sizeof(buf),
+                   TIP_("Compositing | Band %i-%i"),
+                   num_bands_finished_ + 1,
+                   num_bands_);
+    }
+    else {
+      BLI_snprintf(buf,
+                   sizeof(buf),
+                   TIP_("Compositing | Operation %i-%li"),
+                   num_operations_finished_ + 1,
+                   operations_.size());
+    }
+    tree->progress(tree->prh, progress);
     tree->stats_draw(tree->sdh, buf);
   }
 }
@@ -20,6 +20,11 @@
 
 #include "COM_ExecutionModel.h"
 
+#include "BLI_map.hh"
+#include "BLI_vector_set.hh"
+
+#include <memory>
+
 #ifdef WITH_CXX_GUARDEDALLOC
 #  include "MEM_guardedalloc.h"
 #endif
@@ -28,6 +33,8 @@ namespace blender::compositor {
 
 /* Forward declarations. */
 class ExecutionGroup;
+class ResultCache;
+class ResultKey;
 
 /**
  * Fully renders operations in order from inputs to outputs.
@@ -50,6 +57,35 @@ class FullFrameExecutionModel : public ExecutionModel {
    */
   Vector<eCompositorPriority> priorities_;
 
+  /**
+   * Memory limit in bytes for operations buffers, when exceeded outputs are rendered in
+   * horizontal bands. Zero when unlimited.
+   */
+  size_t memory_limit_;
+
+  /**
+   * Whether outputs are rendered in bands, only when the whole frame buffers of their
+   * dependencies would exceed the memory limit.
+   */
+  bool use_bands_;
+
+  /**
+   * Number of bands of the output operations being rendered and how many are finished.
+   */
+  int num_bands_;
+  int num_bands_finished_;
+
+  /**
+   * Cache of operations results kept between executions, null when disabled.
+   */
+  ResultCache *result_cache_;
+
+  /**
+   * Keys identifying operations results across executions, null when an operation result can't
+   * be identified.
+   */
+  Map<NodeOperation *, std::shared_ptr<const ResultKey>> result_keys_;
+
  public:
   FullFrameExecutionModel(CompositorContext &context,
                           SharedOperationBuffers &shared_buffers,
@@ -60,7 +96,23 @@ class FullFrameExecutionModel : public ExecutionModel {
  private:
   void determine_areas_to_render_and_reads();
   void render_operations();
+  void render_operations_in_bands();
+  bool exceeds_memory_limit();
+  size_t get_frame_memory(Span<NodeOperation *> ops);
+  int get_num_bands(Span<NodeOperation *> ops, int area_height);
+  bool is_whole_frame_dependent(NodeOperation *op, const rcti &render_area);
+  void find_whole_frame_dependent_operations(NodeOperation *op,
+                                             const rcti &area,
+                                             Map<NodeOperation *, Vector<rcti>> &visited_areas,
+                                             VectorSet<NodeOperation *> &r_ops);
+  void render_whole_frame(NodeOperation *op);
   void render_output_dependencies(NodeOperation *output_op);
+  void render_operation_dependencies(NodeOperation *op);
+  void render_cached_output_dependencies(NodeOperation *output_op,
+                                         Span<NodeOperation *> dependencies);
+  std::shared_ptr<const ResultKey> get_result_key(NodeOperation *op);
+  MemoryBuffer *cache_result(NodeOperation *op, MemoryBuffer *op_buf);
+  void use_cached_result(NodeOperation *op);
   Vector<MemoryBuffer *> get_input_buffers(NodeOperation *op,
                                            const int output_x,
                                            const int output_y);
@@ -70,8 +122,8 @@ class FullFrameExecutionModel : public ExecutionModel {
   void operation_finished(NodeOperation *operation);
 
   void get_output_render_area(NodeOperation *output_op, rcti &r_area);
-  void determine_areas_to_render(NodeOperation *output_op, const rcti &output_area);
-  void determine_reads(NodeOperation *output_op);
+  void determine_areas_to_render(NodeOperation *op, const rcti &area);
+  void determine_reads(NodeOperation *op);
 
   void update_progress_bar();
 
@@ -23,6 +23,7 @@
 #include "COM_BufferOperation.h"
 #include "COM_ExecutionSystem.h"
 #include "COM_ReadBufferOperation.h"
+#include "COM_ResultCache.h"
 #include "COM_defines.h"
 
 #include "COM_NodeOperation.h" /* own include */
@@ -66,6 +67,7 @@ const float *NodeOperation::get_constant_elem_default(const float *default_elem)
 std::optional<NodeOperationHash> NodeOperation::generate_hash()
 {
   params_hash_ = get_default_hash_2(canvas_.xmin, canvas_.xmax);
+  params_hashes_ = {get_default_hash(canvas_.xmin), get_default_hash(canvas_.xmax)};
 
   /* Hash subclasses params. */
   is_hash_output_params_implemented_ = true;
@@ -109,6 +111,23 @@ std::optional<NodeOperationHash> NodeOperation::generate_hash()
   return hash;
 }
 
+/**
+ * Generate a key that identifies the operation result across executions. Unlike #generate_hash
+ * linked inputs are identified by given keys of their results instead of operation ids, which
+ * are only valid in current execution.
+ * Requires `hash_output_params` to be implemented, otherwise null is returned.
+ */
+std::shared_ptr<const ResultKey> NodeOperation::generate_result_key(
+    Span<std::shared_ptr<const ResultKey>> inputs_keys)
+{
+  BLI_assert(inputs_keys.size() == m_inputs.size());
+  std::optional<NodeOperationHash> hash = generate_hash();
+  if (!hash) {
+    return nullptr;
+  }
+  return std::make_shared<const ResultKey>(hash->type_hash_, params_hashes_, inputs_keys);
+}
+
 NodeOperationOutput *NodeOperation::getOutputSocket(unsigned int index)
 {
   return &m_outputs[index];
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <list>
+#include <memory>
 #include <sstream>
 #include <string>
 
@@ -42,6 +43,7 @@ class OpenCLDevice;
 class ReadBufferOperation;
 class WriteBufferOperation;
 class ExecutionSystem;
+class ResultKey;
 
 class NodeOperation;
 typedef NodeOperation SocketReader;
@@ -320,6 +322,8 @@ class NodeOperation {
   Vector<NodeOperationOutput> m_outputs;
 
   size_t params_hash_;
+  /** Hashes of each parameter, exact for numeric ones. Identify results across executions. */
+  Vector<size_t> params_hashes_;
   bool is_hash_output_params_implemented_;
 
   /**
@@ -394,6 +398,8 @@ class NodeOperation {
   }
 
   std::optional<NodeOperationHash> generate_hash();
+  std::shared_ptr<const ResultKey> generate_result_key(
+      Span<std::shared_ptr<const ResultKey>> inputs_keys);
 
   unsigned int getNumberOfInputSockets() const
   {
@@ -660,16 +666,20 @@ class NodeOperation {
   template<typename T> void hash_param(T param)
   {
     combine_hashes(params_hash_, get_default_hash(param));
+    params_hashes_.append(get_default_hash(param));
   }
 
   template<typename T1, typename T2> void hash_params(T1 param1, T2 param2)
   {
     combine_hashes(params_hash_, get_default_hash_2(param1, param2));
+    params_hashes_.extend({get_default_hash(param1), get_default_hash(param2)});
   }
 
   template<typename T1, typename T2, typename T3> void hash_params(T1 param1, T2 param2, T3 param3)
   {
     combine_hashes(params_hash_, get_default_hash_3(param1, param2, param3));
+    params_hashes_.extend(
+        {get_default_hash(param1), get_default_hash(param2), get_default_hash(param3)});
   }
 
   void addInputSocket(DataType datatype, ResizeMode resize_mode = ResizeMode::Center);
@@ -0,0 +1,119 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2021, Blender Foundation.
+ */
+
+#include "COM_ResultCache.h"
+
+#include "BLI_ghash.h"
+
+namespace blender::compositor {
+
+ResultKey::ResultKey(const size_t type_hash,
+                     Vector<size_t> params,
+                     Vector<std::shared_ptr<const ResultKey>> inputs)
+    : type_hash_(type_hash), params_(std::move(params)), inputs_(std::move(inputs))
+{
+  hash_ = get_default_hash_2(type_hash_, params_.size());
+  for (const size_t param : params_) {
+    hash_ = BLI_ghashutil_combine_hash(hash_, param);
+  }
+  for (const std::shared_ptr<const ResultKey> &input : inputs_) {
+    hash_ = BLI_ghashutil_combine_hash(hash_, input->hash());
+  }
+}
+
+bool ResultKey::operator==(const ResultKey &other) const
+{
+  if (hash_ != other.hash_ || type_hash_ != other.type_hash_ || params_ != other.params_ ||
+      inputs_.size() != other.inputs_.size()) {
+    return false;
+  }
+  for (const int i : inputs_.index_range()) {
+    /* Inputs keys found in the cache are shared, so that most comparisons are by pointer. */
+    if (inputs_[i] != other.inputs_[i] && *inputs_[i] != *other.inputs_[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ResultCache::has_result(const std::shared_ptr<const ResultKey> &key) const
+{
+  return results_.contains(key);
+}
+
+/**
+ * Gets the cached buffer of given result and tags it as used by current execution.
+ */
+MemoryBuffer *ResultCache::get_result(const std::shared_ptr<const ResultKey> &key)
+{
+  CachedResult &result = results_.lookup(key);
+  result.is_used = true;
+  return result.buffer.get();
+}
+
+/**
+ * Adds a result that is not cached yet. Cached buffers may be in use by current execution, so
+ * they are never replaced.
+ */
+void ResultCache::add_result(std::shared_ptr<const ResultKey> key,
+                             std::unique_ptr<MemoryBuffer> buffer)
+{
+  BLI_assert(!has_result(key));
+  CachedResult result;
+  result.buffer = std::move(buffer);
+  result.is_used = true;
+  results_.add(std::move(key), std::move(result));
+}
+
+/**
+ * Gets the instance of an equal key stored in the cache, or given key when there is none. Keys
+ * of dependent results should reference it, so that they compare faster.
+ */
+std::shared_ptr<const ResultKey> ResultCache::get_cached_key(
+    const std::shared_ptr<const ResultKey> &key)
+{
+  const std::shared_ptr<const ResultKey> *cached_key = results_.lookup_key_ptr(key);
+  return cached_key ? *cached_key : key;
+}
+
+/**
+ * Disposes results that were not used since last call. To be called once an execution has
+ * finished, so that buffers of changed operations don't accumulate.
+ */
+void ResultCache::remove_unused_results()
+{
+  using Iter = ResultsMap::MutableItemIterator;
+  Iter begin = results_.items().begin();
+  Iter end = results_.items().end();
+  for (Iter iter = begin; iter != end; ++iter) {
+    CachedResult &result = (*iter).value;
+    if (result.is_used) {
+      result.is_used = false;
+    }
+    else {
+      results_.remove(iter);
+    }
+  }
+}
+
+void ResultCache::clear()
+{
+  results_.clear();
+}
+
+}  // namespace blender::compositor
@@ -0,0 +1,112 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2021, Blender Foundation.
+ */
+
+#pragma once
+
+#include "BLI_map.hh"
+#include "BLI_vector.hh"
+#include "COM_MemoryBuffer.h"
+#ifdef WITH_CXX_GUARDEDALLOC
+#  include "MEM_guardedalloc.h"
+#endif
+#include <memory>
+
+namespace blender::compositor {
+
+/**
+ * Identifies an operation result across executions by the operation type and parameters, and the
+ * keys of its inputs results. Results of operations without inputs are identified by parameters
+ * describing their content.
+ */
+class ResultKey {
+ private:
+  size_t type_hash_;
+  Vector<size_t> params_;
+  Vector<std::shared_ptr<const ResultKey>> inputs_;
+  uint64_t hash_;
+
+ public:
+  ResultKey(size_t type_hash,
+            Vector<size_t> params,
+            Vector<std::shared_ptr<const ResultKey>> inputs);
+
+  uint64_t hash() const
+  {
+    return hash_;
+  }
+
+  bool operator==(const ResultKey &other) const;
+  bool operator!=(const ResultKey &other) const
+  {
+    return !(*this == other);
+  }
+
+#ifdef WITH_CXX_GUARDEDALLOC
+  MEM_CXX_CLASS_ALLOC_FUNCS("COM:ResultKey")
+#endif
+};
+
+/**
+ * Keeps operations rendered buffers across executions so that only operations which result
+ * changed are rendered again. Buffers are identified by the #ResultKey of their operation.
+ * Results not used by an execution are disposed once it finishes.
+ */
+class ResultCache {
+ private:
+  typedef struct CachedResult {
+   public:
+    std::unique_ptr<MemoryBuffer> buffer;
+    bool is_used;
+  } CachedResult;
+
+  struct KeyHash {
+    uint64_t operator()(const std::shared_ptr<const ResultKey> &key) const
+    {
+      return key->hash();
+    }
+  };
+  struct KeyEquality {
+    bool operator()(const std::shared_ptr<const ResultKey> &a,
+                    const std::shared_ptr<const ResultKey> &b) const
+    {
+      return *a == *b;
+    }
+  };
+  using ResultsMap = blender::Map<std::shared_ptr<const ResultKey>,
+                                  CachedResult,
+                                  4,
+                                  DefaultProbingStrategy,
+                                  KeyHash,
+                                  KeyEquality>;
+  ResultsMap results_;
+
+ public:
+  bool has_result(const std::shared_ptr<const ResultKey> &key) const;
+  MemoryBuffer *get_result(const std::shared_ptr<const ResultKey> &key);
+  void add_result(std::shared_ptr<const ResultKey> key, std::unique_ptr<MemoryBuffer> buffer);
+  std::shared_ptr<const ResultKey> get_cached_key(const std::shared_ptr<const ResultKey> &key);
+
+  void remove_unused_results();
+  void clear();
+
+#ifdef WITH_CXX_GUARDEDALLOC
+  MEM_CXX_CLASS_ALLOC_FUNCS("COM:ResultCache")
+#endif
+};
+
+}  // namespace blender::compositor
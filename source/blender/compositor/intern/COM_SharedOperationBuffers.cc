@@ -23,7 +23,11 @@
 namespace blender::compositor {
 
 SharedOperationBuffers::BufferData::BufferData()
-    : buffer(nullptr), registered_reads(0), received_reads(0), is_rendered(false)
+    : buffer(nullptr),
+      registered_reads(0),
+      received_reads(0),
+      is_rendered(false),
+      is_persistent(false)
 {
 }
 
@@ -128,10 +132,62 @@ void SharedOperationBuffers::read_finished(NodeOperation *read_op)
   BufferData &buf_data = get_buffer_data(read_op);
   buf_data.received_reads++;
   BLI_assert(buf_data.received_reads > 0 && buf_data.received_reads <= buf_data.registered_reads);
-  if (buf_data.received_reads == buf_data.registered_reads) {
+  if (buf_data.received_reads == buf_data.registered_reads && !buf_data.is_persistent) {
     /* Dispose buffer. */
     buf_data.buffer = nullptr;
   }
 }
 
+/**
+ * Gets the bounds of all registered areas to render of given operation. Returns false when there
+ * are none.
+ */
+bool SharedOperationBuffers::get_areas_bounds(NodeOperation *op, rcti &r_bounds)
+{
+  Span<rcti> render_areas = get_buffer_data(op).render_areas.as_span();
+  if (render_areas.is_empty()) {
+    return false;
+  }
+  r_bounds = render_areas[0];
+  for (const rcti &area : render_areas.drop_front(1)) {
+    BLI_rcti_union(&r_bounds, &area);
+  }
+  return true;
+}
+
+/**
+ * Marks an operation whose output depends on its whole inputs. Its buffer is rendered once for
+ * the whole canvas and kept for all bands.
+ */
+void SharedOperationBuffers::set_persistent(NodeOperation *op)
+{
+  get_buffer_data(op).is_persistent = true;
+}
+
+bool SharedOperationBuffers::is_persistent(NodeOperation *op)
+{
+  return get_buffer_data(op).is_persistent;
+}
+
+/**
+ * Disposes all buffers and render data of the band that has been rendered, except for rendered
+ * persistent buffers, which only get their reads reset for the next band.
+ */
+void SharedOperationBuffers::clear_band()
+{
+  using Iter = Map<NodeOperation *, BufferData>::MutableItemIterator;
+  Iter begin = buffers_.items().begin();
+  Iter end = buffers_.items().end();
+  for (Iter iter = begin; iter != end; ++iter) {
+    BufferData &buf_data = (*iter).value;
+    if (buf_data.is_persistent && buf_data.is_rendered) {
+      buf_data.registered_reads = 0;
+      buf_data.received_reads = 0;
+    }
+    else {
+      buffers_.remove(iter);
+    }
+  }
+}
+
 }  // namespace blender::compositor
@@ -43,6 +43,8 @@ class SharedOperationBuffers {
     int registered_reads;
     int received_reads;
     bool is_rendered;
+    /** Buffer is kept when rendering in bands, see #clear_band(). */
+    bool is_persistent;
   } BufferData;
   blender::Map<NodeOperation *, BufferData> buffers_;
 
@@ -60,6 +62,11 @@ class SharedOperationBuffers {
 
   void read_finished(NodeOperation *read_op);
 
+  bool get_areas_bounds(NodeOperation *op, rcti &r_bounds);
+  void set_persistent(NodeOperation *op);
+  bool is_persistent(NodeOperation *op);
+  void clear_band();
+
  private:
   BufferData &get_buffer_data(NodeOperation *op);
 
@@ -25,6 +25,7 @@
 
 #include "COM_ExecutionSystem.h"
 #include "COM_MovieDistortionOperation.h"
+#include "COM_ResultCache.h"
 #include "COM_WorkScheduler.h"
 #include "COM_compositor.h"
 #include "clew.h"
@@ -32,6 +33,7 @@
 static struct {
   bool is_initialized = false;
   ThreadMutex mutex;
+  blender::compositor::ResultCache result_cache;
 } g_compositor;
 
 /* Make sure node tree has previews.
@@ -94,11 +96,26 @@ void COM_execute(RenderData *render_data,
   const bool use_opencl = (node_tree->flag & NTREE_COM_OPENCL) != 0;
   blender::compositor::WorkScheduler::initialize(use_opencl, BKE_render_num_threads(render_data));
 
+  blender::compositor::ResultCache *result_cache = nullptr;
+  if (node_tree->flag & NTREE_COM_RESULT_CACHE) {
+    result_cache = &g_compositor.result_cache;
+  }
+  else {
+    g_compositor.result_cache.clear();
+  }
+
   /* Execute. */
   const bool twopass = (node_tree->flag & NTREE_TWO_PASS) && !rendering;
   if (twopass) {
-    blender::compositor::ExecutionSystem fast_pass(
-        render_data, scene, node_tree, rendering, true, viewSettings, displaySettings, viewName);
+    blender::compositor::ExecutionSystem fast_pass(render_data,
+                                                   scene,
+                                                   node_tree,
+                                                   rendering,
+                                                   true,
+                                                   viewSettings,
+                                                   displaySettings,
+                                                   viewName,
+                                                   nullptr);
     fast_pass.execute();
 
     if (node_tree->test_break(node_tree->tbh)) {
@@ -107,8 +124,15 @@ void COM_execute(RenderData *render_data,
     }
   }
 
-  blender::compositor::ExecutionSystem system(
-      render_data, scene, node_tree, rendering, false, viewSettings, displaySettings, viewName);
+  blender::compositor::ExecutionSystem system(render_data,
+                                              scene,
+                                              node_tree,
+                                              rendering,
+                                              false,
+                                              viewSettings,
+                                              displaySettings,
+                                              viewName,
+                                              result_cache);
   system.execute();
 
   BLI_mutex_unlock(&g_compositor.mutex);
@@ -119,6 +143,7 @@ void COM_deinitialize()
   if (g_compositor.is_initialized) {
     BLI_mutex_lock(&g_compositor.mutex);
     blender::compositor::WorkScheduler::deinitialize();
+    g_compositor.result_cache.clear();
     g_compositor.is_initialized = false;
     BLI_mutex_unlock(&g_compositor.mutex);
     BLI_mutex_end(&g_compositor.mutex);
@@ -188,6 +188,19 @@ int BlurBaseOperation::get_blur_size(eDimension dim) const
   return -1;
 }
 
+/**
+ * Hash parameters shared by blur operations, for subclasses that implement
+ * #hash_output_params.
+ */
+void BlurBaseOperation::hash_blur_params()
+{
+  hash_params(m_data.sizex, m_data.sizey, m_data.filtertype);
+  hash_params(m_data.relative, m_data.aspect, (int)m_data.gamma);
+  hash_params(m_data.percentx, m_data.percenty, m_data.fac);
+  hash_params(m_size, m_sizeavailable, use_variable_size_);
+  hash_params(m_extend_bounds, getQuality());
+}
+
 void BlurBaseOperation::updateSize()
 {
   if (this->m_sizeavailable || use_variable_size_) {
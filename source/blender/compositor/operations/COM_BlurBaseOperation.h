@@ -44,6 +44,7 @@ class BlurBaseOperation : public MultiThreadedOperation, public QualityStepHelpe
   float *make_dist_fac_inverse(float rad, int size, int falloff);
 
   void updateSize();
+  void hash_blur_params();
 
   /**
    * Cached reference to the inputProgram
@@ -18,8 +18,10 @@
 
 #include "COM_BokehBlurOperation.h"
 #include "COM_ConstantOperation.h"
+#include "COM_FFTConvolution.h"
 
 #include "BLI_math.h"
+#include "BLI_task.hh"
 #include "COM_OpenCLDevice.h"
 
 #include "RE_pipeline.h"
@@ -31,6 +33,12 @@ constexpr int BOKEH_INPUT_INDEX = 1;
 constexpr int BOUNDING_BOX_INPUT_INDEX = 2;
 constexpr int SIZE_INPUT_INDEX = 3;
 
+/**
+ * Minimum blur radius in pixels from which the image is convolved in frequency domain. Below it
+ * summing bokeh samples per pixel is faster.
+ */
+constexpr int FFT_MIN_PIXEL_SIZE = 16;
+
 BokehBlurOperation::BokehBlurOperation()
 {
   this->addInputSocket(DataType::Color);
@@ -49,6 +57,7 @@ BokehBlurOperation::BokehBlurOperation()
   this->m_inputBoundingBoxReader = nullptr;
 
   this->m_extend_bounds = false;
+  m_fft_blurred = nullptr;
 }
 
 void BokehBlurOperation::init_data()
@@ -324,10 +333,124 @@ void BokehBlurOperation::get_area_of_interest(const int input_idx,
   }
 }
 
+void BokehBlurOperation::update_memory_buffer_started(MemoryBuffer *UNUSED(output),
+                                                      const rcti &area,
+                                                      Span<MemoryBuffer *> inputs)
+{
+  const float max_dim = MAX2(this->getWidth(), this->getHeight());
+  const int pixel_size = m_size * max_dim / 100.0f;
+  /* Frequency domain can't skip samples, lower quality keeps summing every step samples. */
+  if (pixel_size >= FFT_MIN_PIXEL_SIZE && getStep() == 1) {
+    blur_fft(area, inputs);
+  }
+}
+
+/**
+ * Blurs given area convolving the image with the bokeh in frequency domain. Gives the same
+ * result as summing samples per pixel: the bokeh is sampled at the same offsets and each pixel
+ * is normalized by the sum of the bokeh samples that are inside the image, obtained convolving
+ * an image mask.
+ */
+void BokehBlurOperation::blur_fft(const rcti &area, Span<MemoryBuffer *> inputs)
+{
+  const float max_dim = MAX2(this->getWidth(), this->getHeight());
+  const int pixel_size = m_size * max_dim / 100.0f;
+  const float m = m_bokehDimension / pixel_size;
+  const MemoryBuffer *image_input = inputs[IMAGE_INPUT_INDEX];
+  const MemoryBuffer *bokeh_input = inputs[BOKEH_INPUT_INDEX];
+
+  rcti image_area;
+  BLI_rcti_init(&image_area,
+                area.xmin - pixel_size,
+                area.xmax + pixel_size,
+                area.ymin - pixel_size,
+                area.ymax + pixel_size);
+  if (!BLI_rcti_isect(&image_area, &image_input->get_rect(), &image_area)) {
+    return;
+  }
+  MemoryBuffer image(DataType::Color, image_area);
+  image.copy_from(image_input, image_area);
+  MemoryBuffer mask(DataType::Value, image_area);
+  const float one = 1.0f;
+  mask.fill(image_area, &one);
+
+  /* Samples are read in `[-pixel_size, pixel_size)` offsets, kernel center is at `pixel_size`
+   * and it's mirrored. First row and column correspond to the excluded `pixel_size` offset. */
+  const int kernel_size = 2 * pixel_size + 1;
+  rcti kernel_rect;
+  BLI_rcti_init(&kernel_rect, 0, kernel_size, 0, kernel_size);
+  MemoryBuffer kernel(DataType::Color, kernel_rect);
+  kernel.clear();
+  threading::parallel_for(IndexRange(1, kernel_size - 1), 16, [&](const IndexRange rows) {
+    for (const int64_t y : rows) {
+      const float v = m_bokehMidY - (pixel_size - y) * m;
+      for (int x = 1; x < kernel_size; x++) {
+        const float u = m_bokehMidX - (pixel_size - x) * m;
+        bokeh_input->read_elem_checked(u, v, kernel.get_elem(x, y));
+      }
+    }
+  });
+
+  FFTConvolution convolution(kernel_size, kernel_size);
+  for (int ch = 0; ch < COM_DATA_TYPE_COLOR_CHANNELS; ch++) {
+    convolution.add_kernel(kernel, ch);
+  }
+  MemoryBuffer *color_accum = new MemoryBuffer(DataType::Color, area);
+  MemoryBuffer multiplier_accum(DataType::Color, area);
+  color_accum->clear();
+  multiplier_accum.clear();
+  threading::parallel_for(
+      IndexRange(COM_DATA_TYPE_COLOR_CHANNELS * 2), 1, [&](const IndexRange planes) {
+        for (const int64_t plane : planes) {
+          const int ch = plane % COM_DATA_TYPE_COLOR_CHANNELS;
+          if (plane < COM_DATA_TYPE_COLOR_CHANNELS) {
+            convolution.convolve(image, ch, ch, *color_accum, ch);
+          }
+          else {
+            convolution.convolve(mask, 0, ch, multiplier_accum, ch);
+          }
+        }
+      });
+
+  for (BuffersIterator<float> it = color_accum->iterate_with({&multiplier_accum}); !it.is_end();
+       ++it) {
+    const float *multiplier = it.in(0);
+    it.out[0] *= 1.0f / multiplier[0];
+    it.out[1] *= 1.0f / multiplier[1];
+    it.out[2] *= 1.0f / multiplier[2];
+    it.out[3] *= 1.0f / multiplier[3];
+  }
+  m_fft_blurred = color_accum;
+}
+
+void BokehBlurOperation::update_memory_buffer_finished(MemoryBuffer *UNUSED(output),
+                                                       const rcti &UNUSED(area),
+                                                       Span<MemoryBuffer *> UNUSED(inputs))
+{
+  delete m_fft_blurred;
+  m_fft_blurred = nullptr;
+}
+
 void BokehBlurOperation::update_memory_buffer_partial(MemoryBuffer *output,
                                                       const rcti &area,
                                                       Span<MemoryBuffer *> inputs)
 {
+  if (m_fft_blurred) {
+    const MemoryBuffer *image_input = inputs[IMAGE_INPUT_INDEX];
+    for (BuffersIterator<float> it = output->iterate_with(
+             {inputs[BOUNDING_BOX_INPUT_INDEX], m_fft_blurred}, area);
+         !it.is_end();
+         ++it) {
+      if (*it.in(0) > 0.0f) {
+        copy_v4_v4(it.out, it.in(1));
+      }
+      else {
+        image_input->read_elem(it.x, it.y, it.out);
+      }
+    }
+    return;
+  }
+
   const float max_dim = MAX2(this->getWidth(), this->getHeight());
   const int pixel_size = m_size * max_dim / 100.0f;
   const float m = m_bokehDimension / pixel_size;
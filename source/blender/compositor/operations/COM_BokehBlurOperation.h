@@ -37,6 +37,9 @@ class BokehBlurOperation : public MultiThreadedOperation, public QualityStepHelp
   float m_bokehDimension;
   bool m_extend_bounds;
 
+  /** Result of blurring in frequency domain, used instead of summing samples per pixel. */
+  MemoryBuffer *m_fft_blurred;
+
  public:
   BokehBlurOperation();
 
@@ -83,9 +86,18 @@ class BokehBlurOperation : public MultiThreadedOperation, public QualityStepHelp
   void determine_canvas(const rcti &preferred_area, rcti &r_area) override;
 
   void get_area_of_interest(int input_idx, const rcti &output_area, rcti &r_input_area) override;
+  void update_memory_buffer_started(MemoryBuffer *output,
+                                    const rcti &area,
+                                    Span<MemoryBuffer *> inputs) override;
   void update_memory_buffer_partial(MemoryBuffer *output,
                                     const rcti &area,
                                     Span<MemoryBuffer *> inputs) override;
+  void update_memory_buffer_finished(MemoryBuffer *output,
+                                     const rcti &area,
+                                     Span<MemoryBuffer *> inputs) override;
+
+ private:
+  void blur_fft(const rcti &area, Span<MemoryBuffer *> inputs);
 };
 
 }  // namespace blender::compositor
@@ -86,6 +86,11 @@ void BrightnessOperation::executePixelSampled(float output[4],
   }
 }
 
+void BrightnessOperation::hash_output_params()
+{
+  hash_param(m_use_premultiply);
+}
+
 void BrightnessOperation::update_memory_buffer_partial(MemoryBuffer *output,
                                                        const rcti &area,
                                                        Span<MemoryBuffer *> inputs)
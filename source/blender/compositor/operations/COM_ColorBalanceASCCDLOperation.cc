@@ -77,6 +77,13 @@ void ColorBalanceASCCDLOperation::executePixelSampled(float output[4],
   output[3] = inputColor[3];
 }
 
+void ColorBalanceASCCDLOperation::hash_output_params()
+{
+  for (int i = 0; i < 3; i++) {
+    hash_params(m_offset[i], m_power[i], m_slope[i]);
+  }
+}
+
 void ColorBalanceASCCDLOperation::update_memory_buffer_row(PixelCursor &p)
 {
   for (; p.out < p.row_end; p.next()) {
@@ -82,6 +82,13 @@ void ColorBalanceLGGOperation::executePixelSampled(float output[4],
   output[3] = inputColor[3];
 }
 
+void ColorBalanceLGGOperation::hash_output_params()
+{
+  for (int i = 0; i < 3; i++) {
+    hash_params(m_gain[i], m_lift[i], m_gamma_inv[i]);
+  }
+}
+
 void ColorBalanceLGGOperation::update_memory_buffer_row(PixelCursor &p)
 {
   for (; p.out < p.row_end; p.next()) {
@@ -158,6 +158,17 @@ void ColorCorrectionOperation::executePixelSampled(float output[4],
   output[3] = inputImageColor[3];
 }
 
+void ColorCorrectionOperation::hash_output_params()
+{
+  hash_params(m_redChannelEnabled, m_greenChannelEnabled, m_blueChannelEnabled);
+  hash_params(m_data->startmidtones, m_data->endmidtones);
+  for (const ColorCorrectionData *data :
+       {&m_data->master, &m_data->shadows, &m_data->midtones, &m_data->highlights}) {
+    hash_params(data->saturation, data->contrast, data->gamma);
+    hash_params(data->gain, data->lift);
+  }
+}
+
 void ColorCorrectionOperation::update_memory_buffer_row(PixelCursor &p)
 {
   for (; p.out < p.row_end; p.next()) {
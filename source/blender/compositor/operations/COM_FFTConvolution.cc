@@ -0,0 +1,366 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2021, Blender Foundation.
+ */
+
+#include "COM_FFTConvolution.h"
+
+#include "BLI_math_base.h"
+#include "BLI_task.hh"
+
+namespace blender::compositor {
+
+/*
+ *  2D Fast Hartley Transform, used for convolution
+ */
+
+using fREAL = float;
+
+/* Returns next highest power of 2 of x, as well its log2 in L2. */
+static unsigned int nextPow2(unsigned int x, unsigned int *L2)
+{
+  unsigned int pw, x_notpow2 = x & (x - 1);
+  *L2 = 0;
+  while (x >>= 1) {
+    ++(*L2);
+  }
+  pw = 1 << (*L2);
+  if (x_notpow2) {
+    (*L2)++;
+    pw <<= 1;
+  }
+  return pw;
+}
+
+//------------------------------------------------------------------------------
+
+/* From FXT library by Joerg Arndt, faster in order bit-reversal
+ * use: `r = revbin_upd(r, h)` where `h = N>>1`. */
+static unsigned int revbin_upd(unsigned int r, unsigned int h)
+{
+  while (!((r ^= h) & h)) {
+    h >>= 1;
+  }
+  return r;
+}
+//------------------------------------------------------------------------------
+static void FHT(fREAL *data, unsigned int M, unsigned int inverse)
+{
+  double tt, fc, dc, fs, ds, a = M_PI;
+  fREAL t1, t2;
+  int n2, bd, bl, istep, k, len = 1 << M, n = 1;
+
+  int i, j = 0;
+  unsigned int Nh = len >> 1;
+  for (i = 1; i < (len - 1); i++) {
+    j = revbin_upd(j, Nh);
+    if (j > i) {
+      t1 = data[i];
+      data[i] = data[j];
+      data[j] = t1;
+    }
+  }
+
+  do {
+    fREAL *data_n = &data[n];
+
+    istep = n << 1;
+    for (k = 0; k < len; k += istep) {
+      t1 = data_n[k];
+      data_n[k] = data[k] - t1;
+      data[k] += t1;
+    }
+
+    n2 = n >> 1;
+    if (n > 2) {
+      fc = dc = cos(a);
+      fs = ds = sqrt(1.0 - fc * fc);  // sin(a);
+      bd = n - 2;
+      for (bl = 1; bl < n2; bl++) {
+        fREAL *data_nbd = &data_n[bd];
+        fREAL *data_bd = &data[bd];
+        for (k = bl; k < len; k += istep) {
+          t1 = fc * (double)data_n[k] + fs * (double)data_nbd[k];
+          t2 = fs * (double)data_n[k] - fc * (double)data_nbd[k];
+          data_n[k] = data[k] - t1;
+          data_nbd[k] = data_bd[k] - t2;
+          data[k] += t1;
+          data_bd[k] += t2;
+        }
+        tt = fc * dc - fs * ds;
+        fs = fs * dc + fc * ds;
+        fc = tt;
+        bd -= 2;
+      }
+    }
+
+    if (n > 1) {
+      for (k = n2; k < len; k += istep) {
+        t1 = data_n[k];
+        data_n[k] = data[k] - t1;
+        data[k] += t1;
+      }
+    }
+
+    n = istep;
+    a *= 0.5;
+  } while (n < len);
+
+  if (inverse) {
+    fREAL sc = (fREAL)1 / (fREAL)len;
+    for (k = 0; k < len; k++) {
+      data[k] *= sc;
+    }
+  }
+}
+//------------------------------------------------------------------------------
+/* Transforms rows in parallel, M -> log2 of rows width, N -> rows width. */
+static void FHT_rows(
+    fREAL *data, unsigned int M, unsigned int N, unsigned int num_rows, unsigned int inverse)
+{
+  threading::parallel_for(IndexRange(num_rows), 8, [&](const IndexRange rows) {
+    for (const int64_t j : rows) {
+      FHT(&data[N * j], M, inverse);
+    }
+  });
+}
+//------------------------------------------------------------------------------
+/* 2D Fast Hartley Transform, Mx/My -> log2 of width/height,
+ * nzp -> the row where zero pad data starts,
+ * inverse -> see above. */
+static void FHT2D(
+    fREAL *data, unsigned int Mx, unsigned int My, unsigned int nzp, unsigned int inverse)
+{
+  unsigned int i, j, Nx, Ny, maxy;
+
+  Nx = 1 << Mx;
+  Ny = 1 << My;
+
+  /* Rows (forward transform skips 0 pad data). */
+  maxy = inverse ? Ny : nzp;
+  FHT_rows(data, Mx, Nx, maxy, inverse);
+
+  /* Transpose data. */
+  if (Nx == Ny) { /* Square. */
+    for (j = 0; j < Ny; j++) {
+      for (i = j + 1; i < Nx; i++) {
+        unsigned int op = i + (j << Mx), np = j + (i << My);
+        SWAP(fREAL, data[op], data[np]);
+      }
+    }
+  }
+  else { /* Rectangular. */
+    unsigned int k, Nym = Ny - 1, stm = 1 << (Mx + My);
+    for (i = 0; stm > 0; i++) {
+#define PRED(k) (((k & Nym) << Mx) + (k >> My))
+      for (j = PRED(i); j > i; j = PRED(j)) {
+        /* Pass. */
+      }
+      if (j < i) {
+        continue;
+      }
+      for (k = i, j = PRED(i); j != i; k = j, j = PRED(j), stm--) {
+        SWAP(fREAL, data[j], data[k]);
+      }
+#undef PRED
+      stm--;
+    }
+  }
+
+  SWAP(unsigned int, Nx, Ny);
+  SWAP(unsigned int, Mx, My);
+
+  /* Now columns == transposed rows. */
+  FHT_rows(data, Mx, Nx, Ny, inverse);
+
+  /* Finalize, each row is only paired with its mirrored row. */
+  threading::parallel_for(IndexRange((Ny >> 1) + 1), 32, [&](const IndexRange rows) {
+    for (const int64_t j : rows) {
+      unsigned int jm = (Ny - j) & (Ny - 1);
+      unsigned int ji = j << Mx;
+      unsigned int jmi = jm << Mx;
+      for (unsigned int i = 0; i <= (Nx >> 1); i++) {
+        unsigned int im = (Nx - i) & (Nx - 1);
+        fREAL A = data[ji + i];
+        fREAL B = data[jmi + i];
+        fREAL C = data[ji + im];
+        fREAL D = data[jmi + im];
+        fREAL E = (fREAL)0.5 * ((A + D) - (B + C));
+        data[ji + i] = A - E;
+        data[jmi + i] = B + E;
+        data[ji + im] = C + E;
+        data[jmi + im] = D - E;
+      }
+    }
+  });
+}
+
+//------------------------------------------------------------------------------
+
+/* 2D convolution calc, d1 *= d2, M/N - > log2 of width/height. */
+static void fht_convolve(fREAL *d1, const fREAL *d2, unsigned int M, unsigned int N)
+{
+  fREAL a, b;
+  unsigned int i, j, k, L, mj, mL;
+  unsigned int m = 1 << M, n = 1 << N;
+  unsigned int m2 = 1 << (M - 1), n2 = 1 << (N - 1);
+  unsigned int mn2 = m << (N - 1);
+
+  d1[0] *= d2[0];
+  d1[mn2] *= d2[mn2];
+  d1[m2] *= d2[m2];
+  d1[m2 + mn2] *= d2[m2 + mn2];
+  for (i = 1; i < m2; i++) {
+    k = m - i;
+    a = d1[i] * d2[i] - d1[k] * d2[k];
+    b = d1[k] * d2[i] + d1[i] * d2[k];
+    d1[i] = (b + a) * (fREAL)0.5;
+    d1[k] = (b - a) * (fREAL)0.5;
+    a = d1[i + mn2] * d2[i + mn2] - d1[k + mn2] * d2[k + mn2];
+    b = d1[k + mn2] * d2[i + mn2] + d1[i + mn2] * d2[k + mn2];
+    d1[i + mn2] = (b + a) * (fREAL)0.5;
+    d1[k + mn2] = (b - a) * (fREAL)0.5;
+  }
+  for (j = 1; j < n2; j++) {
+    L = n - j;
+    mj = j << M;
+    mL = L << M;
+    a = d1[mj] * d2[mj] - d1[mL] * d2[mL];
+    b = d1[mL] * d2[mj] + d1[mj] * d2[mL];
+    d1[mj] = (b + a) * (fREAL)0.5;
+    d1[mL] = (b - a) * (fREAL)0.5;
+    a = d1[m2 + mj] * d2[m2 + mj] - d1[m2 + mL] * d2[m2 + mL];
+    b = d1[m2 + mL] * d2[m2 + mj] + d1[m2 + mj] * d2[m2 + mL];
+    d1[m2 + mj] = (b + a) * (fREAL)0.5;
+    d1[m2 + mL] = (b - a) * (fREAL)0.5;
+  }
+  for (i = 1; i < m2; i++) {
+    k = m - i;
+    for (j = 1; j < n2; j++) {
+      L = n - j;
+      mj = j << M;
+      mL = L << M;
+      a = d1[i + mj] * d2[i + mj] - d1[k + mL] * d2[k + mL];
+      b = d1[k + mL] * d2[i + mj] + d1[i + mj] * d2[k + mL];
+      d1[i + mj] = (b + a) * (fREAL)0.5;
+      d1[k + mL] = (b - a) * (fREAL)0.5;
+      a = d1[i + mL] * d2[i + mL] - d1[k + mj] * d2[k + mj];
+      b = d1[k + mj] * d2[i + mL] + d1[i + mL] * d2[k + mj];
+      d1[i + mL] = (b + a) * (fREAL)0.5;
+      d1[k + mj] = (b - a) * (fREAL)0.5;
+    }
+  }
+}
+//------------------------------------------------------------------------------
+
+FFTConvolution::FFTConvolution(const int kernel_width, const int kernel_height)
+    : kernel_width_(kernel_width), kernel_height_(kernel_height)
+{
+  /* Convolution result width & height, FFT pow2 required size & log2. */
+  fft_width_ = nextPow2(2 * kernel_width - 1, &log2_width_);
+  fft_height_ = nextPow2(2 * kernel_height - 1, &log2_height_);
+  block_width_ = (fft_width_ + 1) - kernel_width;
+  block_height_ = (fft_height_ + 1) - kernel_height;
+}
+
+/**
+ * Transforms a channel of given kernel buffer, which must have the convolution kernel size.
+ * Returns the index of the kernel to use in #convolve.
+ */
+int FFTConvolution::add_kernel(const MemoryBuffer &kernel, const int channel)
+{
+  BLI_assert(kernel.getWidth() == kernel_width_ && kernel.getHeight() == kernel_height_);
+  Array<float> data(fft_width_ * fft_height_, 0.0f);
+  const rcti &rect = kernel.get_rect();
+  for (int y = 0; y < kernel_height_; y++) {
+    float *fp = &data[y * fft_width_];
+    for (int x = 0; x < kernel_width_; x++) {
+      fp[x] = kernel.get_value(rect.xmin + x, rect.ymin + y, channel);
+    }
+  }
+  FHT2D(data.data(), log2_width_, log2_height_, kernel_height_, 0);
+  kernels_.append(std::move(data));
+  return kernels_.size() - 1;
+}
+
+/**
+ * Convolves a channel of `src` with given kernel adding the result to a channel of `dst`, only
+ * where `dst` rect overlaps. Pixels outside `src` rect are considered zero. Transforms are
+ * multi-threaded, callers may convolve several channels in parallel too.
+ */
+void FFTConvolution::convolve(const MemoryBuffer &src,
+                              const int src_channel,
+                              const int kernel_index,
+                              MemoryBuffer &dst,
+                              const int dst_channel) const
+{
+  const rcti &rect = src.get_rect();
+  const rcti &dst_rect = dst.get_rect();
+  const int width = BLI_rcti_size_x(&rect);
+  const int height = BLI_rcti_size_y(&rect);
+  const int half_width = kernel_width_ >> 1;
+  const int half_height = kernel_height_ >> 1;
+  const float *kernel = kernels_[kernel_index].data();
+
+  /* Block add-overlap. */
+  Array<float> data(fft_width_ * fft_height_);
+  const int num_blocks_x = divide_ceil_u(width, block_width_);
+  const int num_blocks_y = divide_ceil_u(height, block_height_);
+  for (int block_y = 0; block_y < num_blocks_y; block_y++) {
+    for (int block_x = 0; block_x < num_blocks_x; block_x++) {
+      const int block_xmin = block_x * block_width_;
+      const int block_ymin = block_y * block_height_;
+      const int block_width = min_ii(block_width_, width - block_xmin);
+      const int block_height = min_ii(block_height_, height - block_ymin);
+
+      data.fill(0.0f);
+      for (int y = 0; y < block_height; y++) {
+        float *fp = &data[y * fft_width_];
+        const float *elem = src.get_elem(rect.xmin + block_xmin, rect.ymin + block_ymin + y);
+        for (int x = 0; x < block_width; x++, elem += src.elem_stride) {
+          fp[x] = elem[src_channel];
+        }
+      }
+
+      /* Forward FHT, zero pad data starts after block height. */
+      FHT2D(data.data(), log2_width_, log2_height_, block_height, 0);
+
+      /* FHT2D transposed data, row/col now swapped
+       * convolve & inverse FHT. */
+      fht_convolve(data.data(), kernel, log2_height_, log2_width_);
+      FHT2D(data.data(), log2_height_, log2_width_, 0, 1);
+      /* Data again transposed, so in order again. */
+
+      /* Overlap-add result. */
+      for (int y = 0; y < fft_height_; y++) {
+        const int yy = rect.ymin + block_ymin + y - half_height;
+        if ((yy < dst_rect.ymin) || (yy >= dst_rect.ymax)) {
+          continue;
+        }
+        const float *fp = &data[y * fft_width_];
+        for (int x = 0; x < fft_width_; x++) {
+          const int xx = rect.xmin + block_xmin + x - half_width;
+          if ((xx < dst_rect.xmin) || (xx >= dst_rect.xmax)) {
+            continue;
+          }
+          dst.get_elem(xx, yy)[dst_channel] += fp[x];
+        }
+      }
+    }
+  }
+}
+
+}  // namespace blender::compositor
@@ -0,0 +1,66 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2021, Blender Foundation.
+ */
+
+#pragma once
+
+#include "BLI_array.hh"
+#include "BLI_vector.hh"
+
+#include "COM_MemoryBuffer.h"
+
+namespace blender::compositor {
+
+/**
+ * Convolves images with kernels using the 2D fast Hartley transform, so that the cost per pixel
+ * doesn't depend on the kernel size. Images are processed in blocks of about the kernel size
+ * which results are overlap-added. Kernels are transformed once and reused for every block and
+ * convolution.
+ *
+ * The kernel center is at `(kernel_width / 2, kernel_height / 2)`, so that
+ * `dst(x, y) = sum(kernel(i, j) * src(x + kernel_width / 2 - i, y + kernel_height / 2 - j))`.
+ */
+class FFTConvolution {
+ private:
+  int kernel_width_;
+  int kernel_height_;
+  /** Size of the transforms, powers of 2, and their log2. */
+  int fft_width_;
+  int fft_height_;
+  unsigned int log2_width_;
+  unsigned int log2_height_;
+  /** Size of the image blocks convolved at once. */
+  int block_width_;
+  int block_height_;
+  Vector<Array<float>> kernels_;
+
+ public:
+  FFTConvolution(int kernel_width, int kernel_height);
+
+  int add_kernel(const MemoryBuffer &kernel, int channel);
+  void convolve(const MemoryBuffer &src,
+                int src_channel,
+                int kernel_index,
+                MemoryBuffer &dst,
+                int dst_channel) const;
+
+#ifdef WITH_CXX_GUARDEDALLOC
+  MEM_CXX_CLASS_ALLOC_FUNCS("COM:FFTConvolution")
+#endif
+};
+
+}  // namespace blender::compositor
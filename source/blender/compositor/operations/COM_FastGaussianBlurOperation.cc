@@ -16,8 +16,8 @@
  * Copyright 2011, Blender Foundation.
  */
 
-#include <climits>
-
+#include "BLI_array.hh"
+#include "BLI_task.hh"
 #include "BLI_utildefines.h"
 #include "COM_FastGaussianBlurOperation.h"
 #include "MEM_guardedalloc.h"
@@ -92,25 +92,18 @@ void *FastGaussianBlurOperation::initializeTileData(rcti *rect)
     MemoryBuffer *copy = new MemoryBuffer(*newBuf);
     updateSize();
 
-    int c;
     this->m_sx = this->m_data.sizex * this->m_size / 2.0f;
     this->m_sy = this->m_data.sizey * this->m_size / 2.0f;
 
     if ((this->m_sx == this->m_sy) && (this->m_sx > 0.0f)) {
-      for (c = 0; c < COM_DATA_TYPE_COLOR_CHANNELS; c++) {
-        IIR_gauss(copy, this->m_sx, c, 3);
-      }
+      IIR_gauss_channels(copy, this->m_sx, COM_DATA_TYPE_COLOR_CHANNELS, 3);
     }
     else {
       if (this->m_sx > 0.0f) {
-        for (c = 0; c < COM_DATA_TYPE_COLOR_CHANNELS; c++) {
-          IIR_gauss(copy, this->m_sx, c, 1);
-        }
+        IIR_gauss_channels(copy, this->m_sx, COM_DATA_TYPE_COLOR_CHANNELS, 1);
       }
       if (this->m_sy > 0.0f) {
-        for (c = 0; c < COM_DATA_TYPE_COLOR_CHANNELS; c++) {
-          IIR_gauss(copy, this->m_sy, c, 2);
-        }
+        IIR_gauss_channels(copy, this->m_sy, COM_DATA_TYPE_COLOR_CHANNELS, 2);
       }
     }
     this->m_iirgaus = copy;
@@ -119,44 +112,23 @@ void *FastGaussianBlurOperation::initializeTileData(rcti *rect)
   return this->m_iirgaus;
 }
 
-void FastGaussianBlurOperation::IIR_gauss(MemoryBuffer *src,
-                                          float sigma,
-                                          unsigned int chan,
-                                          unsigned int xy)
-{
-  BLI_assert(!src->is_a_single_elem());
-  double q, q2, sc, cf[4], tsM[9], tsu[3], tsv[3];
-  double *X, *Y, *W;
-  const unsigned int src_width = src->getWidth();
-  const unsigned int src_height = src->getHeight();
-  unsigned int x, y, sz;
-  unsigned int i;
-  float *buffer = src->getBuffer();
-  const uint8_t num_channels = src->get_num_channels();
-
-  /* <0.5 not valid, though can have a possibly useful sort of sharpening effect. */
-  if (sigma < 0.5f) {
-    return;
-  }
-
-  if ((xy < 1) || (xy > 3)) {
-    xy = 3;
-  }
+/**
+ * Coefficients of the recursive gaussian filter, see "Recursive Gabor Filtering" by
+ * Young/VanVliet.
+ */
+struct IIRGaussCoefficients {
+  double cf[4];
+  /** Triggs/Sdika border corrections matrix. */
+  double tsM[9];
+};
 
-  /* XXX The YVV macro defined below explicitly expects sources of at least 3x3 pixels,
-   *     so just skipping blur along faulty direction if src's def is below that limit! */
-  if (src_width < 3) {
-    xy &= ~1;
-  }
-  if (src_height < 3) {
-    xy &= ~2;
-  }
-  if (xy < 1) {
-    return;
-  }
+static void IIR_gauss_coefficients(const float sigma, IIRGaussCoefficients &r_coefs)
+{
+  double q, q2, sc;
+  double *cf = r_coefs.cf;
+  double *tsM = r_coefs.tsM;
 
-  /* See "Recursive Gabor Filtering" by Young/VanVliet
-   * all factors here in double-precision.
+  /* All factors here in double-precision.
    * Required, because for single-precision floating point seems to blow up if `sigma > ~200`. */
   if (sigma >= 3.556f) {
     q = 0.9804f * (sigma - 3.556f) + 2.5091f;
@@ -193,76 +165,186 @@ void FastGaussianBlurOperation::IIR_gauss(MemoryBuffer *src,
   tsM[7] = sc * (cf[1] * cf[2] + cf[3] * cf[2] * cf[2] - cf[1] * cf[3] * cf[3] -
                  cf[3] * cf[3] * cf[3] - cf[3] * cf[2] + cf[3]);
   tsM[8] = sc * (cf[3] * (cf[1] + cf[3] * cf[2]));
+}
 
-#define YVV(L) \
-  { \
-    W[0] = cf[0] * X[0] + cf[1] * X[0] + cf[2] * X[0] + cf[3] * X[0]; \
-    W[1] = cf[0] * X[1] + cf[1] * W[0] + cf[2] * X[0] + cf[3] * X[0]; \
-    W[2] = cf[0] * X[2] + cf[1] * W[1] + cf[2] * W[0] + cf[3] * X[0]; \
-    for (i = 3; i < L; i++) { \
-      W[i] = cf[0] * X[i] + cf[1] * W[i - 1] + cf[2] * W[i - 2] + cf[3] * W[i - 3]; \
-    } \
-    tsu[0] = W[L - 1] - X[L - 1]; \
-    tsu[1] = W[L - 2] - X[L - 1]; \
-    tsu[2] = W[L - 3] - X[L - 1]; \
-    tsv[0] = tsM[0] * tsu[0] + tsM[1] * tsu[1] + tsM[2] * tsu[2] + X[L - 1]; \
-    tsv[1] = tsM[3] * tsu[0] + tsM[4] * tsu[1] + tsM[5] * tsu[2] + X[L - 1]; \
-    tsv[2] = tsM[6] * tsu[0] + tsM[7] * tsu[1] + tsM[8] * tsu[2] + X[L - 1]; \
-    Y[L - 1] = cf[0] * W[L - 1] + cf[1] * tsv[0] + cf[2] * tsv[1] + cf[3] * tsv[2]; \
-    Y[L - 2] = cf[0] * W[L - 2] + cf[1] * Y[L - 1] + cf[2] * tsv[0] + cf[3] * tsv[1]; \
-    Y[L - 3] = cf[0] * W[L - 3] + cf[1] * Y[L - 2] + cf[2] * Y[L - 1] + cf[3] * tsv[0]; \
-    /* 'i != UINT_MAX' is really 'i >= 0', but necessary for unsigned int wrapping */ \
-    for (i = L - 4; i != UINT_MAX; i--) { \
-      Y[i] = cf[0] * W[i] + cf[1] * Y[i + 1] + cf[2] * Y[i + 2] + cf[3] * Y[i + 3]; \
-    } \
-  } \
-  (void)0
-
-  /* Intermediate buffers. */
-  sz = MAX2(src_width, src_height);
-  X = (double *)MEM_callocN(sz * sizeof(double), "IIR_gauss X buf");
-  Y = (double *)MEM_callocN(sz * sizeof(double), "IIR_gauss Y buf");
-  W = (double *)MEM_callocN(sz * sizeof(double), "IIR_gauss W buf");
-  if (xy & 1) { /* H. */
-    int offset;
-    for (y = 0; y < src_height; y++) {
-      const int yx = y * src_width;
-      offset = yx * num_channels + chan;
-      for (x = 0; x < src_width; x++) {
-        X[x] = buffer[offset];
-        offset += num_channels;
-      }
-      YVV(src_width);
-      offset = yx * num_channels + chan;
-      for (x = 0; x < src_width; x++) {
-        buffer[offset] = Y[x];
-        offset += num_channels;
-      }
+/**
+ * Filters a line of `len` elements of `N` interleaved channels from `X` into `Y`, forward pass
+ * results are stored in `W`. Channels are filtered together so that the inner loops can be
+ * vectorized.
+ */
+template<int N>
+static void IIR_gauss_line(
+    const IIRGaussCoefficients &coefs, const double *X, double *W, double *Y, const int len)
+{
+  const double *cf = coefs.cf;
+  const double *tsM = coefs.tsM;
+  const double *X_last = X + (len - 1) * N;
+  double tsu[3][N], tsv[3][N];
+
+  for (int c = 0; c < N; c++) {
+    W[c] = cf[0] * X[c] + cf[1] * X[c] + cf[2] * X[c] + cf[3] * X[c];
+    W[N + c] = cf[0] * X[N + c] + cf[1] * W[c] + cf[2] * X[c] + cf[3] * X[c];
+    W[2 * N + c] = cf[0] * X[2 * N + c] + cf[1] * W[N + c] + cf[2] * W[c] + cf[3] * X[c];
+  }
+  for (int i = 3; i < len; i++) {
+    double *w = W + i * N;
+    const double *x = X + i * N;
+    for (int c = 0; c < N; c++) {
+      w[c] = cf[0] * x[c] + cf[1] * w[c - N] + cf[2] * w[c - 2 * N] + cf[3] * w[c - 3 * N];
     }
   }
-  if (xy & 2) { /* V. */
-    int offset;
-    const int add = src_width * num_channels;
-
-    for (x = 0; x < src_width; x++) {
-      offset = x * num_channels + chan;
-      for (y = 0; y < src_height; y++) {
-        X[y] = buffer[offset];
-        offset += add;
+
+  for (int c = 0; c < N; c++) {
+    tsu[0][c] = W[(len - 1) * N + c] - X_last[c];
+    tsu[1][c] = W[(len - 2) * N + c] - X_last[c];
+    tsu[2][c] = W[(len - 3) * N + c] - X_last[c];
+    tsv[0][c] = tsM[0] * tsu[0][c] + tsM[1] * tsu[1][c] + tsM[2] * tsu[2][c] + X_last[c];
+    tsv[1][c] = tsM[3] * tsu[0][c] + tsM[4] * tsu[1][c] + tsM[5] * tsu[2][c] + X_last[c];
+    tsv[2][c] = tsM[6] * tsu[0][c] + tsM[7] * tsu[1][c] + tsM[8] * tsu[2][c] + X_last[c];
+  }
+  double *Y1 = Y + (len - 1) * N;
+  double *Y2 = Y + (len - 2) * N;
+  double *Y3 = Y + (len - 3) * N;
+  for (int c = 0; c < N; c++) {
+    Y1[c] = cf[0] * W[(len - 1) * N + c] + cf[1] * tsv[0][c] + cf[2] * tsv[1][c] +
+            cf[3] * tsv[2][c];
+    Y2[c] = cf[0] * W[(len - 2) * N + c] + cf[1] * Y1[c] + cf[2] * tsv[0][c] + cf[3] * tsv[1][c];
+    Y3[c] = cf[0] * W[(len - 3) * N + c] + cf[1] * Y2[c] + cf[2] * Y1[c] + cf[3] * tsv[0][c];
+  }
+  for (int i = len - 4; i >= 0; i--) {
+    double *y = Y + i * N;
+    const double *w = W + i * N;
+    for (int c = 0; c < N; c++) {
+      y[c] = cf[0] * w[c] + cf[1] * y[c + N] + cf[2] * y[c + 2 * N] + cf[3] * y[c + 3 * N];
+    }
+  }
+}
+
+/**
+ * Filters channels `[chan, chan + N)` of the buffer lines in given direction. Lines are filtered
+ * in parallel.
+ */
+template<int N>
+static void IIR_gauss_lines(MemoryBuffer *src,
+                            const IIRGaussCoefficients &coefs,
+                            const unsigned int chan,
+                            const bool vertical)
+{
+  const int width = src->getWidth();
+  const int height = src->getHeight();
+  const int len = vertical ? height : width;
+  const int num_lines = vertical ? width : height;
+  const int elem_stride = src->elem_stride;
+  const int line_stride = vertical ? elem_stride : src->row_stride;
+  const int step = vertical ? src->row_stride : elem_stride;
+  float *buffer = src->getBuffer() + chan;
+
+  threading::parallel_for(IndexRange(num_lines), 8, [&](const IndexRange lines) {
+    Array<double> X(len * N);
+    Array<double> W(len * N);
+    Array<double> Y(len * N);
+    for (const int64_t line : lines) {
+      float *line_start = buffer + line * line_stride;
+      const float *in = line_start;
+      for (int i = 0; i < len; i++, in += step) {
+        for (int c = 0; c < N; c++) {
+          X[i * N + c] = in[c];
+        }
       }
-      YVV(src_height);
-      offset = x * num_channels + chan;
-      for (y = 0; y < src_height; y++) {
-        buffer[offset] = Y[y];
-        offset += add;
+
+      IIR_gauss_line<N>(coefs, X.data(), W.data(), Y.data(), len);
+
+      float *out = line_start;
+      for (int i = 0; i < len; i++, out += step) {
+        for (int c = 0; c < N; c++) {
+          out[c] = Y[i * N + c];
+        }
       }
     }
+  });
+}
+
+template<int N>
+static void IIR_gauss_channel_range(MemoryBuffer *src,
+                                    const float sigma,
+                                    const unsigned int chan,
+                                    unsigned int xy)
+{
+  BLI_assert(!src->is_a_single_elem());
+  BLI_assert(chan + N <= src->get_num_channels());
+
+  /* <0.5 not valid, though can have a possibly useful sort of sharpening effect. */
+  if (sigma < 0.5f) {
+    return;
+  }
+
+  if ((xy < 1) || (xy > 3)) {
+    xy = 3;
   }
 
-  MEM_freeN(X);
-  MEM_freeN(W);
-  MEM_freeN(Y);
-#undef YVV
+  /* XXX The line filter explicitly expects sources of at least 3x3 pixels,
+   *     so just skipping blur along faulty direction if src's def is below that limit! */
+  if (src->getWidth() < 3) {
+    xy &= ~1;
+  }
+  if (src->getHeight() < 3) {
+    xy &= ~2;
+  }
+  if (xy < 1) {
+    return;
+  }
+
+  IIRGaussCoefficients coefs;
+  IIR_gauss_coefficients(sigma, coefs);
+
+  if (xy & 1) { /* H. */
+    IIR_gauss_lines<N>(src, coefs, chan, false);
+  }
+  if (xy & 2) { /* V. */
+    IIR_gauss_lines<N>(src, coefs, chan, true);
+  }
+}
+
+/**
+ * Recursive gaussian blur of a buffer channel, cost per pixel doesn't depend on sigma.
+ * `xy` is a bit mask of the directions to blur: 1 horizontal, 2 vertical.
+ */
+void FastGaussianBlurOperation::IIR_gauss(MemoryBuffer *src,
+                                          float sigma,
+                                          unsigned int chan,
+                                          unsigned int xy)
+{
+  IIR_gauss_channel_range<1>(src, sigma, chan, xy);
+}
+
+/**
+ * Same as #IIR_gauss for the first `num_channels` channels at once, which is faster than
+ * blurring each channel separately.
+ */
+void FastGaussianBlurOperation::IIR_gauss_channels(MemoryBuffer *src,
+                                                   float sigma,
+                                                   unsigned int num_channels,
+                                                   unsigned int xy)
+{
+  switch (num_channels) {
+    case 1:
+      IIR_gauss_channel_range<1>(src, sigma, 0, xy);
+      break;
+    case 2:
+      IIR_gauss_channel_range<2>(src, sigma, 0, xy);
+      break;
+    case 3:
+      IIR_gauss_channel_range<3>(src, sigma, 0, xy);
+      break;
+    case 4:
+      IIR_gauss_channel_range<4>(src, sigma, 0, xy);
+      break;
+    default:
+      for (unsigned int c = 0; c < num_channels; c++) {
+        IIR_gauss(src, sigma, c, xy);
+      }
+      break;
+  }
 }
 
 void FastGaussianBlurOperation::get_area_of_interest(const int input_idx,
@@ -283,8 +365,7 @@ void FastGaussianBlurOperation::update_memory_buffer_started(MemoryBuffer *outpu
                                                              const rcti &area,
                                                              Span<MemoryBuffer *> inputs)
 {
-  /* TODO(manzanilla): Add a render test and make #IIR_gauss multi-threaded with support for
-   * an output buffer. */
+  /* TODO(manzanilla): Add a render test and make #IIR_gauss support an output buffer. */
   const MemoryBuffer *input = inputs[IMAGE_INPUT_INDEX];
   MemoryBuffer *image = nullptr;
   const bool is_full_output = BLI_rcti_compare(&output->get_rect(), &area);
@@ -297,20 +378,14 @@ void FastGaussianBlurOperation::update_memory_buffer_started(MemoryBuffer *outpu
   image->copy_from(input, area);
 
   if ((this->m_sx == this->m_sy) && (this->m_sx > 0.0f)) {
-    for (const int c : IndexRange(COM_DATA_TYPE_COLOR_CHANNELS)) {
-      IIR_gauss(image, this->m_sx, c, 3);
-    }
+    IIR_gauss_channels(image, this->m_sx, COM_DATA_TYPE_COLOR_CHANNELS, 3);
   }
   else {
     if (this->m_sx > 0.0f) {
-      for (const int c : IndexRange(COM_DATA_TYPE_COLOR_CHANNELS)) {
-        IIR_gauss(image, this->m_sx, c, 1);
-      }
+      IIR_gauss_channels(image, this->m_sx, COM_DATA_TYPE_COLOR_CHANNELS, 1);
     }
     if (this->m_sy > 0.0f) {
-      for (const int c : IndexRange(COM_DATA_TYPE_COLOR_CHANNELS)) {
-        IIR_gauss(image, this->m_sy, c, 2);
-      }
+      IIR_gauss_channels(image, this->m_sy, COM_DATA_TYPE_COLOR_CHANNELS, 2);
     }
   }
 
@@ -37,6 +37,10 @@ class FastGaussianBlurOperation : public BlurBaseOperation {
   void executePixel(float output[4], int x, int y, void *data) override;
 
   static void IIR_gauss(MemoryBuffer *src, float sigma, unsigned int channel, unsigned int xy);
+  static void IIR_gauss_channels(MemoryBuffer *src,
+                                 float sigma,
+                                 unsigned int num_channels,
+                                 unsigned int xy);
   void *initializeTileData(rcti *rect) override;
   void init_data() override;
   void deinitExecution() override;
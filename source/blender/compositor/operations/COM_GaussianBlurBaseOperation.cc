@@ -91,6 +91,12 @@ void GaussianBlurBaseOperation::get_area_of_interest(const int input_idx,
   }
 }
 
+void GaussianBlurBaseOperation::hash_output_params()
+{
+  hash_blur_params();
+  hash_param(dimension_);
+}
+
 void GaussianBlurBaseOperation::update_memory_buffer_partial(MemoryBuffer *output,
                                                              const rcti &area,
                                                              Span<MemoryBuffer *> inputs)
@@ -71,6 +71,11 @@ void InvertOperation::deinitExecution()
   this->m_inputColorProgram = nullptr;
 }
 
+void InvertOperation::hash_output_params()
+{
+  hash_params(m_color, m_alpha);
+}
+
 void InvertOperation::update_memory_buffer_partial(MemoryBuffer *output,
                                                    const rcti &area,
                                                    Span<MemoryBuffer *> inputs)
@@ -0,0 +1,101 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2021, Blender Foundation.
+ */
+
+#include "testing/testing.h"
+
+#include "COM_FFTConvolution.h"
+
+namespace blender::compositor::tests {
+
+static void fill_pattern(MemoryBuffer &buf)
+{
+  const rcti &rect = buf.get_rect();
+  for (int y = rect.ymin; y < rect.ymax; y++) {
+    for (int x = rect.xmin; x < rect.xmax; x++) {
+      float *elem = buf.get_elem(x, y);
+      for (int ch = 0; ch < buf.get_num_channels(); ch++) {
+        elem[ch] = ((x * 7 + y * 13 + ch * 5) % 17) / 17.0f;
+      }
+    }
+  }
+}
+
+/* Direct convolution with the same conventions as #FFTConvolution. */
+static float convolve_pixel(
+    const MemoryBuffer &src, int src_channel, const MemoryBuffer &kernel, int channel, int x, int y)
+{
+  const rcti &src_rect = src.get_rect();
+  const int half_width = kernel.getWidth() >> 1;
+  const int half_height = kernel.getHeight() >> 1;
+  float sum = 0.0f;
+  for (int j = 0; j < kernel.getHeight(); j++) {
+    for (int i = 0; i < kernel.getWidth(); i++) {
+      const int src_x = x + half_width - i;
+      const int src_y = y + half_height - j;
+      if (src_x >= src_rect.xmin && src_x < src_rect.xmax && src_y >= src_rect.ymin &&
+          src_y < src_rect.ymax) {
+        sum += kernel.get_value(i, j, channel) * src.get_value(src_x, src_y, src_channel);
+      }
+    }
+  }
+  return sum;
+}
+
+static void test_convolution(const rcti &src_rect, const rcti &dst_rect, int kernel_size)
+{
+  MemoryBuffer src(DataType::Color, src_rect);
+  fill_pattern(src);
+  rcti kernel_rect;
+  BLI_rcti_init(&kernel_rect, 0, kernel_size, 0, kernel_size);
+  MemoryBuffer kernel(DataType::Vector, kernel_rect);
+  fill_pattern(kernel);
+
+  FFTConvolution convolution(kernel_size, kernel_size);
+  EXPECT_EQ(convolution.add_kernel(kernel, 0), 0);
+  EXPECT_EQ(convolution.add_kernel(kernel, 2), 1);
+  MemoryBuffer dst(DataType::Vector, dst_rect);
+  dst.clear();
+  convolution.convolve(src, 3, 1, dst, 1);
+
+  for (int y = dst_rect.ymin; y < dst_rect.ymax; y++) {
+    for (int x = dst_rect.xmin; x < dst_rect.xmax; x++) {
+      EXPECT_EQ(dst.get_value(x, y, 0), 0.0f);
+      EXPECT_NEAR(dst.get_value(x, y, 1), convolve_pixel(src, 3, kernel, 2, x, y), 1e-3f);
+      EXPECT_EQ(dst.get_value(x, y, 2), 0.0f);
+    }
+  }
+}
+
+TEST(FFTConvolution, convolve)
+{
+  rcti rect;
+  BLI_rcti_init(&rect, 0, 40, 0, 30);
+  test_convolution(rect, rect, 5);
+  test_convolution(rect, rect, 8);
+}
+
+TEST(FFTConvolution, convolve_offset_areas)
+{
+  rcti src_rect;
+  BLI_rcti_init(&src_rect, 10, 45, -5, 27);
+  rcti dst_rect;
+  BLI_rcti_init(&dst_rect, 2, 30, 20, 40);
+  test_convolution(src_rect, dst_rect, 7);
+}
+
+}  // namespace blender::compositor::tests
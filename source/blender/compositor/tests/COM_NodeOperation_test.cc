@@ -19,6 +19,7 @@
 #include "testing/testing.h"
 
 #include "COM_ConstantOperation.h"
+#include "COM_ResultCache.h"
 
 namespace blender::compositor::tests {
 
@@ -166,4 +167,58 @@ TEST(NodeOperation, generate_hash)
   }
 }
 
+TEST(NodeOperation, generate_result_key)
+{
+  NonHashedOperation input_op1(1);
+  NonHashedOperation input_op2(2);
+  EXPECT_EQ(input_op1.generate_result_key({}), nullptr);
+
+  /* Inputs are identified by their results keys instead of their ids. */
+  std::shared_ptr<const ResultKey> input_key1 = std::make_shared<const ResultKey>(
+      1, Vector<size_t>({10}), Vector<std::shared_ptr<const ResultKey>>());
+  std::shared_ptr<const ResultKey> input_key2 = std::make_shared<const ResultKey>(
+      1, Vector<size_t>({10}), Vector<std::shared_ptr<const ResultKey>>());
+  std::shared_ptr<const ResultKey> input_key3 = std::make_shared<const ResultKey>(
+      1, Vector<size_t>({11}), Vector<std::shared_ptr<const ResultKey>>());
+  EXPECT_EQ(*input_key1, *input_key2);
+  EXPECT_NE(*input_key1, *input_key3);
+
+  HashedOperation op1(input_op1, 6, 4);
+  HashedOperation op2(input_op2, 6, 4);
+  std::shared_ptr<const ResultKey> key1 = op1.generate_result_key({input_key1});
+  ASSERT_NE(key1, nullptr);
+  EXPECT_EQ(*key1, *op2.generate_result_key({input_key1}));
+  EXPECT_EQ(*key1, *op2.generate_result_key({input_key2}));
+  EXPECT_NE(*key1, *op2.generate_result_key({input_key3}));
+
+  op2.set_param1(-1);
+  EXPECT_NE(*key1, *op2.generate_result_key({input_key1}));
+
+  HashedOperation op3(input_op1, 11, 14);
+  EXPECT_NE(*key1, *op3.generate_result_key({input_key1}));
+}
+
+TEST(ResultCache, add_result)
+{
+  ResultCache cache;
+  std::shared_ptr<const ResultKey> key1 = std::make_shared<const ResultKey>(
+      1, Vector<size_t>({10}), Vector<std::shared_ptr<const ResultKey>>());
+  std::shared_ptr<const ResultKey> key2 = std::make_shared<const ResultKey>(
+      1, Vector<size_t>({10}), Vector<std::shared_ptr<const ResultKey>>());
+  EXPECT_FALSE(cache.has_result(key1));
+  EXPECT_EQ(cache.get_cached_key(key2), key2);
+
+  rcti rect;
+  BLI_rcti_init(&rect, 0, 2, 0, 2);
+  cache.add_result(key1, std::make_unique<MemoryBuffer>(DataType::Value, rect));
+  EXPECT_TRUE(cache.has_result(key2));
+  EXPECT_EQ(cache.get_cached_key(key2), key1);
+
+  /* Results used by an execution are kept. */
+  cache.remove_unused_results();
+  EXPECT_TRUE(cache.has_result(key1));
+  cache.remove_unused_results();
+  EXPECT_FALSE(cache.has_result(key1));
+}
+
 }  // namespace blender::compositor::tests
@@ -22,6 +22,9 @@
  * \brief higher level node drawing for the node editor.
  */
 
+#include <chrono>
+#include <optional>
+
 #include "MEM_guardedalloc.h"
 
 #include "DNA_light_types.h"
@@ -1573,6 +1576,67 @@ static void node_add_error_message_button(
   UI_block_emboss_set(node.block, UI_EMBOSS);
 }
 
+static std::optional<std::chrono::nanoseconds> node_get_execution_time(const SpaceNode &snode,
+                                                                      const bNode &node)
+{
+  const geo_log::TreeLog *tree_log = geo_log::ModifierLog::find_tree_by_node_editor_context(
+      snode);
+  if (tree_log == nullptr) {
+    return std::nullopt;
+  }
+  if (node.type == NODE_GROUP) {
+    /* Group nodes are not executed themselves, show the time of all the nodes inside. */
+    const geo_log::TreeLog *child_log = tree_log->lookup_child_log(node.name);
+    if (child_log == nullptr) {
+      return std::nullopt;
+    }
+    return child_log->execution_time();
+  }
+  const geo_log::NodeLog *node_log = tree_log->lookup_node_log(node);
+  if (node_log == nullptr || node_log->execution_time().count() == 0) {
+    return std::nullopt;
+  }
+  return node_log->execution_time();
+}
+
+static void node_draw_execution_time(const SpaceNode &snode, bNode &node, const rctf &rect)
+{
+  if (!(snode.flag & SNODE_SHOW_TIMINGS) || snode.edittree == nullptr ||
+      snode.edittree->type != NTREE_GEOMETRY) {
+    return;
+  }
+  const std::optional<std::chrono::nanoseconds> execution_time = node_get_execution_time(snode,
+                                                                                         node);
+  if (!execution_time) {
+    return;
+  }
+
+  const double milliseconds = std::chrono::duration<double, std::milli>(*execution_time).count();
+  char str[32];
+  if (milliseconds < 0.1) {
+    BLI_strncpy(str, "< 0.1 ms", sizeof(str));
+  }
+  else {
+    BLI_snprintf(str, sizeof(str), "%.1f ms", milliseconds);
+  }
+
+  /* Draw the time above the header of the node. */
+  uiDefBut(node.block,
+           UI_BTYPE_LABEL,
+           0,
+           str,
+           (int)rect.xmin,
+           (int)rect.ymax,
+           (short)(rect.xmax - rect.xmin),
+           (short)NODE_DY,
+           nullptr,
+           0,
+           0,
+           0,
+           0,
+           "");
+}
+
 static void node_draw_basis(const bContext *C,
                             const View2D *v2d,
                             const SpaceNode *snode,
@@ -1711,6 +1775,7 @@ static void node_draw_basis(const bContext *C,
   }
 
   node_add_error_message_button(C, *ntree, *node, *rct, iconofs);
+  node_draw_execution_time(*snode, *node, *rct);
 
   /* Title. */
   if (node->flag & SELECT) {
@@ -1978,6 +2043,8 @@ static void node_draw_hidden(const bContext *C,
 
   node_draw_sockets(v2d, C, ntree, node, true, false);
 
+  node_draw_execution_time(*snode, *node, *rct);
+
   UI_block_end(C, node->block);
   UI_block_draw(C, node->block);
   node->block = nullptr;
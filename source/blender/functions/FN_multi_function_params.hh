@@ -34,6 +34,8 @@
 
 namespace blender::fn {
 
+class MFParams;
+
 class MFParamsBuilder {
  private:
   ResourceScope scope_;
@@ -175,6 +177,8 @@ class MFParamsBuilder {
     return scope_;
   }
 
+  void add_sliced_params(MFParams params, IndexRange slice);
+
  private:
   void assert_current_param_type(MFParamType param_type, StringRef expected_name = "")
   {
@@ -155,6 +155,7 @@ class MFCallInstruction : public MFInstruction {
 
  public:
   const MultiFunction &fn() const;
+  void set_fn(const MultiFunction &fn);
 
   MFInstruction *next();
   const MFInstruction *next() const;
@@ -29,11 +29,22 @@ class MFProcedureExecutor : public MultiFunction {
  private:
   MFSignature signature_;
   const MFProcedure &procedure_;
+  /**
+   * When not zero, the procedure is executed on slices of at most this many indices at a time,
+   * so that intermediate buffers are small enough to stay in cache between instructions.
+   */
+  int64_t chunk_size_ = 0;
+  bool chunking_supported_;
 
  public:
   MFProcedureExecutor(std::string name, const MFProcedure &procedure);
 
+  void set_chunk_size(int64_t chunk_size);
+
   void call(IndexMask mask, MFParams params, MFContext context) const override;
+
+ private:
+  void call_chunked(IndexMask full_mask, MFParams params, MFContext context) const;
 };
 
 }  // namespace blender::fn
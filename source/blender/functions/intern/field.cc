@@ -14,6 +14,8 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <mutex>
+
 #include "BLI_map.hh"
 #include "BLI_multi_value_map.hh"
 #include "BLI_set.hh"
@@ -141,11 +143,14 @@ static Set<GFieldRef> find_varying_fields(const FieldTreeInfo &field_tree_info,
 
 /**
  * Builds the #procedure so that it computes the the fields.
+ * \param r_calls: Gets the call instruction of every operation in the procedure.
  */
-static void build_multi_function_procedure_for_fields(MFProcedure &procedure,
-                                                      ResourceScope &scope,
-                                                      const FieldTreeInfo &field_tree_info,
-                                                      Span<GFieldRef> output_fields)
+static void build_multi_function_procedure_for_fields(
+    MFProcedure &procedure,
+    ResourceScope &scope,
+    const FieldTreeInfo &field_tree_info,
+    Span<GFieldRef> output_fields,
+    Vector<std::pair<MFCallInstruction *, const FieldOperation *>> &r_calls)
 {
   MFProcedureBuilder builder{procedure};
   /* Every input, intermediate and output field corresponds to a variable in the procedure. */
@@ -226,7 +231,9 @@ static void build_multi_function_procedure_for_fields(MFProcedure &procedure,
             BLI_assert_unreachable();
           }
         }
-        builder.add_call_with_all_variables(multi_function, variables);
+        MFCallInstruction &instruction = builder.add_call_with_all_variables(multi_function,
+                                                                             variables);
+        r_calls.append({&instruction, &operation});
       }
     }
   }
@@ -260,6 +267,229 @@ static void build_multi_function_procedure_for_fields(MFProcedure &procedure,
   BLI_assert(procedure.validate());
 }
 
+/* --------------------------------------------------------------------
+ * Field Procedure Cache.
+ */
+
+/**
+ * Identifies the structure of a field tree: the signatures of the multi-functions, the types of
+ * the field inputs and how they are connected. Field trees with the same structure result in the
+ * same procedures, only the called multi-functions may be different. This is the case when the
+ * same node tree is evaluated again, e.g. on the next frame or for another instance.
+ */
+struct FieldTreeKey {
+  Vector<uint64_t> tokens;
+
+  uint64_t hash() const
+  {
+    uint64_t hash = tokens.size();
+    for (const uint64_t token : tokens) {
+      hash = hash * 33 ^ token;
+    }
+    return hash;
+  }
+
+  friend bool operator==(const FieldTreeKey &a, const FieldTreeKey &b)
+  {
+    return a.tokens == b.tokens;
+  }
+};
+
+enum class FieldTreeToken : uint64_t {
+  NewInput,
+  InputRef,
+  Operation,
+  OperationRef,
+};
+
+struct FieldTreeStructure {
+  FieldTreeKey key;
+  /** Every operation in the tree, indexed in the same order as in the key. */
+  Vector<const FieldOperation *> operations;
+  Map<const FieldOperation *, int> operation_indices;
+  /** Every different input in the tree, indexed in the same order as in the key. */
+  VectorSet<std::reference_wrapper<const FieldInput>> field_inputs;
+};
+
+/**
+ * Encodes the structure of the tree in a deterministic order, so that the same structure always
+ * results in the same key.
+ */
+static FieldTreeStructure get_field_tree_structure(Span<GFieldRef> entry_fields)
+{
+  FieldTreeStructure structure;
+  Vector<uint64_t> &tokens = structure.key.tokens;
+  Stack<const FieldOperation *> operations_to_encode;
+
+  auto encode_field = [&](const GFieldRef field) {
+    if (field.node().is_input()) {
+      const FieldInput &field_input = static_cast<const FieldInput &>(field.node());
+      const int64_t old_size = structure.field_inputs.size();
+      const int64_t input_index = structure.field_inputs.index_of_or_add(field_input);
+      if (input_index == old_size) {
+        tokens.append((uint64_t)FieldTreeToken::NewInput);
+        tokens.append((uint64_t)&field_input.cpp_type());
+      }
+      tokens.append((uint64_t)FieldTreeToken::InputRef);
+      tokens.append(input_index);
+      return;
+    }
+    const FieldOperation &operation = static_cast<const FieldOperation &>(field.node());
+    const int operation_index = structure.operation_indices.lookup_or_add_cb(&operation, [&]() {
+      operations_to_encode.push(&operation);
+      return structure.operations.append_and_get_index(&operation);
+    });
+    tokens.append((uint64_t)FieldTreeToken::OperationRef);
+    tokens.append(operation_index);
+    tokens.append(field.node_output_index());
+  };
+
+  for (const GFieldRef field : entry_fields) {
+    encode_field(field);
+  }
+  while (!operations_to_encode.is_empty()) {
+    const FieldOperation &operation = *operations_to_encode.pop();
+    const MultiFunction &multi_function = operation.multi_function();
+    tokens.append((uint64_t)FieldTreeToken::Operation);
+    tokens.append(structure.operation_indices.lookup(&operation));
+    tokens.append(multi_function.param_amount());
+    for (const int param_index : multi_function.param_indices()) {
+      const MFParamType param_type = multi_function.param_type(param_index);
+      const MFDataType data_type = param_type.data_type();
+      tokens.append((uint64_t)param_type.category());
+      tokens.append(data_type.is_single() ? (uint64_t)&data_type.single_type() :
+                                            (uint64_t)&data_type.vector_base_type());
+    }
+    for (const GField &operation_input : operation.inputs()) {
+      encode_field(operation_input);
+    }
+  }
+  return structure;
+}
+
+/**
+ * Procedures that compute the fields of a tree, they can be reused for trees with the same
+ * structure after replacing the called multi-functions.
+ */
+struct FieldTreeProcedures {
+  /** Owns multi-functions that are created for the procedures. */
+  ResourceScope scope;
+  /**
+   * For every procedure input, the index of the field input in
+   * #FieldTreeStructure::field_inputs.
+   */
+  Vector<int> input_indices;
+  /** Procedure for the fields that have to be evaluated for every index and their indices. */
+  MFProcedure varying_procedure;
+  Vector<int> varying_field_indices;
+  /** Procedure for the fields that are the same for every index and their indices. */
+  MFProcedure constant_procedure;
+  Vector<int> constant_field_indices;
+  /** Every call instruction in the procedures with the index of the operation it calls. */
+  Vector<std::pair<MFCallInstruction *, int>> calls;
+};
+
+/**
+ * Keeps procedures of recently evaluated field trees. Procedures can't be used by multiple
+ * evaluations at the same time, so they are removed from the cache while used.
+ */
+class FieldProcedureCache {
+ private:
+  static constexpr int64_t max_size = 256;
+  std::mutex mutex_;
+  Map<FieldTreeKey, std::unique_ptr<FieldTreeProcedures>> procedures_;
+
+ public:
+  std::unique_ptr<FieldTreeProcedures> pop(const FieldTreeKey &key)
+  {
+    std::lock_guard lock{mutex_};
+    return procedures_.pop_default(key, nullptr);
+  }
+
+  void add(FieldTreeKey key, std::unique_ptr<FieldTreeProcedures> procedures)
+  {
+    std::lock_guard lock{mutex_};
+    if (procedures_.contains(key)) {
+      /* Another evaluation of the same structure added its procedures already. */
+      return;
+    }
+    if (procedures_.size() >= max_size) {
+      procedures_.clear();
+    }
+    procedures_.add_new(std::move(key), std::move(procedures));
+  }
+};
+
+static FieldProcedureCache &get_field_procedure_cache()
+{
+  static FieldProcedureCache cache;
+  return cache;
+}
+
+/**
+ * Builds the procedures to compute the fields that don't output an input directly.
+ */
+static std::unique_ptr<FieldTreeProcedures> build_field_tree_procedures(
+    Span<GFieldRef> fields_to_evaluate,
+    const FieldTreeStructure &tree_structure,
+    Span<const GVArray *> field_context_inputs)
+{
+  auto procedures = std::make_unique<FieldTreeProcedures>();
+
+  FieldTreeInfo field_tree_info = preprocess_field_tree(fields_to_evaluate);
+
+  /* The procedures use the input order of the field tree info. */
+  Vector<const GVArray *> procedure_inputs;
+  for (const FieldInput &field_input : field_tree_info.deduplicated_field_inputs) {
+    const int input_index = tree_structure.field_inputs.index_of(field_input);
+    procedures->input_indices.append(input_index);
+    procedure_inputs.append(field_context_inputs[input_index]);
+  }
+
+  Set<GFieldRef> varying_fields = find_varying_fields(field_tree_info, procedure_inputs);
+
+  /* Separate fields into two categories. Those that are constant and need to be evaluated only
+   * once, and those that need to be evaluated for every index. */
+  Vector<GFieldRef> varying_fields_to_evaluate;
+  Vector<GFieldRef> constant_fields_to_evaluate;
+  for (const int i : fields_to_evaluate.index_range()) {
+    GFieldRef field = fields_to_evaluate[i];
+    if (field.node().is_input()) {
+      /* Outputs the input directly, no procedure is needed. */
+      continue;
+    }
+    if (varying_fields.contains(field)) {
+      varying_fields_to_evaluate.append(field);
+      procedures->varying_field_indices.append(i);
+    }
+    else {
+      constant_fields_to_evaluate.append(field);
+      procedures->constant_field_indices.append(i);
+    }
+  }
+
+  Vector<std::pair<MFCallInstruction *, const FieldOperation *>> calls;
+  if (!varying_fields_to_evaluate.is_empty()) {
+    build_multi_function_procedure_for_fields(procedures->varying_procedure,
+                                              procedures->scope,
+                                              field_tree_info,
+                                              varying_fields_to_evaluate,
+                                              calls);
+  }
+  if (!constant_fields_to_evaluate.is_empty()) {
+    build_multi_function_procedure_for_fields(procedures->constant_procedure,
+                                              procedures->scope,
+                                              field_tree_info,
+                                              constant_fields_to_evaluate,
+                                              calls);
+  }
+  for (const auto &[instruction, operation] : calls) {
+    procedures->calls.append({instruction, tree_structure.operation_indices.lookup(operation)});
+  }
+
+  return procedures;
+}
+
 /**
  * Evaluate fields in the given context. If possible, multiple fields should be evaluated together,
  * because that can be more efficient when they share common sub-fields.
@@ -297,11 +527,11 @@ Vector<const GVArray *> evaluate_fields(ResourceScope &scope,
   };
 
   /* Traverse the field tree and prepare some data that is used in later steps. */
-  FieldTreeInfo field_tree_info = preprocess_field_tree(fields_to_evaluate);
+  FieldTreeStructure tree_structure = get_field_tree_structure(fields_to_evaluate);
 
   /* Get inputs that will be passed into the field when evaluated. */
   Vector<const GVArray *> field_context_inputs = get_field_context_inputs(
-      scope, mask, context, field_tree_info.deduplicated_field_inputs);
+      scope, mask, context, tree_structure.field_inputs);
 
   /* Finish fields that output an input varray directly. For those we don't have to do any further
    * processing. */
@@ -311,42 +541,44 @@ Vector<const GVArray *> evaluate_fields(ResourceScope &scope,
       continue;
     }
     const FieldInput &field_input = static_cast<const FieldInput &>(field.node());
-    const int field_input_index = field_tree_info.deduplicated_field_inputs.index_of(field_input);
+    const int field_input_index = tree_structure.field_inputs.index_of(field_input);
     const GVArray *varray = field_context_inputs[field_input_index];
     r_varrays[out_index] = varray;
   }
 
-  Set<GFieldRef> varying_fields = find_varying_fields(field_tree_info, field_context_inputs);
+  /* Constant inputs determine which fields are evaluated only once, so procedures can only be
+   * reused when the same inputs are constant. */
+  for (const GVArray *varray : field_context_inputs) {
+    tree_structure.key.tokens.append(varray->is_single());
+  }
 
-  /* Separate fields into two categories. Those that are constant and need to be evaluated only
-   * once, and those that need to be evaluated for every index. */
-  Vector<GFieldRef> varying_fields_to_evaluate;
-  Vector<int> varying_field_indices;
-  Vector<GFieldRef> constant_fields_to_evaluate;
-  Vector<int> constant_field_indices;
-  for (const int i : fields_to_evaluate.index_range()) {
-    if (r_varrays[i] != nullptr) {
-      /* Already done. */
-      continue;
-    }
-    GFieldRef field = fields_to_evaluate[i];
-    if (varying_fields.contains(field)) {
-      varying_fields_to_evaluate.append(field);
-      varying_field_indices.append(i);
-    }
-    else {
-      constant_fields_to_evaluate.append(field);
-      constant_field_indices.append(i);
+  /* Reuse the procedures of a previous evaluation of the same field tree structure if possible,
+   * otherwise build them. */
+  FieldProcedureCache &procedure_cache = get_field_procedure_cache();
+  std::unique_ptr<FieldTreeProcedures> procedures = procedure_cache.pop(tree_structure.key);
+  if (procedures) {
+    for (const auto &[instruction, operation_index] : procedures->calls) {
+      instruction->set_fn(tree_structure.operations[operation_index]->multi_function());
     }
   }
+  else {
+    procedures = build_field_tree_procedures(
+        fields_to_evaluate, tree_structure, field_context_inputs);
+  }
+  Vector<const GVArray *> procedure_inputs;
+  for (const int input_index : procedures->input_indices) {
+    procedure_inputs.append(field_context_inputs[input_index]);
+  }
+  const Span<int> varying_field_indices = procedures->varying_field_indices;
+  const Span<int> constant_field_indices = procedures->constant_field_indices;
 
   /* Evaluate varying fields if necessary. */
-  if (!varying_fields_to_evaluate.is_empty()) {
-    /* Build the procedure for those fields. */
-    MFProcedure procedure;
-    build_multi_function_procedure_for_fields(
-        procedure, scope, field_tree_info, varying_fields_to_evaluate);
+  if (!varying_field_indices.is_empty()) {
+    const MFProcedure &procedure = procedures->varying_procedure;
     MFProcedureExecutor procedure_executor{"Procedure", procedure};
+    /* Execute the whole procedure on small slices at a time, so that intermediate values stay in
+     * cache when there are many operations. */
+    procedure_executor.set_chunk_size(4096);
     /* Add multi threading capabilities to the field evaluation. */
     const int grain_size = 10000;
     fn::ParallelMultiFunction parallel_procedure_executor{procedure_executor, grain_size};
@@ -357,14 +589,13 @@ Vector<const GVArray *> evaluate_fields(ResourceScope &scope,
     MFContextBuilder mf_context;
 
     /* Provide inputs to the procedure executor. */
-    for (const GVArray *varray : field_context_inputs) {
+    for (const GVArray *varray : procedure_inputs) {
       mf_params.add_readonly_single_input(*varray);
     }
 
-    for (const int i : varying_fields_to_evaluate.index_range()) {
-      const GFieldRef &field = varying_fields_to_evaluate[i];
+    for (const int out_index : varying_field_indices) {
+      const GFieldRef &field = fields_to_evaluate[out_index];
       const CPPType &type = field.cpp_type();
-      const int out_index = varying_field_indices[i];
 
       /* Try to get an existing virtual array that the result should be written into. */
       GVMutableArray *output_varray = get_dst_varray_if_available(out_index);
@@ -398,11 +629,8 @@ Vector<const GVArray *> evaluate_fields(ResourceScope &scope,
   }
 
   /* Evaluate constant fields if necessary. */
-  if (!constant_fields_to_evaluate.is_empty()) {
-    /* Build the procedure for those fields. */
-    MFProcedure procedure;
-    build_multi_function_procedure_for_fields(
-        procedure, scope, field_tree_info, constant_fields_to_evaluate);
+  if (!constant_field_indices.is_empty()) {
+    const MFProcedure &procedure = procedures->constant_procedure;
     MFProcedureExecutor procedure_executor{"Procedure", procedure};
     /* Run the code below even when the mask is empty, so that outputs are properly prepared.
      * Higher level code can detect this as well and just skip evaluating the field. */
@@ -411,12 +639,12 @@ Vector<const GVArray *> evaluate_fields(ResourceScope &scope,
     MFContextBuilder mf_context;
 
     /* Provide inputs to the procedure executor. */
-    for (const GVArray *varray : field_context_inputs) {
+    for (const GVArray *varray : procedure_inputs) {
       mf_params.add_readonly_single_input(*varray);
     }
 
-    for (const int i : constant_fields_to_evaluate.index_range()) {
-      const GFieldRef &field = constant_fields_to_evaluate[i];
+    for (const int out_index : constant_field_indices) {
+      const GFieldRef &field = fields_to_evaluate[out_index];
       const CPPType &type = field.cpp_type();
       /* Allocate memory where the computed value will be stored in. */
       void *buffer = scope.linear_allocator().allocate(type.size(), type.alignment());
@@ -431,7 +659,6 @@ Vector<const GVArray *> evaluate_fields(ResourceScope &scope,
       mf_params.add_uninitialized_single_output({type, buffer, mask_size});
 
       /* Create virtual array that can be used after the procedure has been executed below. */
-      const int out_index = constant_field_indices[i];
       r_varrays[out_index] = &scope.construct<GVArray_For_SingleValueRef>(
           type, array_size, buffer);
     }
@@ -439,6 +666,8 @@ Vector<const GVArray *> evaluate_fields(ResourceScope &scope,
     procedure_executor.call(IndexRange(mask_size), mf_params, mf_context);
   }
 
+  procedure_cache.add(std::move(tree_structure.key), std::move(procedures));
+
   /* Copy data to supplied destination arrays if necessary. In some cases the evaluation above has
    * written the computed data in the right place already. */
   if (!dst_varrays.is_empty()) {
@@ -18,6 +18,43 @@
 
 namespace blender::fn {
 
+/**
+ * Adds all parameters of the function from given params, sliced to given range of indices. This
+ * allows calling the function on part of the indices with a mask that starts at the beginning of
+ * the range, e.g. a mask created with #IndexMask::slice_and_offset. Vector parameters are not
+ * supported.
+ */
+void MFParamsBuilder::add_sliced_params(MFParams params, const IndexRange slice)
+{
+  for (const int param_index : signature_->param_types.index_range()) {
+    const MFParamType param_type = signature_->param_types[param_index];
+    switch (param_type.category()) {
+      case MFParamType::SingleInput: {
+        const GVArray &varray = params.readonly_single_input(param_index);
+        const GVArray &sliced_varray = scope_.construct<GVArray_Slice>(varray, slice);
+        this->add_readonly_single_input(sliced_varray);
+        break;
+      }
+      case MFParamType::SingleMutable: {
+        const GMutableSpan span = params.single_mutable(param_index);
+        this->add_single_mutable(span.slice(slice.start(), slice.size()));
+        break;
+      }
+      case MFParamType::SingleOutput: {
+        const GMutableSpan span = params.uninitialized_single_output(param_index);
+        this->add_uninitialized_single_output(span.slice(slice.start(), slice.size()));
+        break;
+      }
+      case MFParamType::VectorInput:
+      case MFParamType::VectorMutable:
+      case MFParamType::VectorOutput: {
+        BLI_assert_unreachable();
+        break;
+      }
+    }
+  }
+}
+
 class DummyMultiFunction : public MultiFunction {
  public:
   DummyMultiFunction()
@@ -96,6 +96,24 @@ void MFCallInstruction::set_next(MFInstruction *instruction)
   next_ = instruction;
 }
 
+/**
+ * Replaces the called function with one that has the same signature. This allows reusing a
+ * procedure with different functions without building it again.
+ */
+void MFCallInstruction::set_fn(const MultiFunction &fn)
+{
+  /* The previous function may not exist anymore, only compare with the variables. */
+  BLI_assert(fn.param_amount() == params_.size());
+#ifdef DEBUG
+  for (const int param_index : fn.param_indices()) {
+    const MFVariable *variable = params_[param_index];
+    BLI_assert(variable == nullptr ||
+               fn.param_type(param_index).data_type() == variable->data_type());
+  }
+#endif
+  fn_ = &fn;
+}
+
 void MFCallInstruction::set_param_variable(int param_index, MFVariable *variable)
 {
   if (params_[param_index] != nullptr) {
@@ -31,6 +31,21 @@ MFProcedureExecutor::MFProcedureExecutor(std::string name, const MFProcedure &pr
 
   signature_ = signature.build();
   this->set_signature(&signature_);
+
+  chunking_supported_ = true;
+  for (const int param_index : this->param_indices()) {
+    if (this->param_type(param_index).data_type().category() == MFDataType::Vector) {
+      /* Vector parameters can't be sliced yet. */
+      chunking_supported_ = false;
+      break;
+    }
+  }
+}
+
+void MFProcedureExecutor::set_chunk_size(const int64_t chunk_size)
+{
+  BLI_assert(chunk_size >= 0);
+  chunk_size_ = chunk_size;
 }
 
 using IndicesSplitVectors = std::array<Vector<int64_t>, 2>;
@@ -149,6 +164,9 @@ class ValueAllocator : NonCopyable, NonMovable {
   /* The integer key is the size of one element (e.g. 4 for an integer buffer). All buffers are
    * aligned to #min_alignment bytes. */
   Map<int, Stack<void *>> span_buffers_free_list_;
+  /* Number of elements in every span buffer, buffers can only be reused if they are large
+   * enough. */
+  int64_t span_buffer_size_ = 0;
 
  public:
   ValueAllocator() = default;
@@ -160,10 +178,18 @@ class ValueAllocator : NonCopyable, NonMovable {
         MEM_freeN(stack.pop());
       }
     }
-    for (Stack<void *> &stack : span_buffers_free_list_.values()) {
-      while (!stack.is_empty()) {
-        MEM_freeN(stack.pop());
-      }
+    this->free_span_buffers();
+  }
+
+  /**
+   * Makes sure that span buffers have at least the given size. Must only be called when no span
+   * buffer is in use, e.g. before the allocator is reused for another execution.
+   */
+  void ensure_span_buffer_size(const int64_t size)
+  {
+    if (size > span_buffer_size_) {
+      this->free_span_buffers();
+      span_buffer_size_ = size;
     }
   }
 
@@ -188,6 +214,8 @@ class ValueAllocator : NonCopyable, NonMovable {
 
   VariableValue_Span *obtain_Span(const CPPType &type, int size)
   {
+    BLI_assert(size <= span_buffer_size_);
+    UNUSED_VARS_NDEBUG(size);
     void *buffer = nullptr;
 
     const int element_size = type.size();
@@ -195,12 +223,12 @@ class ValueAllocator : NonCopyable, NonMovable {
 
     if (alignment > min_alignment) {
       /* In this rare case we fallback to not reusing existing buffers. */
-      buffer = MEM_mallocN_aligned(element_size * size, alignment, __func__);
+      buffer = MEM_mallocN_aligned(element_size * span_buffer_size_, alignment, __func__);
     }
     else {
       Stack<void *> *stack = span_buffers_free_list_.lookup_ptr(element_size);
       if (stack == nullptr || stack->is_empty()) {
-        buffer = MEM_mallocN_aligned(element_size * size, min_alignment, __func__);
+        buffer = MEM_mallocN_aligned(element_size * span_buffer_size_, min_alignment, __func__);
       }
       else {
         /* Reuse existing buffer. */
@@ -281,6 +309,15 @@ class ValueAllocator : NonCopyable, NonMovable {
   }
 
  private:
+  void free_span_buffers()
+  {
+    for (Stack<void *> &stack : span_buffers_free_list_.values()) {
+      while (!stack.is_empty()) {
+        MEM_freeN(stack.pop());
+      }
+    }
+  }
+
   template<typename T, typename... Args> T *obtain(Args &&...args)
   {
     static_assert(std::is_base_of_v<VariableValue, T>);
@@ -812,13 +849,15 @@ void ValueAllocator::release_variable_state(VariableState *state)
 /** Keeps track of the states of all variables during evaluation. */
 class VariableStates {
  private:
-  ValueAllocator value_allocator_;
+  ValueAllocator &value_allocator_;
   Map<const MFVariable *, VariableState *> variable_states_;
   IndexMask full_mask_;
 
  public:
-  VariableStates(IndexMask full_mask) : full_mask_(full_mask)
+  VariableStates(ValueAllocator &value_allocator, IndexMask full_mask)
+      : value_allocator_(value_allocator), full_mask_(full_mask)
   {
+    value_allocator_.ensure_span_buffer_size(full_mask.min_array_size());
   }
 
   ~VariableStates()
@@ -1157,17 +1196,18 @@ class InstructionScheduler {
   }
 };
 
-void MFProcedureExecutor::call(IndexMask full_mask, MFParams params, MFContext context) const
+static void execute_procedure(const MFProcedureExecutor &fn,
+                              const MFProcedure &procedure,
+                              IndexMask full_mask,
+                              MFParams params,
+                              const MFContext &context,
+                              ValueAllocator &value_allocator)
 {
-  BLI_assert(procedure_.validate());
-
-  LinearAllocator<> allocator;
-
-  VariableStates variable_states{full_mask};
-  variable_states.add_initial_variable_states(*this, procedure_, params);
+  VariableStates variable_states{value_allocator, full_mask};
+  variable_states.add_initial_variable_states(fn, procedure, params);
 
   InstructionScheduler scheduler;
-  scheduler.add_referenced_indices(*procedure_.entry(), full_mask);
+  scheduler.add_referenced_indices(*procedure.entry(), full_mask);
 
   /* Loop until all indices got to a return instruction. */
   while (NextInstructionInfo instr_info = scheduler.pop_next()) {
@@ -1213,9 +1253,9 @@ void MFProcedureExecutor::call(IndexMask full_mask, MFParams params, MFContext c
     }
   }
 
-  for (const int param_index : this->param_indices()) {
-    const MFParamType param_type = this->param_type(param_index);
-    const MFVariable *variable = procedure_.params()[param_index].variable;
+  for (const int param_index : fn.param_indices()) {
+    const MFParamType param_type = fn.param_type(param_index);
+    const MFVariable *variable = procedure.params()[param_index].variable;
     VariableState &variable_state = variable_states.get_variable_state(*variable);
     switch (param_type.interface_type()) {
       case MFParamType::Input: {
@@ -1236,4 +1276,47 @@ void MFProcedureExecutor::call(IndexMask full_mask, MFParams params, MFContext c
   }
 }
 
+void MFProcedureExecutor::call(IndexMask full_mask, MFParams params, MFContext context) const
+{
+  BLI_assert(procedure_.validate());
+
+  if (chunk_size_ > 0 && full_mask.size() > chunk_size_ && chunking_supported_) {
+    this->call_chunked(full_mask, params, context);
+    return;
+  }
+
+  ValueAllocator value_allocator;
+  execute_procedure(*this, procedure_, full_mask, params, context, value_allocator);
+}
+
+/**
+ * Executes the whole procedure on one slice of the mask after the other instead of executing
+ * every instruction on the full mask. Intermediate buffers only have the size of a slice and are
+ * reused for the next slice, so that they stay in cache when executing long chains of
+ * instructions.
+ */
+void MFProcedureExecutor::call_chunked(IndexMask full_mask,
+                                       MFParams params,
+                                       MFContext context) const
+{
+  ValueAllocator value_allocator;
+  Vector<int64_t> sub_mask_indices;
+
+  for (int64_t chunk_start = 0; chunk_start < full_mask.size(); chunk_start += chunk_size_) {
+    const IndexRange mask_slice{chunk_start,
+                                std::min(chunk_size_, full_mask.size() - chunk_start)};
+    const IndexMask sub_mask = full_mask.slice_and_offset(mask_slice, sub_mask_indices);
+    const int64_t input_slice_start = full_mask[mask_slice.first()];
+    const int64_t input_slice_size = full_mask[mask_slice.last()] - input_slice_start + 1;
+    const IndexRange input_slice_range{input_slice_start, input_slice_size};
+
+    MFParamsBuilder sub_params{*this, sub_mask.min_array_size()};
+    /* All parameters are sliced, so that the size of intermediate buffers only depends on the
+     * size of the slice. */
+    sub_params.add_sliced_params(params, input_slice_range);
+
+    execute_procedure(*this, procedure_, sub_mask, sub_params, context, value_allocator);
+  }
+}
+
 }  // namespace blender::fn
@@ -291,4 +291,34 @@ TEST(field, IgnoredOutput)
   EXPECT_EQ(results->get(3), 5);
 }
 
+static GField create_index_multiply_field(const int factor)
+{
+  GField index_field{std::make_shared<IndexFieldInput>()};
+  GField factor_field{std::make_shared<FieldOperation>(
+                          FieldOperation(std::make_unique<CustomMF_Constant<int>>(factor), {})),
+                      0};
+  std::unique_ptr<MultiFunction> multiply_fn = std::make_unique<CustomMF_SI_SI_SO<int, int, int>>(
+      "multiply", [](int a, int b) { return a * b; });
+  return GField{std::make_shared<FieldOperation>(
+                    FieldOperation(std::move(multiply_fn), {index_field, factor_field})),
+                0};
+}
+
+TEST(field, SameStructureDifferentFunctions)
+{
+  /* The procedure built for the first field is reused for the second one, which has the same
+   * structure, but must call the functions of the second field. */
+  FieldContext context;
+  for (const int factor : {2, 3, 5}) {
+    GField field = create_index_multiply_field(factor);
+    Array<int> result(4);
+    FieldEvaluator evaluator{context, 4};
+    evaluator.add_with_destination(field, result.as_mutable_span());
+    evaluator.evaluate();
+    EXPECT_EQ(result[0], 0);
+    EXPECT_EQ(result[1], factor);
+    EXPECT_EQ(result[3], 3 * factor);
+  }
+}
+
 }  // namespace blender::fn::tests
@@ -341,4 +341,58 @@ TEST(multi_function_procedure, BufferReuse)
   EXPECT_EQ(results[4], 53);
 }
 
+TEST(multi_function_procedure, Chunks)
+{
+  /**
+   * procedure(int var1, bool var2, int *var3) {
+   *   var3 = var1 + 10;
+   *   if (var2) {
+   *     var3 += 100;
+   *   }
+   * }
+   */
+
+  CustomMF_SI_SO<int, int> add_10_fn{"add_10", [](int a) { return a + 10; }};
+  CustomMF_SM<int> add_100_fn{"add_100", [](int &a) { a += 100; }};
+
+  MFProcedure procedure;
+  MFProcedureBuilder builder{procedure};
+
+  MFVariable *var1 = &builder.add_single_input_parameter<int>();
+  MFVariable *var2 = &builder.add_single_input_parameter<bool>();
+  auto [var3] = builder.add_call<1>(add_10_fn, {var1});
+  builder.add_destruct(*var1);
+  MFProcedureBuilder::Branch branch = builder.add_branch(*var2);
+  branch.branch_true.add_call(add_100_fn, {var3});
+  builder.set_cursor_after_branch(branch);
+  builder.add_destruct(*var2);
+  builder.add_return();
+  builder.add_output_parameter(*var3);
+
+  EXPECT_TRUE(procedure.validate());
+
+  MFProcedureExecutor procedure_fn{"Chunks", procedure};
+  procedure_fn.set_chunk_size(2);
+
+  Array<int> inputs = {4, 1, 6, 2, 3, 8, 7};
+  Array<bool> conditions = {true, false, false, true, true, false, true};
+  Array<int> results(7, -1);
+
+  MFParamsBuilder params{procedure_fn, 7};
+  params.add_readonly_single_input(inputs.as_span());
+  params.add_readonly_single_input(conditions.as_span());
+  params.add_uninitialized_single_output(results.as_mutable_span());
+
+  MFContextBuilder context;
+  procedure_fn.call({0, 2, 3, 4, 6}, params, context);
+
+  EXPECT_EQ(results[0], 114);
+  EXPECT_EQ(results[1], -1);
+  EXPECT_EQ(results[2], 16);
+  EXPECT_EQ(results[3], 112);
+  EXPECT_EQ(results[4], 113);
+  EXPECT_EQ(results[5], -1);
+  EXPECT_EQ(results[6], 117);
+}
+
 }  // namespace blender::fn::tests
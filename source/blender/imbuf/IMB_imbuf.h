@@ -486,6 +486,28 @@ bool IMB_scalefastImBuf(struct ImBuf *ibuf, unsigned int newx, unsigned int newy
  */
 void IMB_scaleImBuf_threaded(struct ImBuf *ibuf, unsigned int newx, unsigned int newy);
 
+typedef enum eIMBScaleFilter {
+  /** Average of the covered pixels, fast and good for downscaling. */
+  IMB_SCALE_FILTER_BOX,
+  IMB_SCALE_FILTER_BILINEAR,
+  /** Catmull-Rom spline, sharper than bilinear. */
+  IMB_SCALE_FILTER_BICUBIC,
+  /** Three lobed Lanczos, sharpest, slight ringing on hard edges. */
+  IMB_SCALE_FILTER_LANCZOS,
+} eIMBScaleFilter;
+
+/**
+ * Separable resampling with the given filter, the filter is widened when downscaling so that
+ * all input pixels contribute. Rows are processed in parallel.
+ * Return true if \a ibuf is modified.
+ *
+ * \attention Defined in scaling.c
+ */
+bool IMB_scaleImBuf_filter(struct ImBuf *ibuf,
+                           unsigned int newx,
+                           unsigned int newy,
+                           eIMBScaleFilter filter);
+
 /**
  *
  * \attention Defined in writeimage.c
@@ -172,6 +172,8 @@ typedef enum eImBufFlags {
   IB_thumbnail = 1 << 16,
   IB_multiview = 1 << 17,
   IB_halffloat = 1 << 18,
+  /** Movie decodes frames following the requested one on a background thread. */
+  IB_animdecodeahead = 1 << 19,
 } eImBufFlags;
 
 /** \} */
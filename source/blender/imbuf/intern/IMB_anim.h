@@ -83,6 +83,7 @@
 struct IDProperty;
 struct _AviMovie;
 struct anim_index;
+struct AnimDecodeAhead;
 
 struct anim {
   int ib_flags;
@@ -136,6 +137,9 @@ struct anim {
   int64_t cur_pts;
   int64_t cur_key_frame_pts;
   AVPacket *cur_packet;
+
+  /* Background decoding of upcoming frames, see #IB_animdecodeahead. */
+  struct AnimDecodeAhead *decode_ahead;
 #endif
 
   char index_dir[768];
@@ -151,3 +155,7 @@ struct anim {
 
   struct IDProperty *metadata;
 };
+
+/* Stop decoding frames in the background and free them, see #IB_animdecodeahead.
+ * Decoding ahead starts again on the next frame request. */
+void IMB_anim_decode_ahead_stop(struct anim *anim);
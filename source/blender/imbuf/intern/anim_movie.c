@@ -55,6 +55,7 @@
 
 #include "BLI_path_util.h"
 #include "BLI_string.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
@@ -202,6 +203,7 @@ static void free_anim_avi(struct anim *anim)
 
 #ifdef WITH_FFMPEG
 static void free_anim_ffmpeg(struct anim *anim);
+static void ffmpeg_decode_ahead_free(struct anim *anim);
 #endif
 
 void IMB_free_anim(struct anim *anim)
@@ -244,6 +246,15 @@ void IMB_close_anim_proxies(struct anim *anim)
   IMB_free_indices(anim);
 }
 
+void IMB_anim_decode_ahead_stop(struct anim *anim)
+{
+#ifdef WITH_FFMPEG
+  ffmpeg_decode_ahead_free(anim);
+#else
+  UNUSED_VARS(anim);
+#endif
+}
+
 struct IDProperty *IMB_anim_load_metadata(struct anim *anim)
 {
   switch (anim->curtype) {
@@ -1381,7 +1392,7 @@ static int ffmpeg_seek_to_key_frame(struct anim *anim,
   return ret;
 }
 
-static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position, IMB_Timecode_Type tc)
+static ImBuf *ffmpeg_decode_ibuf(struct anim *anim, int position, IMB_Timecode_Type tc)
 {
   if (anim == NULL) {
     return NULL;
@@ -1459,12 +1470,267 @@ static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position, IMB_Timecode_Typ
   return anim->cur_frame_final;
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Decode Ahead
+ *
+ * When an animation opened with #IB_animdecodeahead is requested consecutive frames, a task
+ * keeps decoding the frames following the last requested position into a small ring of image
+ * buffers. Forward playback then finds the next frame already decoded and color converted, and
+ * the decoder is kept busy while the caller processes the current frame. Animations requested
+ * other frames, e.g. strips that are not played or animations of prefetch workers rendering
+ * every n-th frame, don't decode ahead.
+ *
+ * Tasks run in the shared task scheduler, so animations don't keep threads of their own. There is
+ * at most one task per animation, it ends once the ring is full and is pushed again when a frame
+ * is taken from the ring.
+ *
+ * Access to the FFmpeg decoding state is serialized by `decode_mutex`, the ring and the request
+ * state are protected by `frames_mutex`. The task never holds both at once.
+ * The task reads the indices of the animation, it is stopped before they are freed, see
+ * #IMB_anim_decode_ahead_stop.
+ *
+ * Frames in the ring are not stored in any cache. Its memory is bounded by
+ * #ANIM_DECODE_AHEAD_FRAMES frames for every played animation.
+ * \{ */
+
+#define ANIM_DECODE_AHEAD_FRAMES 4
+
+typedef struct AnimDecodeAheadFrame {
+  ImBuf *ibuf;
+  int position;
+  IMB_Timecode_Type tc;
+} AnimDecodeAheadFrame;
+
+typedef struct AnimDecodeAhead {
+  ThreadMutex decode_mutex;
+  ThreadMutex frames_mutex;
+  TaskPool *task_pool;
+  bool task_running;
+
+  AnimDecodeAheadFrame frames[ANIM_DECODE_AHEAD_FRAMES];
+  /* Last position requested by the user of the animation, frames are decoded after it. */
+  int requested_position;
+  IMB_Timecode_Type requested_tc;
+  /* Set when decoding failed, cleared by the next request. */
+  bool idle;
+  /* Set when the last request followed the one before, i.e. the animation is being played. */
+  bool is_playing;
+  bool stop;
+  /* Number of requests decoding a frame missing in the ring on the calling thread. */
+  int sync_decodes;
+} AnimDecodeAhead;
+
+static AnimDecodeAheadFrame *ffmpeg_decode_ahead_frame_find(AnimDecodeAhead *da,
+                                                            int position,
+                                                            IMB_Timecode_Type tc)
+{
+  for (int i = 0; i < ANIM_DECODE_AHEAD_FRAMES; i++) {
+    AnimDecodeAheadFrame *frame = &da->frames[i];
+    if (frame->ibuf && frame->position == position && frame->tc == tc) {
+      return frame;
+    }
+  }
+  return NULL;
+}
+
+static AnimDecodeAheadFrame *ffmpeg_decode_ahead_frame_free_get(AnimDecodeAhead *da)
+{
+  for (int i = 0; i < ANIM_DECODE_AHEAD_FRAMES; i++) {
+    if (da->frames[i].ibuf == NULL) {
+      return &da->frames[i];
+    }
+  }
+  return NULL;
+}
+
+/* Drop frames which will not be requested when playing forward from the requested position. */
+static void ffmpeg_decode_ahead_frames_discard(AnimDecodeAhead *da)
+{
+  for (int i = 0; i < ANIM_DECODE_AHEAD_FRAMES; i++) {
+    AnimDecodeAheadFrame *frame = &da->frames[i];
+    if (frame->ibuf == NULL) {
+      continue;
+    }
+    if (frame->tc != da->requested_tc || frame->position < da->requested_position ||
+        frame->position > da->requested_position + ANIM_DECODE_AHEAD_FRAMES) {
+      IMB_freeImBuf(frame->ibuf);
+      frame->ibuf = NULL;
+    }
+  }
+}
+
+/* Next position to decode, or -1 when the ring is full or the end of the movie is reached. */
+static int ffmpeg_decode_ahead_next_position(struct anim *anim, AnimDecodeAhead *da)
+{
+  /* Don't compete with a request decoding its frame, it may have to seek elsewhere. */
+  if (da->stop || da->idle || !da->is_playing || da->sync_decodes > 0 ||
+      ffmpeg_decode_ahead_frame_free_get(da) == NULL) {
+    return -1;
+  }
+
+  for (int i = 1; i <= ANIM_DECODE_AHEAD_FRAMES; i++) {
+    const int position = da->requested_position + i;
+    if (position >= anim->duration_in_frames) {
+      break;
+    }
+    if (ffmpeg_decode_ahead_frame_find(da, position, da->requested_tc) == NULL) {
+      return position;
+    }
+  }
+  return -1;
+}
+
+static void ffmpeg_decode_ahead_task(TaskPool *__restrict pool, void *UNUSED(taskdata))
+{
+  struct anim *anim = BLI_task_pool_user_data(pool);
+  AnimDecodeAhead *da = anim->decode_ahead;
+
+  BLI_mutex_lock(&da->frames_mutex);
+  while (true) {
+    const int position = ffmpeg_decode_ahead_next_position(anim, da);
+    if (position == -1) {
+      break;
+    }
+    const IMB_Timecode_Type tc = da->requested_tc;
+    BLI_mutex_unlock(&da->frames_mutex);
+
+    BLI_mutex_lock(&da->decode_mutex);
+    ImBuf *ibuf = ffmpeg_decode_ibuf(anim, position, tc);
+    BLI_mutex_unlock(&da->decode_mutex);
+
+    BLI_mutex_lock(&da->frames_mutex);
+    if (ibuf == NULL) {
+      da->idle = true;
+      continue;
+    }
+
+    /* The request might have moved on while decoding. */
+    AnimDecodeAheadFrame *frame = NULL;
+    if (tc == da->requested_tc && position > da->requested_position &&
+        ffmpeg_decode_ahead_frame_find(da, position, tc) == NULL) {
+      frame = ffmpeg_decode_ahead_frame_free_get(da);
+    }
+    if (frame) {
+      frame->ibuf = ibuf;
+      frame->position = position;
+      frame->tc = tc;
+    }
+    else {
+      IMB_freeImBuf(ibuf);
+    }
+  }
+  da->task_running = false;
+  BLI_mutex_unlock(&da->frames_mutex);
+}
+
+/* Push the decoding task when there are frames to decode. Called with `frames_mutex` locked. */
+static void ffmpeg_decode_ahead_continue(struct anim *anim, AnimDecodeAhead *da)
+{
+  if (da->task_running || ffmpeg_decode_ahead_next_position(anim, da) == -1) {
+    return;
+  }
+  da->task_running = true;
+  BLI_task_pool_push(da->task_pool, ffmpeg_decode_ahead_task, NULL, false, NULL);
+}
+
+static AnimDecodeAhead *ffmpeg_decode_ahead_start(struct anim *anim)
+{
+  AnimDecodeAhead *da = MEM_callocN(sizeof(AnimDecodeAhead), "AnimDecodeAhead");
+  BLI_mutex_init(&da->decode_mutex);
+  BLI_mutex_init(&da->frames_mutex);
+  da->task_pool = BLI_task_pool_create(anim, TASK_PRIORITY_LOW);
+  da->requested_position = -1;
+  da->idle = true;
+  anim->decode_ahead = da;
+
+  return da;
+}
+
+static void ffmpeg_decode_ahead_free(struct anim *anim)
+{
+  AnimDecodeAhead *da = anim->decode_ahead;
+  if (da == NULL) {
+    return;
+  }
+
+  BLI_mutex_lock(&da->frames_mutex);
+  da->stop = true;
+  BLI_mutex_unlock(&da->frames_mutex);
+
+  BLI_task_pool_work_and_wait(da->task_pool);
+  BLI_task_pool_free(da->task_pool);
+
+  for (int i = 0; i < ANIM_DECODE_AHEAD_FRAMES; i++) {
+    IMB_freeImBuf(da->frames[i].ibuf);
+  }
+
+  BLI_mutex_end(&da->frames_mutex);
+  BLI_mutex_end(&da->decode_mutex);
+  MEM_freeN(da);
+  anim->decode_ahead = NULL;
+}
+
+static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position, IMB_Timecode_Type tc)
+{
+  if (anim == NULL) {
+    return NULL;
+  }
+  if ((anim->ib_flags & IB_animdecodeahead) == 0) {
+    return ffmpeg_decode_ibuf(anim, position, tc);
+  }
+
+  AnimDecodeAhead *da = anim->decode_ahead;
+  if (da == NULL) {
+    da = ffmpeg_decode_ahead_start(anim);
+  }
+
+  /* Open the index on the calling thread, so the decoding thread only reads it. */
+  IMB_anim_open_index(anim, tc);
+
+  BLI_mutex_lock(&da->frames_mutex);
+  da->is_playing = position == da->requested_position + 1 && tc == da->requested_tc;
+  da->requested_position = position;
+  da->requested_tc = tc;
+  da->idle = false;
+  ffmpeg_decode_ahead_frames_discard(da);
+
+  ImBuf *ibuf = NULL;
+  AnimDecodeAheadFrame *frame = ffmpeg_decode_ahead_frame_find(da, position, tc);
+  if (frame) {
+    ibuf = frame->ibuf;
+    IMB_refImBuf(ibuf);
+    ffmpeg_decode_ahead_continue(anim, da);
+  }
+  else {
+    da->sync_decodes++;
+  }
+  BLI_mutex_unlock(&da->frames_mutex);
+
+  if (ibuf == NULL) {
+    BLI_mutex_lock(&da->decode_mutex);
+    ibuf = ffmpeg_decode_ibuf(anim, position, tc);
+    BLI_mutex_unlock(&da->decode_mutex);
+
+    /* Continue decoding after the requested frame only now, from where the decoder is. */
+    BLI_mutex_lock(&da->frames_mutex);
+    da->sync_decodes--;
+    ffmpeg_decode_ahead_continue(anim, da);
+    BLI_mutex_unlock(&da->frames_mutex);
+  }
+
+  return ibuf;
+}
+
+/** \} */
+
 static void free_anim_ffmpeg(struct anim *anim)
 {
   if (anim == NULL) {
     return;
   }
 
+  ffmpeg_decode_ahead_free(anim);
+
   if (anim->pCodecCtx) {
     avcodec_free_context(&anim->pCodecCtx);
     avformat_close_input(&anim->pFormatCtx);
@@ -1638,10 +1904,8 @@ struct ImBuf *IMB_anim_absolute(struct anim *anim,
 #endif
 #ifdef WITH_FFMPEG
     case ANIM_FFMPEG:
+      /* The position is updated by the decoder, which may run on the decode-ahead thread. */
       ibuf = ffmpeg_fetchibuf(anim, position, tc);
-      if (ibuf) {
-        anim->cur_position = position;
-      }
       filter_y = 0; /* done internally */
       break;
 #endif
@@ -1651,7 +1915,7 @@ struct ImBuf *IMB_anim_absolute(struct anim *anim,
     if (filter_y) {
       IMB_filtery(ibuf);
     }
-    BLI_snprintf(ibuf->name, sizeof(ibuf->name), "%s.%04d", anim->name, anim->cur_position + 1);
+    BLI_snprintf(ibuf->name, sizeof(ibuf->name), "%s.%04d", anim->name, position + 1);
   }
   return ibuf;
 }
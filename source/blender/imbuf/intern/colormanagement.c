@@ -1586,6 +1586,85 @@ static void display_buffer_apply_get_linear_buffer(DisplayBufferThread *handle,
   }
 }
 
+/* Byte buffers in a regular color space are converted one scanline at a time. The conversion to
+ * scene linear, the display transform and the dithered conversion back to bytes are done while
+ * the scanline is in cache, without a float copy of the whole block of lines. */
+static bool display_buffer_can_apply_byte_fused(const DisplayBufferThread *handle)
+{
+  if (handle->buffer || !handle->byte_buffer || handle->display_buffer ||
+      !handle->display_buffer_byte) {
+    return false;
+  }
+  if (handle->channels != 4 || handle->is_data || handle->cm_processor->is_data_result) {
+    return false;
+  }
+
+  ColorSpace *colorspace = colormanage_colorspace_get_named(handle->byte_colorspace);
+  return colorspace != NULL && !colorspace->is_data;
+}
+
+static void display_buffer_apply_byte_fused(DisplayBufferThread *handle)
+{
+  ColorSpace *colorspace = colormanage_colorspace_get_named(handle->byte_colorspace);
+  /* sRGB, the common case for byte images, is converted with a lookup table. */
+  const bool use_srgb_table = IMB_colormanagement_space_is_srgb(colorspace);
+  OCIO_ConstCPUProcessorRcPtr *to_scene_linear = use_srgb_table ?
+                                                     NULL :
+                                                     colorspace_to_scene_linear_cpu_processor(
+                                                         colorspace);
+
+  const int width = handle->width;
+  const int height = handle->tot_line;
+  const float dither = handle->dither;
+  const float inv_width = 1.0f / width;
+  const float inv_height = 1.0f / height;
+
+  float *scanline = MEM_mallocN(sizeof(float[4]) * width, "display buffer scanline");
+
+  for (int y = 0; y < height; y++) {
+    const unsigned char *cp = handle->byte_buffer + (size_t)4 * width * y;
+    unsigned char *display_cp = handle->display_buffer_byte + (size_t)4 * width * y;
+    float *fp = scanline;
+
+    if (use_srgb_table) {
+      for (int x = 0; x < width; x++, fp += 4, cp += 4) {
+        srgb_to_linearrgb_uchar4(fp, cp);
+      }
+    }
+    else {
+      for (int x = 0; x < width; x++, fp += 4, cp += 4) {
+        rgba_uchar_to_float(fp, cp);
+      }
+      if (to_scene_linear) {
+        OCIO_PackedImageDesc *img = OCIO_createOCIO_PackedImageDesc(
+            scanline, width, 1, 4, sizeof(float), sizeof(float[4]), sizeof(float[4]) * width);
+        OCIO_cpuProcessorApply(to_scene_linear, img);
+        OCIO_PackedImageDescRelease(img);
+      }
+    }
+
+    /* Byte buffers have straight alpha. */
+    IMB_colormanagement_processor_apply(handle->cm_processor, scanline, width, 1, 4, false);
+
+    /* Matches #IMB_buffer_byte_from_float, with the dither pattern laid out over all lines. */
+    const float t = y * inv_height;
+    fp = scanline;
+    if (dither != 0.0f) {
+      for (int x = 0; x < width; x++, fp += 4, display_cp += 4) {
+        float_to_byte_dither_v3(display_cp, fp, dither, (float)x * inv_width, t);
+        display_cp[3] = unit_float_to_uchar_clamp(fp[3]);
+      }
+    }
+    else {
+      for (int x = 0; x < width; x++, fp += 4, display_cp += 4) {
+        rgba_float_to_uchar(display_cp, fp);
+      }
+    }
+  }
+
+  MEM_freeN(scanline);
+}
+
 static void *do_display_buffer_apply_thread(void *handle_v)
 {
   DisplayBufferThread *handle = (DisplayBufferThread *)handle_v;
@@ -1623,6 +1702,9 @@ static void *do_display_buffer_apply_thread(void *handle_v)
                                  width);
     }
   }
+  else if (display_buffer_can_apply_byte_fused(handle)) {
+    display_buffer_apply_byte_fused(handle);
+  }
   else {
     bool is_straight_alpha;
     float *linear_buffer = MEM_mallocN(((size_t)channels) * width * height * sizeof(float),
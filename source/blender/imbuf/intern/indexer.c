@@ -29,8 +29,10 @@
 #include "BLI_fileops.h"
 #include "BLI_ghash.h"
 #include "BLI_math.h"
+#include "BLI_math_bits.h"
 #include "BLI_path_util.h"
 #include "BLI_string.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 #include "BLI_utildefines.h"
 #ifdef _WIN32
@@ -955,6 +957,19 @@ static void index_rebuild_ffmpeg_finish(FFmpegIndexBuilderContext *context, int
   MEM_freeN(context);
 }
 
+typedef struct ProxyOutputTaskData {
+  FFmpegIndexBuilderContext *context;
+  AVFrame *frame;
+} ProxyOutputTaskData;
+
+static void index_rebuild_ffmpeg_proxy_output_cb(void *__restrict userdata,
+                                                 const int i,
+                                                 const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ProxyOutputTaskData *data = userdata;
+  add_to_proxy_output_ffmpeg(data->context->proxy_ctx[i], data->frame);
+}
+
 static void index_rebuild_ffmpeg_proc_decoded_frame(FFmpegIndexBuilderContext *context,
                                                     AVPacket *curr_packet,
                                                     AVFrame *in_frame)
@@ -965,9 +980,13 @@ static void index_rebuild_ffmpeg_proc_decoded_frame(FFmpegIndexBuilderContext *c
   uint64_t s_dts = context->seek_pos_dts;
   uint64_t pts = av_get_pts_from_frame(in_frame);
 
-  for (i = 0; i < context->num_proxy_sizes; i++) {
-    add_to_proxy_output_ffmpeg(context->proxy_ctx[i], in_frame);
-  }
+  /* The decoded frame is shared, every proxy size is scaled and encoded by its own output. */
+  ProxyOutputTaskData data = {context, in_frame};
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = count_bits_i(context->proxy_sizes_in_use) > 1;
+  BLI_task_parallel_range(
+      0, context->num_proxy_sizes, &data, index_rebuild_ffmpeg_proxy_output_cb, &settings);
 
   if (!context->start_pts_set) {
     context->start_pts = pts;
@@ -1395,6 +1414,9 @@ void IMB_free_indices(struct anim *anim)
 {
   int i;
 
+  /* The decoding thread reads the indices. */
+  IMB_anim_decode_ahead_stop(anim);
+
   for (i = 0; i < IMB_PROXY_MAX_SLOT; i++) {
     if (anim->proxy_anim[i]) {
       IMB_close_anim(anim->proxy_anim[i]);
@@ -1443,7 +1465,8 @@ struct anim *IMB_anim_open_proxy(struct anim *anim, IMB_Proxy_Size preview_size)
   get_proxy_filename(anim, preview_size, fname, false);
 
   /* proxies are generated in the same color space as animation itself */
-  anim->proxy_anim[i] = IMB_open_anim(fname, 0, 0, anim->colorspace);
+  anim->proxy_anim[i] = IMB_open_anim(
+      fname, anim->ib_flags & IB_animdecodeahead, 0, anim->colorspace);
 
   anim->proxies_tried |= preview_size;
 
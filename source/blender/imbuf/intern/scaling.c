@@ -23,9 +23,14 @@
  */
 
 #include <math.h>
+#include <string.h>
 
+#include "BLI_math_base.h"
 #include "BLI_math_color.h"
 #include "BLI_math_interp.h"
+#include "BLI_math_vector.h"
+#include "BLI_simd.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 #include "MEM_guardedalloc.h"
 
@@ -1810,121 +1815,337 @@ bool IMB_scalefastImBuf(struct ImBuf *ibuf, unsigned int newx, unsigned int newy
   return true;
 }
 
-/* ******** threaded scaling ******** */
-
-typedef struct ScaleTreadInitData {
-  ImBuf *ibuf;
+/* ******** filtered scaling ******** */
 
-  unsigned int newx;
-  unsigned int newy;
+/* Weights of one resampling pass. Every output pixel is a weighted sum of `count` consecutive
+ * input pixels beginning at `start`, the weights are stored `taps` apart. */
+typedef struct ScaleFilterWeights {
+  int *start;
+  int *count;
+  float *weights;
+  int taps;
+} ScaleFilterWeights;
 
-  unsigned char *byte_buffer;
-  float *float_buffer;
-} ScaleTreadInitData;
+static float scale_filter_radius(eIMBScaleFilter filter)
+{
+  switch (filter) {
+    case IMB_SCALE_FILTER_BOX:
+      return 0.5f;
+    case IMB_SCALE_FILTER_BILINEAR:
+      return 1.0f;
+    case IMB_SCALE_FILTER_BICUBIC:
+      return 2.0f;
+    case IMB_SCALE_FILTER_LANCZOS:
+      return 3.0f;
+  }
+  BLI_assert_unreachable();
+  return 1.0f;
+}
 
-typedef struct ScaleThreadData {
-  ImBuf *ibuf;
+static float scale_filter_sinc(float x)
+{
+  if (x == 0.0f) {
+    return 1.0f;
+  }
+  x *= (float)M_PI;
+  return sinf(x) / x;
+}
 
-  unsigned int newx;
-  unsigned int newy;
+static float scale_filter_eval(eIMBScaleFilter filter, float x)
+{
+  x = fabsf(x);
+  switch (filter) {
+    case IMB_SCALE_FILTER_BOX:
+      return (x <= 0.5f) ? 1.0f : 0.0f;
+    case IMB_SCALE_FILTER_BILINEAR:
+      return (x < 1.0f) ? 1.0f - x : 0.0f;
+    case IMB_SCALE_FILTER_BICUBIC:
+      if (x < 1.0f) {
+        return (1.5f * x - 2.5f) * x * x + 1.0f;
+      }
+      if (x < 2.0f) {
+        return ((-0.5f * x + 2.5f) * x - 4.0f) * x + 2.0f;
+      }
+      return 0.0f;
+    case IMB_SCALE_FILTER_LANCZOS:
+      return (x < 3.0f) ? scale_filter_sinc(x) * scale_filter_sinc(x / 3.0f) : 0.0f;
+  }
+  return 0.0f;
+}
 
-  int start_line;
-  int tot_line;
+static void scale_filter_weights_init(ScaleFilterWeights *fw,
+                                      eIMBScaleFilter filter,
+                                      int src_size,
+                                      int dst_size)
+{
+  const float scale = (float)dst_size / (float)src_size;
+  /* Widen the filter when downscaling, so it covers all input pixels. */
+  const float filter_scale = min_ff(scale, 1.0f);
+  const float support = scale_filter_radius(filter) / filter_scale;
+
+  fw->taps = (int)ceilf(support * 2.0f) + 2;
+  fw->start = MEM_mallocN(sizeof(int) * dst_size, "scale filter start");
+  fw->count = MEM_mallocN(sizeof(int) * dst_size, "scale filter count");
+  fw->weights = MEM_callocN(sizeof(float) * dst_size * fw->taps, "scale filter weights");
+
+  for (int i = 0; i < dst_size; i++) {
+    const float center = ((float)i + 0.5f) / scale;
+    const int start = max_ii((int)floorf(center - support), 0);
+    const int end = min_ii((int)ceilf(center + support), src_size);
+    const int count = min_ii(end - start, fw->taps);
+    float *weights = fw->weights + (size_t)i * fw->taps;
+    float total = 0.0f;
+
+    for (int k = 0; k < count; k++) {
+      weights[k] = scale_filter_eval(filter, ((float)(start + k) + 0.5f - center) * filter_scale);
+      total += weights[k];
+    }
 
-  unsigned char *byte_buffer;
-  float *float_buffer;
-} ScaleThreadData;
+    if (total != 0.0f) {
+      for (int k = 0; k < count; k++) {
+        weights[k] /= total;
+      }
+      fw->start[i] = start;
+      fw->count[i] = count;
+    }
+    else {
+      /* Can only happen for degenerate sizes, fall back to the nearest pixel. */
+      weights[0] = 1.0f;
+      fw->start[i] = clamp_i((int)center, 0, src_size - 1);
+      fw->count[i] = 1;
+    }
+  }
+}
 
-static void scale_thread_init(void *data_v, int start_line, int tot_line, void *init_data_v)
+static void scale_filter_weights_free(ScaleFilterWeights *fw)
 {
-  ScaleThreadData *data = (ScaleThreadData *)data_v;
-  ScaleTreadInitData *init_data = (ScaleTreadInitData *)init_data_v;
-
-  data->ibuf = init_data->ibuf;
+  MEM_freeN(fw->start);
+  MEM_freeN(fw->count);
+  MEM_freeN(fw->weights);
+}
 
-  data->newx = init_data->newx;
-  data->newy = init_data->newy;
+/* Weighted sum of `count` pixels lying `stride` floats apart. */
+BLI_INLINE void scale_filter_accumulate_float(float *dst,
+                                              const float *src,
+                                              const size_t stride,
+                                              const float *weights,
+                                              const int count,
+                                              const int channels)
+{
+#ifdef BLI_HAVE_SSE2
+  if (channels == 4) {
+    __m128 accum = _mm_setzero_ps();
+    for (int k = 0; k < count; k++, src += stride) {
+      accum = _mm_add_ps(accum, _mm_mul_ps(_mm_loadu_ps(src), _mm_set1_ps(weights[k])));
+    }
+    _mm_storeu_ps(dst, accum);
+    return;
+  }
+#endif
+  for (int c = 0; c < channels; c++) {
+    dst[c] = 0.0f;
+  }
+  for (int k = 0; k < count; k++, src += stride) {
+    for (int c = 0; c < channels; c++) {
+      dst[c] += src[c] * weights[k];
+    }
+  }
+}
 
-  data->start_line = start_line;
-  data->tot_line = tot_line;
+/* Weighted sum of `count` byte RGBA pixels lying `stride` bytes apart. */
+BLI_INLINE void scale_filter_accumulate_byte(float dst[4],
+                                             const unsigned char *src,
+                                             const size_t stride,
+                                             const float *weights,
+                                             const int count)
+{
+#ifdef BLI_HAVE_SSE2
+  const __m128i zero = _mm_setzero_si128();
+  __m128 accum = _mm_setzero_ps();
+  for (int k = 0; k < count; k++, src += stride) {
+    int32_t pixel;
+    memcpy(&pixel, src, sizeof(pixel));
+    const __m128i pixel_i32 = _mm_unpacklo_epi16(
+        _mm_unpacklo_epi8(_mm_cvtsi32_si128(pixel), zero), zero);
+    accum = _mm_add_ps(accum, _mm_mul_ps(_mm_cvtepi32_ps(pixel_i32), _mm_set1_ps(weights[k])));
+  }
+  _mm_storeu_ps(dst, accum);
+#else
+  zero_v4(dst);
+  for (int k = 0; k < count; k++, src += stride) {
+    for (int c = 0; c < 4; c++) {
+      dst[c] += (float)src[c] * weights[k];
+    }
+  }
+#endif
+}
 
-  data->byte_buffer = init_data->byte_buffer;
-  data->float_buffer = init_data->float_buffer;
+BLI_INLINE void scale_filter_store_byte(unsigned char dst[4], const float src[4])
+{
+#ifdef BLI_HAVE_SSE2
+  __m128i pixel = _mm_cvtps_epi32(_mm_loadu_ps(src));
+  pixel = _mm_packs_epi32(pixel, pixel);
+  pixel = _mm_packus_epi16(pixel, pixel);
+  const int32_t result = _mm_cvtsi128_si32(pixel);
+  memcpy(dst, &result, sizeof(result));
+#else
+  for (int c = 0; c < 4; c++) {
+    dst[c] = (unsigned char)clamp_f(src[c] + 0.5f, 0.0f, 255.0f);
+  }
+#endif
 }
 
-static void *do_scale_thread(void *data_v)
+typedef struct ScaleFilterData {
+  const ScaleFilterWeights *weights_x;
+  const ScaleFilterWeights *weights_y;
+  int src_x;
+  int dst_x;
+  int channels;
+
+  const unsigned char *src_byte;
+  const float *src_float;
+  /* Result of the horizontal pass, `dst_x` by `src_y` pixels. */
+  float *temp;
+  unsigned char *dst_byte;
+  float *dst_float;
+} ScaleFilterData;
+
+static void scale_filter_horizontal_cb(void *__restrict userdata,
+                                       const int y,
+                                       const TaskParallelTLS *__restrict UNUSED(tls))
 {
-  ScaleThreadData *data = (ScaleThreadData *)data_v;
-  ImBuf *ibuf = data->ibuf;
-  int i;
-  float factor_x = (float)ibuf->x / data->newx;
-  float factor_y = (float)ibuf->y / data->newy;
-
-  for (i = 0; i < data->tot_line; i++) {
-    int y = data->start_line + i;
-    int x;
-
-    for (x = 0; x < data->newx; x++) {
-      float u = (float)x * factor_x;
-      float v = (float)y * factor_y;
-      int offset = y * data->newx + x;
-
-      if (data->byte_buffer) {
-        unsigned char *pixel = data->byte_buffer + 4 * offset;
-        BLI_bilinear_interpolation_char(
-            (unsigned char *)ibuf->rect, pixel, ibuf->x, ibuf->y, 4, u, v);
-      }
+  const ScaleFilterData *data = userdata;
+  const ScaleFilterWeights *fw = data->weights_x;
+  const int channels = data->channels;
+  float *dst = data->temp + (size_t)y * data->dst_x * channels;
 
-      if (data->float_buffer) {
-        float *pixel = data->float_buffer + ibuf->channels * offset;
-        BLI_bilinear_interpolation_fl(
-            ibuf->rect_float, pixel, ibuf->x, ibuf->y, ibuf->channels, u, v);
-      }
+  for (int x = 0; x < data->dst_x; x++, dst += channels) {
+    const float *weights = fw->weights + (size_t)x * fw->taps;
+    const size_t src_offset = (size_t)y * data->src_x + fw->start[x];
+
+    if (data->src_byte) {
+      scale_filter_accumulate_byte(dst, data->src_byte + src_offset * 4, 4, weights, fw->count[x]);
+    }
+    else {
+      scale_filter_accumulate_float(dst,
+                                    data->src_float + src_offset * channels,
+                                    channels,
+                                    weights,
+                                    fw->count[x],
+                                    channels);
     }
   }
+}
 
-  return NULL;
+static void scale_filter_vertical_cb(void *__restrict userdata,
+                                     const int y,
+                                     const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const ScaleFilterData *data = userdata;
+  const ScaleFilterWeights *fw = data->weights_y;
+  const int channels = data->channels;
+  const size_t row_stride = (size_t)data->dst_x * channels;
+  const float *weights = fw->weights + (size_t)y * fw->taps;
+  const float *src = data->temp + fw->start[y] * row_stride;
+
+  for (int x = 0; x < data->dst_x; x++, src += channels) {
+    const size_t dst_offset = ((size_t)y * data->dst_x + x) * channels;
+
+    if (data->dst_byte) {
+      float pixel[4];
+      scale_filter_accumulate_float(pixel, src, row_stride, weights, fw->count[y], 4);
+      scale_filter_store_byte(data->dst_byte + dst_offset, pixel);
+    }
+    else {
+      scale_filter_accumulate_float(
+          data->dst_float + dst_offset, src, row_stride, weights, fw->count[y], channels);
+    }
+  }
 }
 
-void IMB_scaleImBuf_threaded(ImBuf *ibuf, unsigned int newx, unsigned int newy)
+static void scale_filter_apply(ScaleFilterData *data, int src_y, int dst_y)
 {
-  BLI_assert_msg(newx > 0 && newy > 0, "Images must be at least 1 on both dimensions!");
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 8;
 
-  ScaleTreadInitData init_data = {NULL};
+  data->temp = MEM_mallocN(sizeof(float) * data->channels * data->dst_x * src_y,
+                           "scale filter temp");
 
-  /* prepare initialization data */
-  init_data.ibuf = ibuf;
+  BLI_task_parallel_range(0, src_y, data, scale_filter_horizontal_cb, &settings);
+  BLI_task_parallel_range(0, dst_y, data, scale_filter_vertical_cb, &settings);
 
-  init_data.newx = newx;
-  init_data.newy = newy;
+  MEM_freeN(data->temp);
+  data->temp = NULL;
+}
 
-  if (ibuf->rect) {
-    init_data.byte_buffer = MEM_mallocN(4 * newx * newy * sizeof(char),
-                                        "threaded scale byte buffer");
+bool IMB_scaleImBuf_filter(struct ImBuf *ibuf,
+                           unsigned int newx,
+                           unsigned int newy,
+                           eIMBScaleFilter filter)
+{
+  BLI_assert_msg(newx > 0 && newy > 0, "Images must be at least 1 on both dimensions!");
+
+  if (ibuf == NULL) {
+    return false;
+  }
+  if (ibuf->rect == NULL && ibuf->rect_float == NULL) {
+    return false;
   }
 
-  if (ibuf->rect_float) {
-    init_data.float_buffer = MEM_mallocN(ibuf->channels * newx * newy * sizeof(float),
-                                         "threaded scale float buffer");
+  if (newx == ibuf->x && newy == ibuf->y) {
+    return false;
   }
 
-  /* actual scaling threads */
-  IMB_processor_apply_threaded(
-      newy, sizeof(ScaleThreadData), &init_data, scale_thread_init, do_scale_thread);
+  scalefast_Z_ImBuf(ibuf, newx, newy);
 
-  /* alter image buffer */
-  ibuf->x = newx;
-  ibuf->y = newy;
+  ScaleFilterWeights weights_x, weights_y;
+  scale_filter_weights_init(&weights_x, filter, ibuf->x, newx);
+  scale_filter_weights_init(&weights_y, filter, ibuf->y, newy);
+
+  ScaleFilterData data = {NULL};
+  data.weights_x = &weights_x;
+  data.weights_y = &weights_y;
+  data.src_x = ibuf->x;
+  data.dst_x = newx;
 
   if (ibuf->rect) {
+    data.channels = 4;
+    data.src_byte = (unsigned char *)ibuf->rect;
+    data.dst_byte = MEM_mallocN(sizeof(char[4]) * newx * newy, "scale filter byte buffer");
+    scale_filter_apply(&data, ibuf->y, newy);
+
     imb_freerectImBuf(ibuf);
     ibuf->mall |= IB_rect;
-    ibuf->rect = (unsigned int *)init_data.byte_buffer;
+    ibuf->rect = (unsigned int *)data.dst_byte;
+
+    data.src_byte = NULL;
+    data.dst_byte = NULL;
   }
 
   if (ibuf->rect_float) {
+    data.channels = ibuf->channels;
+    data.src_float = ibuf->rect_float;
+    data.dst_float = MEM_mallocN(sizeof(float) * ibuf->channels * newx * newy,
+                                 "scale filter float buffer");
+    scale_filter_apply(&data, ibuf->y, newy);
+
     imb_freerectfloatImBuf(ibuf);
     ibuf->mall |= IB_rectfloat;
-    ibuf->rect_float = init_data.float_buffer;
+    ibuf->rect_float = data.dst_float;
   }
+
+  scale_filter_weights_free(&weights_x);
+  scale_filter_weights_free(&weights_y);
+
+  ibuf->x = newx;
+  ibuf->y = newy;
+  return true;
+}
+
+/* ******** threaded scaling ******** */
+
+void IMB_scaleImBuf_threaded(ImBuf *ibuf, unsigned int newx, unsigned int newy)
+{
+  IMB_scaleImBuf_filter(ibuf, newx, newy, IMB_SCALE_FILTER_BILINEAR);
 }
@@ -2265,9 +2265,20 @@ typedef struct NodesModifierData {
   /* Contains logged information from the last evaluation. This can be used to help the user to
    * debug a node tree. */
   void *runtime_eval_log;
-  void *_pad1;
+  /* Results of nodes from previous evaluations, which are reused when the inputs and settings of
+   * a node did not change. Only used with #NODES_MODIFIER_CACHE_RESULTS. */
+  void *runtime_results_cache;
+  /** #NodesModifierFlag. */
+  int flag;
+  char _pad[4];
 } NodesModifierData;
 
+/* NodesModifierData->flag */
+typedef enum NodesModifierFlag {
+  /** Keep the outputs of nodes between evaluations and reuse them when nothing changed. */
+  NODES_MODIFIER_CACHE_RESULTS = (1 << 0),
+} NodesModifierFlag;
+
 typedef struct MeshToVolumeModifierData {
   ModifierData modifier;
 
@@ -524,6 +524,9 @@ typedef struct bNodeTree {
   int chunksize;
   /** Execution mode to use for compositor engine. */
   int execution_mode;
+  /** Memory limit in megabytes for full frame execution, 0 means unlimited. */
+  int memory_limit;
+  char _pad1[4];
 
   rctf viewer_border;
 
@@ -583,6 +586,7 @@ typedef struct bNodeTree {
 
 /* tree is localized copy, free when deleting node groups */
 /* #define NTREE_IS_LOCALIZED           (1 << 5) */
+#define NTREE_COM_RESULT_CACHE (1 << 6) /* keep operation results between executions */
 
 /* ntree->update */
 typedef enum eNodeTreeUpdate {
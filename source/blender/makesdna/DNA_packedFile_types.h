@@ -30,7 +30,13 @@ extern "C" {
 typedef struct PackedFile {
   int size;
   int seek;
+  /** May be NULL when the data is still in the .blend file, see #BKE_packedfile_ensure_data. */
   void *data;
+  /**
+   * Runtime only, location of the data in the .blend file it was read from, while #data is NULL.
+   * Cleared when writing files, kept in undo steps.
+   */
+  struct BlendLazyData *lazy_data;
 } PackedFile;
 
 #ifdef __cplusplus
@@ -1139,6 +1139,9 @@ typedef struct DNA_ReconstructInfo {
 
   int *step_counts;
   ReconstructStep **steps;
+
+  /** Index in newsdna for every struct in oldsdna, -1 if it doesn't exist anymore. */
+  int *new_struct_nrs;
 } DNA_ReconstructInfo;
 
 static void reconstruct_structs(const DNA_ReconstructInfo *reconstruct_info,
@@ -1242,12 +1245,9 @@ void *DNA_struct_reconstruct(const DNA_ReconstructInfo *reconstruct_info,
                              int blocks,
                              const void *old_blocks)
 {
-  const SDNA *oldsdna = reconstruct_info->oldsdna;
   const SDNA *newsdna = reconstruct_info->newsdna;
 
-  const SDNA_Struct *old_struct = oldsdna->structs[old_struct_nr];
-  const char *type_name = oldsdna->types[old_struct->type];
-  const int new_struct_nr = DNA_struct_find_nr(newsdna, type_name);
+  const int new_struct_nr = reconstruct_info->new_struct_nrs[old_struct_nr];
 
   if (new_struct_nr == -1) {
     return NULL;
@@ -1534,9 +1534,123 @@ static int compress_reconstruct_steps(ReconstructStep *steps, const int old_step
   return new_step_count;
 }
 
+/* Substruct arrays are only inlined into the parent struct when this does not result in more
+ * steps than this. Larger arrays are reconstructed with a #RECONSTRUCT_STEP_SUBSTRUCT step. */
+#define RECONSTRUCT_FLATTEN_MAX_STEPS 256
+
+typedef struct ReconstructStepBuffer {
+  ReconstructStep *steps;
+  int len;
+  int capacity;
+} ReconstructStepBuffer;
+
+static void reconstruct_step_buffer_append(ReconstructStepBuffer *buffer,
+                                           const ReconstructStep *step)
+{
+  if (buffer->len == buffer->capacity) {
+    buffer->capacity = MAX2(16, buffer->capacity * 2);
+    buffer->steps = MEM_reallocN(buffer->steps, sizeof(ReconstructStep) * buffer->capacity);
+  }
+  buffer->steps[buffer->len++] = *step;
+}
+
+/**
+ * Appends the given steps to the buffer with their offsets shifted, replacing substruct steps
+ * with the steps of the substruct itself. This results in a flat list of steps for nested
+ * structs, so that memcpy steps of neighboring members can be merged across struct boundaries
+ * by #compress_reconstruct_steps.
+ *
+ * The steps of substructs are expected to be flattened already.
+ */
+static void flatten_reconstruct_steps(const DNA_ReconstructInfo *reconstruct_info,
+                                      const ReconstructStep *steps,
+                                      const int steps_len,
+                                      const int old_offset,
+                                      const int new_offset,
+                                      ReconstructStepBuffer *r_buffer)
+{
+  for (int a = 0; a < steps_len; a++) {
+    ReconstructStep step = steps[a];
+    switch (step.type) {
+      case RECONSTRUCT_STEP_MEMCPY:
+        step.data.memcpy.old_offset += old_offset;
+        step.data.memcpy.new_offset += new_offset;
+        break;
+      case RECONSTRUCT_STEP_CAST_PRIMITIVE:
+        step.data.cast_primitive.old_offset += old_offset;
+        step.data.cast_primitive.new_offset += new_offset;
+        break;
+      case RECONSTRUCT_STEP_CAST_POINTER_TO_32:
+      case RECONSTRUCT_STEP_CAST_POINTER_TO_64:
+        step.data.cast_pointer.old_offset += old_offset;
+        step.data.cast_pointer.new_offset += new_offset;
+        break;
+      case RECONSTRUCT_STEP_SUBSTRUCT: {
+        const int sub_new_struct_nr = step.data.substruct.new_struct_nr;
+        const int sub_old_struct_nr = step.data.substruct.old_struct_nr;
+        const int array_len = step.data.substruct.array_len;
+        const int sub_steps_len = reconstruct_info->step_counts[sub_new_struct_nr];
+        if (array_len * sub_steps_len <= RECONSTRUCT_FLATTEN_MAX_STEPS) {
+          const SDNA *oldsdna = reconstruct_info->oldsdna;
+          const SDNA *newsdna = reconstruct_info->newsdna;
+          const int old_size = oldsdna->types_size[oldsdna->structs[sub_old_struct_nr]->type];
+          const int new_size = newsdna->types_size[newsdna->structs[sub_new_struct_nr]->type];
+          for (int i = 0; i < array_len; i++) {
+            flatten_reconstruct_steps(reconstruct_info,
+                                      reconstruct_info->steps[sub_new_struct_nr],
+                                      sub_steps_len,
+                                      old_offset + step.data.substruct.old_offset + i * old_size,
+                                      new_offset + step.data.substruct.new_offset + i * new_size,
+                                      r_buffer);
+          }
+          continue;
+        }
+        step.data.substruct.old_offset += old_offset;
+        step.data.substruct.new_offset += new_offset;
+        break;
+      }
+      case RECONSTRUCT_STEP_INIT_ZERO:
+        continue;
+    }
+    reconstruct_step_buffer_append(r_buffer, &step);
+  }
+}
+
+static void flatten_struct_reconstruct_steps(DNA_ReconstructInfo *reconstruct_info,
+                                             const int new_struct_nr,
+                                             bool *flattened)
+{
+  if (flattened[new_struct_nr]) {
+    return;
+  }
+  flattened[new_struct_nr] = true;
+
+  ReconstructStep *steps = reconstruct_info->steps[new_struct_nr];
+  const int steps_len = reconstruct_info->step_counts[new_struct_nr];
+
+  /* Substructs are flattened first, so their steps can be inlined as is. */
+  for (int a = 0; a < steps_len; a++) {
+    if (steps[a].type == RECONSTRUCT_STEP_SUBSTRUCT) {
+      flatten_struct_reconstruct_steps(
+          reconstruct_info, steps[a].data.substruct.new_struct_nr, flattened);
+    }
+  }
+
+  ReconstructStepBuffer buffer = {NULL, 0, 0};
+  flatten_reconstruct_steps(reconstruct_info, steps, steps_len, 0, 0, &buffer);
+  MEM_SAFE_FREE(reconstruct_info->steps[new_struct_nr]);
+
+  reconstruct_info->steps[new_struct_nr] = buffer.steps;
+  reconstruct_info->step_counts[new_struct_nr] = compress_reconstruct_steps(buffer.steps,
+                                                                            buffer.len);
+}
+
 /**
  * Pre-process information about how structs in \a newsdna can be reconstructed from structs in
  * \a oldsdna. This information is then used to speedup #DNA_struct_reconstruct.
+ *
+ * The steps of nested structs are inlined, so that reconstructing a struct is a flat list of
+ * merged memcpy and conversion steps in most cases.
  */
 DNA_ReconstructInfo *DNA_reconstruct_info_create(const SDNA *oldsdna,
                                                  const SDNA *newsdna,
@@ -1582,6 +1696,22 @@ DNA_ReconstructInfo *DNA_reconstruct_info_create(const SDNA *oldsdna,
     UNUSED_VARS(print_reconstruct_step);
   }
 
+  /* Inline the steps of substructs. */
+  bool *flattened = MEM_calloc_arrayN(newsdna->structs_len, sizeof(bool), __func__);
+  for (int new_struct_nr = 0; new_struct_nr < newsdna->structs_len; new_struct_nr++) {
+    flatten_struct_reconstruct_steps(reconstruct_info, new_struct_nr, flattened);
+  }
+  MEM_freeN(flattened);
+
+  /* Avoid looking up the struct by name for every reconstructed block. */
+  reconstruct_info->new_struct_nrs = MEM_malloc_arrayN(
+      oldsdna->structs_len, sizeof(int), __func__);
+  for (int old_struct_nr = 0; old_struct_nr < oldsdna->structs_len; old_struct_nr++) {
+    const SDNA_Struct *old_struct = oldsdna->structs[old_struct_nr];
+    reconstruct_info->new_struct_nrs[old_struct_nr] = DNA_struct_find_nr(
+        newsdna, oldsdna->types[old_struct->type]);
+  }
+
   return reconstruct_info;
 }
 
@@ -1594,6 +1724,7 @@ void DNA_reconstruct_info_free(DNA_ReconstructInfo *reconstruct_info)
   }
   MEM_freeN(reconstruct_info->steps);
   MEM_freeN(reconstruct_info->step_counts);
+  MEM_freeN(reconstruct_info->new_struct_nrs);
   MEM_freeN(reconstruct_info);
 }
 
@@ -1615,12 +1615,35 @@ static void rna_NodesModifier_node_group_update(Main *bmain, Scene *scene, Point
   MOD_nodes_update_interface(object, nmd);
 }
 
+static void rna_NodesModifier_use_results_cache_update(Main *bmain, Scene *scene, PointerRNA *ptr)
+{
+  NodesModifierData *nmd = ptr->data;
+  if (!(nmd->flag & NODES_MODIFIER_CACHE_RESULTS)) {
+    /* Not freed by the evaluation, other evaluations may still be using the cache. */
+    MOD_nodes_free_results_cache(nmd);
+  }
+  rna_Modifier_update(bmain, scene, ptr);
+}
+
 static IDProperty **rna_NodesModifier_properties(PointerRNA *ptr)
 {
   NodesModifierData *nmd = ptr->data;
   NodesModifierSettings *settings = &nmd->settings;
   return &settings->properties;
 }
+
+static void rna_NodesModifier_write_execution_trace(NodesModifierData *nmd,
+                                                    ReportList *reports,
+                                                    const char *filepath)
+{
+  if (nmd->runtime_eval_log == NULL) {
+    BKE_report(reports, RPT_ERROR, "The modifier has no logged evaluation");
+    return;
+  }
+  if (!MOD_nodes_write_execution_trace(nmd, filepath)) {
+    BKE_reportf(reports, RPT_ERROR, "Could not write execution trace to '%s'", filepath);
+  }
+}
 #else
 
 static void rna_def_property_subdivision_common(StructRNA *srna)
@@ -6928,6 +6951,8 @@ static void rna_def_modifier_nodes(BlenderRNA *brna)
 {
   StructRNA *srna;
   PropertyRNA *prop;
+  FunctionRNA *func;
+  PropertyRNA *parm;
 
   srna = RNA_def_struct(brna, "NodesModifier", "Modifier");
   RNA_def_struct_ui_text(srna, "Nodes Modifier", "");
@@ -6943,7 +6968,25 @@ static void rna_def_modifier_nodes(BlenderRNA *brna)
   RNA_def_property_flag(prop, PROP_EDITABLE);
   RNA_def_property_update(prop, 0, "rna_NodesModifier_node_group_update");
 
+  prop = RNA_def_property(srna, "use_results_cache", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_boolean_sdna(prop, NULL, "flag", NODES_MODIFIER_CACHE_RESULTS);
+  RNA_def_property_ui_text(prop,
+                           "Cache Node Results",
+                           "Keep the outputs of nodes between evaluations, so that only nodes "
+                           "whose inputs or settings changed are executed again (uses more "
+                           "memory)");
+  RNA_def_property_update(prop, 0, "rna_NodesModifier_use_results_cache_update");
+
   RNA_define_lib_overridable(false);
+
+  func = RNA_def_function(
+      srna, "write_execution_trace", "rna_NodesModifier_write_execution_trace");
+  RNA_def_function_ui_description(func,
+                                  "Write the node execution times of the last evaluation to a "
+                                  "file in the Chrome trace event format");
+  RNA_def_function_flag(func, FUNC_USE_REPORTS);
+  parm = RNA_def_string_file_path(func, "filepath", NULL, 0, "", "Path of the JSON file to write");
+  RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
 }
 
 static void rna_def_modifier_mesh_to_volume(BlenderRNA *brna)
@@ -481,6 +481,24 @@ static int rna_Sequence_frame_length_get(PointerRNA *ptr)
   return SEQ_transform_get_right_handle_frame(seq) - SEQ_transform_get_left_handle_frame(seq);
 }
 
+static float rna_Sequence_cache_memory_usage_get(PointerRNA *ptr)
+{
+  Scene *scene = (Scene *)ptr->owner_id;
+  Sequence *seq = (Sequence *)ptr->data;
+  SeqCacheStripStats stats;
+  SEQ_cache_strip_stats_get(scene, seq, &stats);
+  return (float)stats.memory_size / (1024.0f * 1024.0f);
+}
+
+static float rna_Sequence_cache_render_cost_get(PointerRNA *ptr)
+{
+  Scene *scene = (Scene *)ptr->owner_id;
+  Sequence *seq = (Sequence *)ptr->data;
+  SeqCacheStripStats stats;
+  SEQ_cache_strip_stats_get(scene, seq, &stats);
+  return stats.cost_total;
+}
+
 static int rna_Sequence_frame_editable(PointerRNA *ptr, const char **UNUSED(r_info))
 {
   Sequence *seq = (Sequence *)ptr->data;
@@ -2061,6 +2079,20 @@ static void rna_def_sequence(BlenderRNA *brna)
   RNA_def_property_boolean_sdna(prop, NULL, "cache_flag", SEQ_CACHE_OVERRIDE);
   RNA_def_property_ui_text(prop, "Override Cache Settings", "Override global cache settings");
 
+  prop = RNA_def_property(srna, "cache_memory_usage", PROP_FLOAT, PROP_NONE);
+  RNA_def_property_clear_flag(prop, PROP_EDITABLE | PROP_ANIMATABLE);
+  RNA_def_property_float_funcs(prop, "rna_Sequence_cache_memory_usage_get", NULL, NULL);
+  RNA_def_property_ui_text(
+      prop, "Cache Memory Usage", "Memory used by cached images of this strip, in megabytes");
+
+  prop = RNA_def_property(srna, "cache_render_cost", PROP_FLOAT, PROP_NONE);
+  RNA_def_property_clear_flag(prop, PROP_EDITABLE | PROP_ANIMATABLE);
+  RNA_def_property_float_funcs(prop, "rna_Sequence_cache_render_cost_get", NULL, NULL);
+  RNA_def_property_ui_text(prop,
+                           "Cache Render Cost",
+                           "Time it took to render cached images of this strip, in frame "
+                           "durations. Images with higher cost are kept in cache for longer");
+
   RNA_api_sequence_strip(srna);
 }
 
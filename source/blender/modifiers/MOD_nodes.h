@@ -28,6 +28,18 @@ void MOD_nodes_update_interface(struct Object *object, struct NodesModifierData
 
 void MOD_nodes_init(struct Main *bmain, struct NodesModifierData *nmd);
 
+/**
+ * Write the node executions of the last evaluation as Chrome trace JSON.
+ * \return False when there is no logged evaluation or the file could not be written.
+ */
+bool MOD_nodes_write_execution_trace(const struct NodesModifierData *nmd, const char *filepath);
+
+/**
+ * Free the node results cache of an original modifier. Must not be called while the modifier
+ * is evaluated, e.g. it is called when caching is disabled.
+ */
+void MOD_nodes_free_results_cache(struct NodesModifierData *nmd);
+
 #ifdef __cplusplus
 }
 #endif
@@ -22,7 +22,9 @@
  */
 
 #include <cstring>
+#include <fstream>
 #include <iostream>
+#include <mutex>
 #include <string>
 
 #include "MEM_guardedalloc.h"
@@ -108,6 +110,7 @@ using blender::bke::OutputAttribute;
 using blender::fn::GField;
 using blender::fn::GMutablePointer;
 using blender::fn::GPointer;
+using blender::modifiers::geometry_nodes::NodeResultsCache;
 using blender::nodes::FieldInferencingInterface;
 using blender::nodes::GeoNodeExecParams;
 using blender::nodes::InputSocketFieldType;
@@ -826,6 +829,54 @@ static void clear_runtime_data(NodesModifierData *nmd)
   }
 }
 
+static void clear_results_cache(NodesModifierData *nmd)
+{
+  if (nmd->runtime_results_cache != nullptr) {
+    delete (NodeResultsCache *)nmd->runtime_results_cache;
+    nmd->runtime_results_cache = nullptr;
+  }
+}
+
+void MOD_nodes_free_results_cache(NodesModifierData *nmd)
+{
+  clear_results_cache(nmd);
+}
+
+/**
+ * The cache is stored on the original modifier so that it persists when the evaluated copy is
+ * recreated. Returns null when caching is disabled.
+ *
+ * The cache is never freed during evaluation since other evaluations of the same original
+ * modifier may be using it, see #MOD_nodes_free_results_cache.
+ */
+static NodeResultsCache *ensure_results_cache(NodesModifierData *nmd)
+{
+  if (!(nmd->flag & NODES_MODIFIER_CACHE_RESULTS)) {
+    return nullptr;
+  }
+  NodesModifierData *nmd_orig = (NodesModifierData *)BKE_modifier_get_original(&nmd->modifier);
+  static std::mutex mutex;
+  std::lock_guard lock{mutex};
+  if (nmd_orig->runtime_results_cache == nullptr) {
+    nmd_orig->runtime_results_cache = new NodeResultsCache();
+  }
+  return (NodeResultsCache *)nmd_orig->runtime_results_cache;
+}
+
+bool MOD_nodes_write_execution_trace(const NodesModifierData *nmd, const char *filepath)
+{
+  if (nmd->runtime_eval_log == nullptr) {
+    return false;
+  }
+  const geo_log::ModifierLog &log = *static_cast<geo_log::ModifierLog *>(nmd->runtime_eval_log);
+  std::ofstream stream(filepath);
+  if (!stream) {
+    return false;
+  }
+  log.write_chrome_trace(stream);
+  return bool(stream);
+}
+
 static void store_field_on_geometry_component(GeometryComponent &component,
                                               const StringRef attribute_name,
                                               AttributeDomain domain,
@@ -962,6 +1013,7 @@ static GeometrySet compute_geometry(const DerivedNodeTree &tree,
   eval_params.depsgraph = ctx->depsgraph;
   eval_params.self_object = ctx->object;
   eval_params.geo_logger = geo_logger.has_value() ? &*geo_logger : nullptr;
+  eval_params.results_cache = ensure_results_cache(nmd);
   blender::modifiers::geometry_nodes::evaluate_geometry_nodes(eval_params);
 
   if (geo_logger.has_value()) {
@@ -1223,6 +1275,8 @@ static void panel_draw(const bContext *C, Panel *panel)
     }
   }
 
+  uiItemR(layout, ptr, "use_results_cache", 0, nullptr, ICON_NONE);
+
   /* Draw node warnings. */
   bool has_legacy_node = false;
   if (nmd->runtime_eval_log != nullptr) {
@@ -1296,6 +1350,7 @@ static void blendRead(BlendDataReader *reader, ModifierData *md)
   BLO_read_data_address(reader, &nmd->settings.properties);
   IDP_BlendDataRead(reader, &nmd->settings.properties);
   nmd->runtime_eval_log = nullptr;
+  nmd->runtime_results_cache = nullptr;
 }
 
 static void copyData(const ModifierData *md, ModifierData *target, const int flag)
@@ -1306,6 +1361,7 @@ static void copyData(const ModifierData *md, ModifierData *target, const int fla
   BKE_modifier_copydata_generic(md, target, flag);
 
   tnmd->runtime_eval_log = nullptr;
+  tnmd->runtime_results_cache = nullptr;
 
   if (nmd->settings.properties != nullptr) {
     tnmd->settings.properties = IDP_CopyProperty_ex(nmd->settings.properties, flag);
@@ -1321,6 +1377,7 @@ static void freeData(ModifierData *md)
   }
 
   clear_runtime_data(nmd);
+  clear_results_cache(nmd);
 }
 
 static void requiredDataMask(Object *UNUSED(ob),
@@ -16,6 +16,8 @@
 
 #include "MOD_nodes_evaluator.hh"
 
+#include "MEM_guardedalloc.h"
+
 #include "NOD_geometry_exec.hh"
 #include "NOD_type_conversions.hh"
 
@@ -40,6 +42,7 @@ using fn::CPPType;
 using fn::Field;
 using fn::FieldCPPType;
 using fn::GField;
+using fn::GFieldRef;
 using fn::GValueMap;
 using nodes::GeoNodeExecParams;
 using namespace fn::multi_function_types;
@@ -355,6 +358,236 @@ static bool node_supports_laziness(const DNode node)
   return node->typeinfo()->geometry_node_execute_supports_laziness;
 }
 
+/**
+ * Outputs of a node from a previous evaluation, together with everything that is necessary to
+ * check whether they can be reused in the current evaluation.
+ */
+struct NodeResultsCacheEntry : NonCopyable, NonMovable {
+  /** Node settings the outputs were computed with. */
+  const bNodeType *typeinfo = nullptr;
+  short custom1 = 0;
+  short custom2 = 0;
+  float custom3 = 0.0f;
+  float custom4 = 0.0f;
+  Vector<char> storage;
+
+  /**
+   * Copies of the input values, indexed by socket index. Multi-input sockets have a value for
+   * every origin socket in link order.
+   */
+  Vector<Vector<GMutablePointer>> inputs;
+  /** Copies of the computed outputs, indexed by socket index. Null when not computed. */
+  Vector<GMutablePointer> outputs;
+  /** Warnings the node reported while computing the outputs, logged again when reused. */
+  Vector<geo_log::NodeWarning> warnings;
+
+  /** False when the node computed a value that can't be kept after the evaluation. */
+  bool is_cacheable = true;
+  uint64_t last_used_evaluation = 0;
+
+  LinearAllocator<> allocator;
+
+  ~NodeResultsCacheEntry()
+  {
+    for (Vector<GMutablePointer> &values : inputs) {
+      for (GMutablePointer value : values) {
+        value.destruct();
+      }
+    }
+    for (GMutablePointer value : outputs) {
+      if (value.get() != nullptr) {
+        value.destruct();
+      }
+    }
+  }
+
+  GMutablePointer copy_value(const GPointer value)
+  {
+    const CPPType &type = *value.type();
+    void *buffer = allocator.allocate(type.size(), type.alignment());
+    type.copy_construct(value.get(), buffer);
+    return {type, buffer};
+  }
+};
+
+/**
+ * Only nodes whose outputs depend on nothing but their inputs and settings can be cached. Inputs
+ * that reference IDs are not supported, because the referenced data can change without the
+ * pointer changing.
+ */
+static bool node_results_can_be_cached(const DNode node)
+{
+  const bNode &bnode = *node->bnode();
+  if (bnode.typeinfo->geometry_node_execute == nullptr || node_supports_laziness(node)) {
+    return false;
+  }
+  if (bnode.id != nullptr) {
+    return false;
+  }
+  bool has_inputs = false;
+  for (const InputSocketRef *socket : node->inputs()) {
+    if (!socket->is_available()) {
+      continue;
+    }
+    const CPPType *type = get_socket_cpp_type(*socket);
+    if (type == nullptr) {
+      continue;
+    }
+    if (*type != CPPType::get<GeometrySet>() &&
+        dynamic_cast<const FieldCPPType *>(type) == nullptr) {
+      return false;
+    }
+    has_inputs = true;
+  }
+  /* Nodes without inputs are cheap or depend on the evaluation context (e.g. the scene time). */
+  return has_inputs;
+}
+
+static std::string node_results_cache_key(const DNode node)
+{
+  /* Node names are unique within a node tree. The key does not have to be unique, it only
+   * decides which cache entry is checked for the node. */
+  std::string key = node->bnode()->name;
+  for (const DTreeContext *context = node.context(); context->parent_node() != nullptr;
+       context = context->parent_context()) {
+    key = std::string(context->parent_node()->bnode()->name) + "/" + key;
+  }
+  return key;
+}
+
+/**
+ * Fields can only be kept beyond the evaluation if they don't reference multi-functions that are
+ * freed at the end of the evaluation.
+ */
+static bool field_can_be_cached(const GField &field, const nodes::NodeMultiFunctions &mf_by_node)
+{
+  Stack<const fn::FieldNode *> nodes_to_check;
+  Set<const fn::FieldNode *> checked_nodes;
+  nodes_to_check.push(&field.node());
+  while (!nodes_to_check.is_empty()) {
+    const fn::FieldNode *field_node = nodes_to_check.pop();
+    if (!checked_nodes.add(field_node) || !field_node->is_operation()) {
+      continue;
+    }
+    const fn::FieldOperation &operation = *static_cast<const fn::FieldOperation *>(field_node);
+    if (mf_by_node.is_scope_function(operation.multi_function())) {
+      return false;
+    }
+    for (const GField &input : operation.inputs()) {
+      nodes_to_check.push(&input.node());
+    }
+  }
+  return true;
+}
+
+static bool value_can_be_cached(const GPointer value, const nodes::NodeMultiFunctions &mf_by_node)
+{
+  const CPPType &type = *value.type();
+  if (type == CPPType::get<GeometrySet>()) {
+    /* Geometry that is not owned (e.g. the original mesh of the object) may change without the
+     * pointer changing. */
+    return value.get<GeometrySet>()->owns_direct_data();
+  }
+  if (const FieldCPPType *field_cpp_type = dynamic_cast<const FieldCPPType *>(&type)) {
+    return field_can_be_cached(field_cpp_type->get_gfield(value.get()), mf_by_node);
+  }
+  return type.is_copy_constructible();
+}
+
+static bool cached_fields_equal(const GFieldRef a, const GFieldRef b)
+{
+  if (a.node_output_index() != b.node_output_index()) {
+    return false;
+  }
+  const fn::FieldNode &node_a = a.node();
+  const fn::FieldNode &node_b = b.node();
+  if (node_a == node_b) {
+    return true;
+  }
+  if (!node_a.is_operation() || !node_b.is_operation()) {
+    return false;
+  }
+  /* Operations are created again in every evaluation, so compare them structurally. */
+  const fn::FieldOperation &operation_a = static_cast<const fn::FieldOperation &>(node_a);
+  const fn::FieldOperation &operation_b = static_cast<const fn::FieldOperation &>(node_b);
+  const MultiFunction &fn_a = operation_a.multi_function();
+  const MultiFunction &fn_b = operation_b.multi_function();
+  if (&fn_a != &fn_b && !fn_a.equals(fn_b)) {
+    return false;
+  }
+  const Span<GField> inputs_a = operation_a.inputs();
+  const Span<GField> inputs_b = operation_b.inputs();
+  if (inputs_a.size() != inputs_b.size()) {
+    return false;
+  }
+  for (const int i : inputs_a.index_range()) {
+    if (!cached_fields_equal(inputs_a[i], inputs_b[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool cached_values_equal(const GPointer a, const GPointer b)
+{
+  const CPPType &type = *a.type();
+  if (type != *b.type()) {
+    return false;
+  }
+  if (type == CPPType::get<GeometrySet>()) {
+    /* Components are shared between geometries and are copied before they are modified, so
+     * geometries that share all components are equal. */
+    const GeometrySet &geometry_a = *a.get<GeometrySet>();
+    const GeometrySet &geometry_b = *b.get<GeometrySet>();
+    const Vector<const GeometryComponent *> components = geometry_a.get_components_for_read();
+    if (components.size() != geometry_b.get_components_for_read().size()) {
+      return false;
+    }
+    for (const GeometryComponent *component : components) {
+      if (geometry_b.get_component_for_read(component->type()) != component) {
+        return false;
+      }
+    }
+    return true;
+  }
+  if (const FieldCPPType *field_cpp_type = dynamic_cast<const FieldCPPType *>(&type)) {
+    return cached_fields_equal(field_cpp_type->get_gfield(a.get()),
+                               field_cpp_type->get_gfield(b.get()));
+  }
+  return type.is_equal_or_false(a.get(), b.get());
+}
+
+static Span<char> node_storage_bytes(const bNode &bnode)
+{
+  if (bnode.storage == nullptr) {
+    return {};
+  }
+  return {static_cast<const char *>(bnode.storage), int64_t(MEM_allocN_len(bnode.storage))};
+}
+
+/**
+ * Get the values of a multi-input socket in link order. The same origin can occur multiple
+ * times, in which case all its values are equal.
+ */
+static Vector<const void *> get_multi_input_values(const DInputSocket socket,
+                                                   const MultiInputValue &multi_value)
+{
+  Vector<const void *> values;
+  socket.foreach_origin_socket([&](DSocket origin) {
+    for (const MultiInputValueItem &item : multi_value.items) {
+      if (item.origin == origin) {
+        values.append(item.value);
+        return;
+      }
+    }
+  });
+  if (values.is_empty() && multi_value.items.size() == 1) {
+    /* The socket is not linked and provides its own value. */
+    values.append(multi_value.items[0].value);
+  }
+  return values;
+}
+
 /** Implements the callbacks that might be called when a node is executed. */
 class NodeParamsProvider : public nodes::GeoNodeExecParamsProvider {
  private:
@@ -376,6 +609,9 @@ class NodeParamsProvider : public nodes::GeoNodeExecParamsProvider {
 
   bool lazy_require_input(StringRef identifier) override;
   bool lazy_output_is_required(StringRef identifier) const override;
+
+  /** When not null, all outputs are copied into this entry before they are forwarded. */
+  NodeResultsCacheEntry *results_cache_entry = nullptr;
 };
 
 class GeometryNodesEvaluator {
@@ -409,6 +645,9 @@ class GeometryNodesEvaluator {
   GeometryNodesEvaluationParams &params_;
   const blender::nodes::DataTypeConversions &conversions_;
 
+  /** Identifies this evaluation in #GeometryNodesEvaluationParams.results_cache. */
+  uint64_t results_cache_evaluation_ = 0;
+
   friend NodeParamsProvider;
 
  public:
@@ -423,6 +662,10 @@ class GeometryNodesEvaluator {
   {
     task_pool_ = BLI_task_pool_create(this, TASK_PRIORITY_HIGH);
 
+    if (params_.results_cache != nullptr) {
+      results_cache_evaluation_ = params_.results_cache->begin_evaluation();
+    }
+
     this->create_states_for_reachable_nodes();
     this->forward_group_inputs();
     this->schedule_initial_nodes();
@@ -433,6 +676,10 @@ class GeometryNodesEvaluator {
 
     this->extract_group_outputs();
     this->destruct_node_states();
+
+    if (params_.results_cache != nullptr) {
+      params_.results_cache->end_evaluation(results_cache_evaluation_);
+    }
   }
 
   void create_states_for_reachable_nodes()
@@ -686,7 +933,15 @@ class GeometryNodesEvaluator {
     /* Only execute the node if all prerequisites are met. There has to be an output that is
      * required and all required inputs have to be provided already. */
     if (do_execute_node) {
-      this->execute_node(node, node_state);
+      if (params_.geo_logger != nullptr) {
+        const geo_log::TimePoint start = std::chrono::steady_clock::now();
+        this->execute_node(node, node_state);
+        const geo_log::TimePoint end = std::chrono::steady_clock::now();
+        params_.geo_logger->local().log_execution_time(node, start, end);
+      }
+      else {
+        this->execute_node(node, node_state);
+      }
     }
 
     this->node_task_postprocessing(node, node_state);
@@ -885,7 +1140,181 @@ class GeometryNodesEvaluator {
       params.error_message_add(geo_log::NodeWarningType::Legacy,
                                TIP_("Legacy node will be removed before Blender 4.0"));
     }
+    if (params_.results_cache != nullptr && node_results_can_be_cached(node)) {
+      this->execute_geometry_node_with_cache(node, node_state, params_provider, params);
+      return;
+    }
+    bnode.typeinfo->geometry_node_execute(params);
+  }
+
+  void execute_geometry_node_with_cache(const DNode node,
+                                        NodeState &node_state,
+                                        NodeParamsProvider &params_provider,
+                                        GeoNodeExecParams &params)
+  {
+    const bNode &bnode = *node->bnode();
+    NodeResultsCache &results_cache = *params_.results_cache;
+    std::string key = node_results_cache_key(node);
+
+    std::unique_ptr<NodeResultsCacheEntry> entry = results_cache.pop(key);
+    if (entry && this->cache_entry_matches_node(*entry, node, node_state)) {
+      if (params_.geo_logger != nullptr) {
+        for (const geo_log::NodeWarning &warning : entry->warnings) {
+          params_.geo_logger->local().log_node_warning(node, warning.type, warning.message);
+        }
+      }
+      this->forward_cached_outputs(*entry, node, node_state);
+      results_cache.add(std::move(key), std::move(entry), results_cache_evaluation_);
+      return;
+    }
+
+    /* The inputs have to be copied before the node is executed, because it may consume them. */
+    entry = this->create_cache_entry(node, node_state);
+    params_provider.results_cache_entry = entry.get();
+    params_provider.warnings = entry ? &entry->warnings : nullptr;
     bnode.typeinfo->geometry_node_execute(params);
+    params_provider.results_cache_entry = nullptr;
+    params_provider.warnings = nullptr;
+
+    if (entry && entry->is_cacheable) {
+      results_cache.add(std::move(key), std::move(entry), results_cache_evaluation_);
+    }
+  }
+
+  /**
+   * Copy the current inputs and settings of the node into a new cache entry. Returns null when
+   * some input can't be kept beyond the evaluation.
+   */
+  std::unique_ptr<NodeResultsCacheEntry> create_cache_entry(const DNode node,
+                                                            NodeState &node_state)
+  {
+    const bNode &bnode = *node->bnode();
+    std::unique_ptr<NodeResultsCacheEntry> entry = std::make_unique<NodeResultsCacheEntry>();
+    entry->typeinfo = bnode.typeinfo;
+    entry->custom1 = bnode.custom1;
+    entry->custom2 = bnode.custom2;
+    entry->custom3 = bnode.custom3;
+    entry->custom4 = bnode.custom4;
+    entry->storage.extend(node_storage_bytes(bnode));
+    entry->inputs.resize(node->inputs().size());
+    entry->outputs.resize(node->outputs().size());
+
+    for (const int i : node->inputs().index_range()) {
+      const InputState &input_state = node_state.inputs[i];
+      if (input_state.type == nullptr) {
+        continue;
+      }
+      for (const void *value : this->get_input_values(node.input(i), input_state)) {
+        const GPointer value_pointer{input_state.type, value};
+        if (!value_can_be_cached(value_pointer, *params_.mf_by_node)) {
+          return {};
+        }
+        entry->inputs[i].append(entry->copy_value(value_pointer));
+      }
+    }
+    return entry;
+  }
+
+  bool cache_entry_matches_node(const NodeResultsCacheEntry &entry,
+                                const DNode node,
+                                const NodeState &node_state)
+  {
+    const bNode &bnode = *node->bnode();
+    if (entry.typeinfo != bnode.typeinfo || entry.custom1 != bnode.custom1 ||
+        entry.custom2 != bnode.custom2 || entry.custom3 != bnode.custom3 ||
+        entry.custom4 != bnode.custom4) {
+      return false;
+    }
+    const Span<char> storage = node_storage_bytes(bnode);
+    if (entry.storage.size() != storage.size() ||
+        !std::equal(storage.begin(), storage.end(), entry.storage.begin())) {
+      return false;
+    }
+    if (entry.inputs.size() != node->inputs().size() ||
+        entry.outputs.size() != node->outputs().size()) {
+      return false;
+    }
+
+    for (const int i : node->inputs().index_range()) {
+      const InputState &input_state = node_state.inputs[i];
+      if (input_state.type == nullptr) {
+        if (!entry.inputs[i].is_empty()) {
+          return false;
+        }
+        continue;
+      }
+      const Vector<const void *> values = this->get_input_values(node.input(i), input_state);
+      if (values.size() != entry.inputs[i].size()) {
+        return false;
+      }
+      for (const int value_index : values.index_range()) {
+        if (!cached_values_equal(entry.inputs[i][value_index],
+                                 {input_state.type, values[value_index]})) {
+          return false;
+        }
+      }
+    }
+
+    /* All outputs that are used have to be available in the cache. */
+    for (const int i : node->outputs().index_range()) {
+      const OutputState &output_state = node_state.outputs[i];
+      if (output_state.has_been_computed ||
+          output_state.output_usage_for_execution == ValueUsage::Unused) {
+        continue;
+      }
+      if (!node->output(i).is_available() || get_socket_cpp_type(node->output(i)) == nullptr) {
+        continue;
+      }
+      if (entry.outputs[i].get() == nullptr) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void forward_cached_outputs(const NodeResultsCacheEntry &entry,
+                              const DNode node,
+                              NodeState &node_state)
+  {
+    LinearAllocator<> &allocator = local_allocators_.local();
+    for (const int i : node->outputs().index_range()) {
+      OutputState &output_state = node_state.outputs[i];
+      const GMutablePointer cached_value = entry.outputs[i];
+      if (output_state.has_been_computed || cached_value.get() == nullptr ||
+          output_state.output_usage_for_execution == ValueUsage::Unused) {
+        continue;
+      }
+      const CPPType &type = *cached_value.type();
+      void *buffer = allocator.allocate(type.size(), type.alignment());
+      type.copy_construct(cached_value.get(), buffer);
+      this->forward_output(node.output(i), {type, buffer});
+      output_state.has_been_computed = true;
+    }
+  }
+
+  /** Get all values of an input that is ready for execution, without consuming them. */
+  Vector<const void *> get_input_values(const DInputSocket socket, const InputState &input_state)
+  {
+    if (socket->is_multi_input_socket()) {
+      return get_multi_input_values(socket, *input_state.value.multi);
+    }
+    return {input_state.value.single->value};
+  }
+
+  void add_output_to_cache_entry(NodeResultsCacheEntry &entry,
+                                 const DOutputSocket socket,
+                                 const GPointer value)
+  {
+    if (!entry.is_cacheable) {
+      return;
+    }
+    if (!value_can_be_cached(value, *params_.mf_by_node)) {
+      entry.is_cacheable = false;
+      return;
+    }
+    GMutablePointer &cached_value = entry.outputs[socket->index()];
+    BLI_assert(cached_value.get() == nullptr);
+    cached_value = entry.copy_value(value);
   }
 
   void execute_multi_function_node(const DNode node,
@@ -1625,6 +2054,9 @@ void NodeParamsProvider::set_output(StringRef identifier, GMutablePointer value)
 
   OutputState &output_state = node_state_.outputs[socket->index()];
   BLI_assert(!output_state.has_been_computed);
+  if (results_cache_entry != nullptr) {
+    evaluator_.add_output_to_cache_entry(*results_cache_entry, socket, value);
+  }
   evaluator_.forward_output(socket, value);
   output_state.has_been_computed = true;
 }
@@ -1680,6 +2112,42 @@ bool NodeParamsProvider::lazy_output_is_required(StringRef identifier) const
   return output_state.output_usage_for_execution == ValueUsage::Required;
 }
 
+NodeResultsCache::NodeResultsCache() = default;
+NodeResultsCache::~NodeResultsCache() = default;
+
+uint64_t NodeResultsCache::begin_evaluation()
+{
+  std::lock_guard lock{mutex_};
+  return ++evaluation_counter_;
+}
+
+void NodeResultsCache::end_evaluation(const uint64_t evaluation)
+{
+  std::lock_guard lock{mutex_};
+  /* Entries that are used by concurrent later evaluations are kept. */
+  for (auto it = entries_.values().begin(); it != entries_.values().end(); ++it) {
+    const std::unique_ptr<NodeResultsCacheEntry> &entry = *it;
+    if (entry->last_used_evaluation < evaluation) {
+      entries_.remove(it);
+    }
+  }
+}
+
+std::unique_ptr<NodeResultsCacheEntry> NodeResultsCache::pop(StringRef key)
+{
+  std::lock_guard lock{mutex_};
+  return entries_.pop_default_as(key, nullptr);
+}
+
+void NodeResultsCache::add(std::string key,
+                           std::unique_ptr<NodeResultsCacheEntry> entry,
+                           const uint64_t evaluation)
+{
+  entry->last_used_evaluation = evaluation;
+  std::lock_guard lock{mutex_};
+  entries_.add_overwrite(std::move(key), std::move(entry));
+}
+
 void evaluate_geometry_nodes(GeometryNodesEvaluationParams &params)
 {
   GeometryNodesEvaluator evaluator{params};
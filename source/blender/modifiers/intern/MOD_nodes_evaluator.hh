@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <mutex>
+
 #include "BLI_map.hh"
 
 #include "NOD_derived_node_tree.hh"
@@ -36,6 +38,39 @@ using namespace nodes::derived_node_tree_types;
 using fn::GMutablePointer;
 using fn::GPointer;
 
+struct NodeResultsCacheEntry;
+
+/**
+ * Keeps the outputs of nodes from previous evaluations together with the inputs and settings they
+ * were computed with. When a node is executed again with the same inputs, the cached outputs are
+ * forwarded instead. This allows reevaluating only the part of the node tree that changed.
+ *
+ * The cache is stored on the original modifier and may be used by multiple evaluations at the
+ * same time (e.g. viewport and render), therefore all access is protected by a mutex.
+ */
+class NodeResultsCache : NonCopyable, NonMovable {
+ private:
+  std::mutex mutex_;
+  Map<std::string, std::unique_ptr<NodeResultsCacheEntry>> entries_;
+  uint64_t evaluation_counter_ = 0;
+
+ public:
+  NodeResultsCache();
+  ~NodeResultsCache();
+
+  /** Returns an identifier that is passed to the methods below. */
+  uint64_t begin_evaluation();
+  /** Remove all entries that have not been used by the given evaluation or a later one. */
+  void end_evaluation(uint64_t evaluation);
+
+  /**
+   * Remove the entry from the cache so that it can be used without holding a lock. It should be
+   * added back with #add when it is still useful.
+   */
+  std::unique_ptr<NodeResultsCacheEntry> pop(StringRef key);
+  void add(std::string key, std::unique_ptr<NodeResultsCacheEntry> entry, uint64_t evaluation);
+};
+
 struct GeometryNodesEvaluationParams {
   blender::LinearAllocator<> allocator;
 
@@ -52,6 +87,8 @@ struct GeometryNodesEvaluationParams {
   Depsgraph *depsgraph;
   Object *self_object;
   geo_log::GeoLogger *geo_logger;
+  /* Optional, when not null, node results are reused from and stored in this cache. */
+  NodeResultsCache *results_cache = nullptr;
 
   Vector<GMutablePointer> r_output_values;
 };
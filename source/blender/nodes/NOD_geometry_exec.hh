@@ -77,6 +77,11 @@ class GeoNodeExecParamsProvider {
   const ModifierData *modifier = nullptr;
   Depsgraph *depsgraph = nullptr;
   geometry_nodes_eval_log::GeoLogger *logger = nullptr;
+  /**
+   * When not null, warnings of the node are added to it as well, so that they can be logged again
+   * when the results of the node are reused by a later evaluation.
+   */
+  Vector<geometry_nodes_eval_log::NodeWarning> *warnings = nullptr;
 
   /**
    * Returns true when the node is allowed to get/extract the input value. The identifier is
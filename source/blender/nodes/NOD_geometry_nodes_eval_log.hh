@@ -30,6 +30,9 @@
  * necessary information.
  */
 
+#include <atomic>
+#include <chrono>
+
 #include "BLI_enumerable_thread_specific.hh"
 #include "BLI_function_ref.hh"
 #include "BLI_linear_allocator.hh"
@@ -144,6 +147,14 @@ struct NodeWithWarning {
   NodeWarning warning;
 };
 
+using TimePoint = std::chrono::steady_clock::time_point;
+
+struct NodeWithExecutionTime {
+  DNode node;
+  TimePoint start;
+  TimePoint end;
+};
+
 /** The same value can be referenced by multiple sockets when they are linked. */
 struct ValueOfSockets {
   Span<DSocket> sockets;
@@ -164,11 +175,15 @@ class LocalGeoLogger {
   std::unique_ptr<LinearAllocator<>> allocator_;
   Vector<ValueOfSockets> values_;
   Vector<NodeWithWarning> node_warnings_;
+  Vector<NodeWithExecutionTime> node_execution_times_;
+  /* Identifies the thread this logger belongs to in the execution trace. */
+  int thread_index_;
 
   friend ModifierLog;
 
  public:
-  LocalGeoLogger(GeoLogger &main_logger) : main_logger_(&main_logger)
+  LocalGeoLogger(GeoLogger &main_logger, const int thread_index)
+      : main_logger_(&main_logger), thread_index_(thread_index)
   {
     this->allocator_ = std::make_unique<LinearAllocator<>>();
   }
@@ -176,6 +191,7 @@ class LocalGeoLogger {
   void log_value_for_sockets(Span<DSocket> sockets, GPointer value);
   void log_multi_value_socket(DSocket socket, Span<GPointer> values);
   void log_node_warning(DNode node, NodeWarningType type, std::string message);
+  void log_execution_time(DNode node, TimePoint start, TimePoint end);
 };
 
 /** The root logger class. */
@@ -186,13 +202,18 @@ class GeoLogger {
    * way too much memory. */
   Set<DSocket> log_full_geometry_sockets_;
   threading::EnumerableThreadSpecific<LocalGeoLogger> threadlocals_;
+  std::atomic<int> thread_counter_ = 0;
+  /* Execution times in the trace are relative to this. */
+  TimePoint start_time_;
 
   friend LocalGeoLogger;
+  friend ModifierLog;
 
  public:
   GeoLogger(Set<DSocket> log_full_geometry_sockets)
       : log_full_geometry_sockets_(std::move(log_full_geometry_sockets)),
-        threadlocals_([this]() { return LocalGeoLogger(*this); })
+        threadlocals_([this]() { return LocalGeoLogger(*this, thread_counter_++); }),
+        start_time_(std::chrono::steady_clock::now())
   {
   }
 
@@ -232,6 +253,8 @@ class NodeLog {
   Vector<SocketLog> input_logs_;
   Vector<SocketLog> output_logs_;
   Vector<NodeWarning, 0> warnings_;
+  /* Accumulated time of all executions of the node. */
+  std::chrono::nanoseconds execution_time_{0};
 
   friend ModifierLog;
 
@@ -254,6 +277,11 @@ class NodeLog {
     return warnings_;
   }
 
+  std::chrono::nanoseconds execution_time() const
+  {
+    return execution_time_;
+  }
+
   Vector<const GeometryAttributeInfo *> lookup_available_attributes() const;
 };
 
@@ -270,6 +298,21 @@ class TreeLog {
   const NodeLog *lookup_node_log(const bNode &node) const;
   const TreeLog *lookup_child_log(StringRef node_name) const;
   void foreach_node_log(FunctionRef<void(const NodeLog &)> fn) const;
+
+  /** Time spent in all nodes of this tree, including nested groups. */
+  std::chrono::nanoseconds execution_time() const;
+};
+
+/** A single execution of a node, used to create an execution trace. */
+struct NodeExecutionEvent {
+  /* Names of the parent group nodes and the node itself, separated by slashes. */
+  std::string node_path;
+  std::string node_idname;
+  const NodeLog *node_log;
+  int thread_index;
+  /* Relative to the start of the evaluation. */
+  std::chrono::nanoseconds start;
+  std::chrono::nanoseconds duration;
 };
 
 /** Contains information about an entire geometry nodes evaluation. */
@@ -280,6 +323,7 @@ class ModifierLog {
   Vector<std::unique_ptr<LinearAllocator<>>> logger_allocators_;
   destruct_ptr<TreeLog> root_tree_logs_;
   Vector<destruct_ptr<ValueLog>> logged_values_;
+  Vector<NodeExecutionEvent> execution_events_;
 
  public:
   ModifierLog(GeoLogger &logger);
@@ -289,6 +333,18 @@ class ModifierLog {
     return *root_tree_logs_;
   }
 
+  Span<NodeExecutionEvent> execution_events() const
+  {
+    return execution_events_;
+  }
+
+  /**
+   * Write all node executions in the Chrome trace event format, which can be opened in
+   * `chrome://tracing` or https://ui.perfetto.dev. Every thread of the evaluation gets its own
+   * track.
+   */
+  void write_chrome_trace(std::ostream &stream) const;
+
   /* Utilities to find logged information for a specific context. */
   static const ModifierLog *find_root_by_node_editor_context(const SpaceNode &snode);
   static const TreeLog *find_tree_by_node_editor_context(const SpaceNode &snode);
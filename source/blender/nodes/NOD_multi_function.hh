@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include "BLI_set.hh"
+
 #include "FN_multi_function.hh"
 
 #include "DNA_node_types.h"
@@ -37,6 +39,7 @@ class NodeMultiFunctionBuilder : NonCopyable, NonMovable {
   bNode &node_;
   bNodeTree &tree_;
   const MultiFunction *built_fn_ = nullptr;
+  bool built_fn_is_owned_ = false;
 
   friend NodeMultiFunctions;
 
@@ -68,11 +71,19 @@ class NodeMultiFunctionBuilder : NonCopyable, NonMovable {
 class NodeMultiFunctions {
  private:
   Map<const bNode *, const MultiFunction *> map_;
+  /** Functions that are owned by the resource scope and don't have a static lifetime. */
+  Set<const MultiFunction *> scope_functions_;
 
  public:
   NodeMultiFunctions(const DerivedNodeTree &tree, ResourceScope &resource_scope);
 
   const MultiFunction *try_get(const DNode &node) const;
+
+  /**
+   * True when the function is freed together with the resource scope that was passed to the
+   * constructor. Such functions must not be referenced after the evaluation.
+   */
+  bool is_scope_function(const MultiFunction &fn) const;
 };
 
 /* -------------------------------------------------------------------- */
@@ -104,6 +115,7 @@ inline ResourceScope &NodeMultiFunctionBuilder::resource_scope()
 inline void NodeMultiFunctionBuilder::set_matching_fn(const MultiFunction *fn)
 {
   built_fn_ = fn;
+  built_fn_is_owned_ = false;
 }
 
 inline void NodeMultiFunctionBuilder::set_matching_fn(const MultiFunction &fn)
@@ -116,6 +128,7 @@ inline void NodeMultiFunctionBuilder::construct_and_set_matching_fn(Args &&...ar
 {
   const T &fn = resource_scope_.construct<T>(std::forward<Args>(args)...);
   this->set_matching_fn(&fn);
+  built_fn_is_owned_ = true;
 }
 
 /** \} */
@@ -129,6 +142,11 @@ inline const MultiFunction *NodeMultiFunctions::try_get(const DNode &node) const
   return map_.lookup_default(node->bnode(), nullptr);
 }
 
+inline bool NodeMultiFunctions::is_scope_function(const MultiFunction &fn) const
+{
+  return scope_functions_.contains(&fn);
+}
+
 /** \} */
 
 }  // namespace blender::nodes
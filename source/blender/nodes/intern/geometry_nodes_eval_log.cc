@@ -14,6 +14,10 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+
 #include "NOD_geometry_nodes_eval_log.hh"
 
 #include "BKE_geometry_set_instances.hh"
@@ -25,6 +29,16 @@ namespace blender::nodes::geometry_nodes_eval_log {
 
 using fn::CPPType;
 
+static std::string get_node_path(const DNode node)
+{
+  std::string path = node->name();
+  for (const DTreeContext *context = node.context(); context->parent_node() != nullptr;
+       context = context->parent_context()) {
+    path = std::string(context->parent_node()->name()) + "/" + path;
+  }
+  return path;
+}
+
 ModifierLog::ModifierLog(GeoLogger &logger)
 {
   root_tree_logs_ = allocator_.construct<TreeLog>();
@@ -54,7 +68,102 @@ ModifierLog::ModifierLog(GeoLogger &logger)
                                                        node_with_warning.node);
       node_log.warnings_.append(node_with_warning.warning);
     }
+
+    for (const NodeWithExecutionTime &execution : local_logger.node_execution_times_) {
+      NodeLog &node_log = this->lookup_or_add_node_log(log_by_tree_context, execution.node);
+      const std::chrono::nanoseconds duration = execution.end - execution.start;
+      node_log.execution_time_ += duration;
+      execution_events_.append({get_node_path(execution.node),
+                                execution.node->idname(),
+                                &node_log,
+                                local_logger.thread_index_,
+                                execution.start - logger.start_time_,
+                                duration});
+    }
+  }
+
+  std::sort(execution_events_.begin(),
+            execution_events_.end(),
+            [](const NodeExecutionEvent &a, const NodeExecutionEvent &b) {
+              return a.start < b.start;
+            });
+}
+
+static void write_json_string(std::ostream &stream, StringRef str)
+{
+  stream << '"';
+  for (const char c : str) {
+    switch (c) {
+      case '"':
+        stream << "\\\"";
+        break;
+      case '\\':
+        stream << "\\\\";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          stream << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c)
+                 << std::setfill(' ') << std::dec;
+        }
+        else {
+          stream << c;
+        }
+        break;
+    }
   }
+  stream << '"';
+}
+
+/** Write the amount of elements of the geometries computed by the node. */
+static void write_json_element_counts(std::ostream &stream, const NodeLog &node_log)
+{
+  int64_t verts = 0, faces = 0, points = 0, splines = 0, instances = 0;
+  for (const SocketLog &socket_log : node_log.output_logs()) {
+    const GeometryValueLog *geo_value_log = dynamic_cast<const GeometryValueLog *>(
+        socket_log.value());
+    if (geo_value_log == nullptr) {
+      continue;
+    }
+    if (geo_value_log->mesh_info) {
+      verts += geo_value_log->mesh_info->tot_verts;
+      faces += geo_value_log->mesh_info->tot_faces;
+    }
+    if (geo_value_log->pointcloud_info) {
+      points += geo_value_log->pointcloud_info->tot_points;
+    }
+    if (geo_value_log->curve_info) {
+      splines += geo_value_log->curve_info->tot_splines;
+    }
+    if (geo_value_log->instances_info) {
+      instances += geo_value_log->instances_info->tot_instances;
+    }
+  }
+  stream << ",\"vertices\":" << verts << ",\"faces\":" << faces << ",\"points\":" << points
+         << ",\"splines\":" << splines << ",\"instances\":" << instances;
+}
+
+void ModifierLog::write_chrome_trace(std::ostream &stream) const
+{
+  using Microseconds = std::chrono::duration<double, std::micro>;
+
+  stream << "{\"traceEvents\":[";
+  for (const int i : execution_events_.index_range()) {
+    const NodeExecutionEvent &event = execution_events_[i];
+    if (i > 0) {
+      stream << ",";
+    }
+    stream << "\n{\"name\":";
+    write_json_string(stream, event.node_path);
+    stream << ",\"cat\":";
+    write_json_string(stream, event.node_idname);
+    stream << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.thread_index
+           << ",\"ts\":" << Microseconds(event.start).count()
+           << ",\"dur\":" << Microseconds(event.duration).count() << ",\"args\":{\"node\":";
+    write_json_string(stream, event.node_path);
+    write_json_element_counts(stream, *event.node_log);
+    stream << "}}";
+  }
+  stream << "\n]}\n";
 }
 
 TreeLog &ModifierLog::lookup_or_add_tree_log(LogByTreeContext &log_by_tree_context,
@@ -129,6 +238,14 @@ const TreeLog *TreeLog::lookup_child_log(StringRef node_name) const
   return tree_log->get();
 }
 
+std::chrono::nanoseconds TreeLog::execution_time() const
+{
+  std::chrono::nanoseconds execution_time{0};
+  this->foreach_node_log(
+      [&](const NodeLog &node_log) { execution_time += node_log.execution_time(); });
+  return execution_time;
+}
+
 void TreeLog::foreach_node_log(FunctionRef<void(const NodeLog &)> fn) const
 {
   for (auto node_log : node_logs_.items()) {
@@ -385,4 +502,9 @@ void LocalGeoLogger::log_node_warning(DNode node, NodeWarningType type, std::str
   node_warnings_.append({node, {type, std::move(message)}});
 }
 
+void LocalGeoLogger::log_execution_time(DNode node, TimePoint start, TimePoint end)
+{
+  node_execution_times_.append({node, start, end});
+}
+
 }  // namespace blender::nodes::geometry_nodes_eval_log
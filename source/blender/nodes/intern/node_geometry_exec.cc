@@ -29,6 +29,9 @@ namespace blender::nodes {
 
 void GeoNodeExecParams::error_message_add(const NodeWarningType type, std::string message) const
 {
+  if (provider_->warnings != nullptr) {
+    provider_->warnings->append({type, message});
+  }
   if (provider_->logger == nullptr) {
     return;
   }
@@ -32,6 +32,9 @@ NodeMultiFunctions::NodeMultiFunctions(const DerivedNodeTree &tree, ResourceScop
       const MultiFunction *fn = builder.built_fn_;
       if (fn != nullptr) {
         map_.add_new(bnode, fn);
+        if (builder.built_fn_is_owned_) {
+          scope_functions_.add(fn);
+        }
       }
     }
   }
@@ -60,6 +60,18 @@ void SEQ_relations_check_uuids_unique_and_report(const struct Scene *scene);
 void SEQ_relations_session_uuid_generate(struct Sequence *sequence);
 
 void SEQ_cache_cleanup(struct Scene *scene);
+
+typedef struct SeqCacheStripStats {
+  int entries_num;
+  size_t memory_size;
+  /* Sum of render cost of cached images, in frame durations. */
+  float cost_total;
+} SeqCacheStripStats;
+
+/* Statistics of images of a strip, that are stored in RAM cache. */
+void SEQ_cache_strip_stats_get(struct Scene *scene,
+                               struct Sequence *seq,
+                               SeqCacheStripStats *r_stats);
 void SEQ_cache_iterate(
     struct Scene *scene,
     void *userdata,
@@ -34,11 +34,18 @@ struct Main;
 struct Scene;
 struct Sequence;
 
+/* Maximum number of prefetch workers, each of them renders with its own task ID. */
+#define SEQ_PREFETCH_WORKERS_MAX 8
+
 typedef enum eSeqTaskId {
   SEQ_TASK_MAIN_RENDER,
+  /* First prefetch worker, other workers use consecutive IDs. */
   SEQ_TASK_PREFETCH_RENDER,
+  SEQ_TASK_PREFETCH_RENDER_LAST = SEQ_TASK_PREFETCH_RENDER + SEQ_PREFETCH_WORKERS_MAX - 1,
 } eSeqTaskId;
 
+#define SEQ_TASK_NUM (SEQ_TASK_PREFETCH_RENDER_LAST + 1)
+
 typedef struct SeqRenderData {
   struct Main *bmain;
   struct Depsgraph *depsgraph;
@@ -56,6 +63,9 @@ typedef struct SeqRenderData {
   int view_id;
   /* ID of task for assigning temp cache entries to particular task(thread, etc.) */
   eSeqTaskId task_id;
+  /* Time when rendering of the current image started, used as render cost of cache entries.
+   * Zero when not rendering. */
+  double render_start_time;
 
   /* special case for OpenGL render */
   struct GPUOffScreen *gpu_offscreen;
@@ -25,6 +25,8 @@
 #include <stddef.h>
 #include <time.h>
 
+#include <zstd.h>
+
 #include "MEM_guardedalloc.h"
 
 #include "DNA_scene_types.h"
@@ -43,7 +45,9 @@
 #include "BLI_ghash.h"
 #include "BLI_listbase.h"
 #include "BLI_mempool.h"
+#include "BLI_mmap.h"
 #include "BLI_path_util.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 
 #include "BKE_main.h"
@@ -67,7 +71,10 @@
  * For each cached non-temp image, image data and supplementary info are written to HDD.
  * Multiple(DCACHE_IMAGES_PER_FILE) images share the same file.
  * Each of these files contains header DiskCacheHeader followed by image data.
- * Zlib compression with user definable level can be used to compress image data(per image)
+ * Zstd compression with user definable level can be used to compress image data(per image).
+ * Compressed image is split into slices of DCACHE_COMPRESSION_SLICE_SIZE bytes, each of them
+ * stored as an individual Zstd frame, so images can be compressed and decompressed in parallel.
+ * Uncompressed images are read through memory mapping.
  * Images are written in order in which they are rendered.
  * Overwriting of individual entry is not possible.
  * Stored images are deleted by invalidation, or when size of all files exceeds maximum
@@ -80,7 +87,8 @@
  * `<cache type>-<resolution X>x<resolution Y>-<rendersize>%(<view_id>)-<frame no>.dcf`. */
 #define DCACHE_FNAME_FORMAT "%d-%dx%d-%d%%(%d)-%d.dcf"
 #define DCACHE_IMAGES_PER_FILE 100
-#define DCACHE_CURRENT_VERSION 2
+#define DCACHE_CURRENT_VERSION 3
+#define DCACHE_COMPRESSION_SLICE_SIZE (2 * 1024 * 1024)
 #define COLORSPACE_NAME_MAX 64 /* XXX: defined in IMB intern. */
 
 typedef struct DiskCacheHeaderEntry {
@@ -130,6 +138,9 @@ static int seq_disk_cache_compression_level(void)
   switch (U.sequencer_disk_cache_compression) {
     case USER_SEQ_DISK_CACHE_COMPRESSION_NONE:
       return 0;
+    case USER_SEQ_DISK_CACHE_COMPRESSION_FAST:
+      /* Negative levels trade compression ratio for speed. */
+      return -5;
     case USER_SEQ_DISK_CACHE_COMPRESSION_LOW:
       return 1;
     case USER_SEQ_DISK_CACHE_COMPRESSION_HIGH:
@@ -434,39 +445,207 @@ void seq_disk_cache_invalidate(SeqDiskCache *disk_cache,
   BLI_mutex_unlock(&disk_cache->read_write_mutex);
 }
 
-static size_t deflate_imbuf_to_file(ImBuf *ibuf,
-                                    FILE *file,
-                                    int level,
-                                    DiskCacheHeaderEntry *header_entry)
+static void *seq_disk_cache_imbuf_data(ImBuf *ibuf)
 {
-  void *data = (ibuf->rect != NULL) ? (void *)ibuf->rect : (void *)ibuf->rect_float;
+  return (ibuf->rect != NULL) ? (void *)ibuf->rect : (void *)ibuf->rect_float;
+}
 
-  /* Apply compression if wanted, otherwise just write directly to the file. */
-  if (level > 0) {
-    return BLI_file_zstd_from_mem_at_pos(
-        data, header_entry->size_raw, file, header_entry->offset, level);
+static size_t seq_disk_cache_imbuf_data_size(ImBuf *ibuf)
+{
+  if (ibuf->rect) {
+    return (size_t)ibuf->x * ibuf->y * ibuf->channels;
   }
+  return (size_t)ibuf->x * ibuf->y * ibuf->channels * 4;
+}
 
-  fseek(file, header_entry->offset, SEEK_SET);
-  return fwrite(data, 1, header_entry->size_raw, file);
+typedef struct DiskCacheCompressData {
+  const char *data;
+  size_t data_size;
+  int level;
+  /* Slice `i` is compressed to `buffer + i * slice_bound`. */
+  char *buffer;
+  size_t slice_bound;
+  size_t *slice_sizes;
+} DiskCacheCompressData;
+
+static void seq_disk_cache_compress_slice_fn(void *__restrict userdata,
+                                             const int slice,
+                                             const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  DiskCacheCompressData *data = userdata;
+  const size_t offset = (size_t)slice * DCACHE_COMPRESSION_SLICE_SIZE;
+  const size_t size = MIN2(DCACHE_COMPRESSION_SLICE_SIZE, data->data_size - offset);
+
+  const size_t compressed_size = ZSTD_compress(data->buffer + slice * data->slice_bound,
+                                               data->slice_bound,
+                                               data->data + offset,
+                                               size,
+                                               data->level);
+  data->slice_sizes[slice] = ZSTD_isError(compressed_size) ? 0 : compressed_size;
 }
 
-static size_t inflate_file_to_imbuf(ImBuf *ibuf, FILE *file, DiskCacheHeaderEntry *header_entry)
+/* Compress image data as sequence of Zstd frames. Slices are compressed in parallel.
+ * Returns NULL on failure. */
+static void *seq_disk_cache_compress(const void *data,
+                                     size_t data_size,
+                                     int level,
+                                     size_t *r_compressed_size)
 {
-  void *data = (ibuf->rect != NULL) ? (void *)ibuf->rect : (void *)ibuf->rect_float;
-  char header[4];
-  fseek(file, header_entry->offset, SEEK_SET);
-  if (fread(header, 1, sizeof(header), file) != sizeof(header)) {
+  const int slices_num = (int)((data_size + DCACHE_COMPRESSION_SLICE_SIZE - 1) /
+                               DCACHE_COMPRESSION_SLICE_SIZE);
+  if (slices_num == 0) {
+    return NULL;
+  }
+
+  DiskCacheCompressData compress_data;
+  compress_data.data = data;
+  compress_data.data_size = data_size;
+  compress_data.level = level;
+  compress_data.slice_bound = ZSTD_compressBound(DCACHE_COMPRESSION_SLICE_SIZE);
+  compress_data.buffer = MEM_mallocN(compress_data.slice_bound * slices_num, __func__);
+  compress_data.slice_sizes = MEM_mallocN(sizeof(size_t) * slices_num, __func__);
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(
+      0, slices_num, &compress_data, seq_disk_cache_compress_slice_fn, &settings);
+
+  /* Pack slices together. Slices are moved towards start of the buffer, so it is safe to do it in
+   * place. */
+  size_t compressed_size = 0;
+  for (int slice = 0; slice < slices_num; slice++) {
+    const size_t slice_size = compress_data.slice_sizes[slice];
+    if (slice_size == 0) {
+      MEM_freeN(compress_data.buffer);
+      MEM_freeN(compress_data.slice_sizes);
+      return NULL;
+    }
+    memmove(compress_data.buffer + compressed_size,
+            compress_data.buffer + slice * compress_data.slice_bound,
+            slice_size);
+    compressed_size += slice_size;
+  }
+
+  MEM_freeN(compress_data.slice_sizes);
+  *r_compressed_size = compressed_size;
+  return compress_data.buffer;
+}
+
+typedef struct DiskCacheDecompressFrame {
+  const char *src;
+  size_t src_size;
+  size_t dst_offset;
+  size_t dst_size;
+} DiskCacheDecompressFrame;
+
+typedef struct DiskCacheDecompressData {
+  DiskCacheDecompressFrame *frames;
+  char *dst;
+  bool error;
+} DiskCacheDecompressData;
+
+static void seq_disk_cache_decompress_frame_fn(void *__restrict userdata,
+                                               const int i,
+                                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  DiskCacheDecompressData *data = userdata;
+  const DiskCacheDecompressFrame *frame = &data->frames[i];
+
+  const size_t size = ZSTD_decompress(
+      data->dst + frame->dst_offset, frame->dst_size, frame->src, frame->src_size);
+  if (ZSTD_isError(size) || size != frame->dst_size) {
+    data->error = true;
+  }
+}
+
+/* Decompress sequence of Zstd frames written by #seq_disk_cache_compress in parallel.
+ * Returns number of decompressed bytes. */
+static size_t seq_disk_cache_decompress(const void *src, size_t src_size, void *dst, size_t dst_size)
+{
+  const int frames_num_max = (int)((dst_size + DCACHE_COMPRESSION_SLICE_SIZE - 1) /
+                                   DCACHE_COMPRESSION_SLICE_SIZE);
+  DiskCacheDecompressFrame *frames = MEM_mallocN(sizeof(*frames) * frames_num_max, __func__);
+  int frames_num = 0;
+
+  /* Find frame boundaries, so frames can be decompressed independently. */
+  size_t src_offset = 0;
+  size_t dst_offset = 0;
+  while (src_offset < src_size) {
+    const char *frame_src = (const char *)src + src_offset;
+    const size_t frame_src_size = ZSTD_findFrameCompressedSize(frame_src, src_size - src_offset);
+    const unsigned long long frame_dst_size = ZSTD_getFrameContentSize(frame_src,
+                                                                       src_size - src_offset);
+    if (ZSTD_isError(frame_src_size) || frame_dst_size == ZSTD_CONTENTSIZE_UNKNOWN ||
+        frame_dst_size == ZSTD_CONTENTSIZE_ERROR || frames_num == frames_num_max ||
+        dst_offset + frame_dst_size > dst_size) {
+      MEM_freeN(frames);
+      return 0;
+    }
+
+    DiskCacheDecompressFrame *frame = &frames[frames_num++];
+    frame->src = frame_src;
+    frame->src_size = frame_src_size;
+    frame->dst_offset = dst_offset;
+    frame->dst_size = (size_t)frame_dst_size;
+    src_offset += frame_src_size;
+    dst_offset += frame->dst_size;
+  }
+
+  DiskCacheDecompressData decompress_data;
+  decompress_data.frames = frames;
+  decompress_data.dst = dst;
+  decompress_data.error = false;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(
+      0, frames_num, &decompress_data, seq_disk_cache_decompress_frame_fn, &settings);
+
+  MEM_freeN(frames);
+  return decompress_data.error ? 0 : dst_offset;
+}
+
+/* Read image data of an entry from memory mapped file. Uncompressed data is copied directly,
+ * compressed data is decompressed straight from the mapping. */
+static size_t seq_disk_cache_read_data(FILE *file, DiskCacheHeaderEntry *header_entry, void *data)
+{
+  const int fd = fileno(file);
+  if (header_entry->offset + header_entry->size_compressed > BLI_file_descriptor_size(fd)) {
     return 0;
   }
 
-  /* Check if the data is compressed or raw. */
-  if (BLI_file_magic_is_zstd(header)) {
-    return BLI_file_unzstd_to_mem_at_pos(data, header_entry->size_raw, file, header_entry->offset);
+  BLI_mmap_file *mmap_file = BLI_mmap_open(fd);
+  if (mmap_file == NULL) {
+    return 0;
   }
 
+  size_t bytes_read = 0;
+  char header[4];
+  if (BLI_mmap_read(mmap_file, header, header_entry->offset, sizeof(header))) {
+    /* Check if the data is compressed or raw. */
+    if (BLI_file_magic_is_zstd(header)) {
+      const char *src = (const char *)BLI_mmap_get_pointer(mmap_file) + header_entry->offset;
+      bytes_read = seq_disk_cache_decompress(
+          src, header_entry->size_compressed, data, header_entry->size_raw);
+    }
+    else if (BLI_mmap_read(mmap_file, data, header_entry->offset, header_entry->size_raw)) {
+      bytes_read = header_entry->size_raw;
+    }
+  }
+
+  BLI_mmap_free(mmap_file);
+  return bytes_read;
+}
+
+static size_t seq_disk_cache_write_data(FILE *file,
+                                        const void *data,
+                                        DiskCacheHeaderEntry *header_entry,
+                                        size_t size)
+{
   fseek(file, header_entry->offset, SEEK_SET);
-  return fread(data, 1, header_entry->size_raw, file);
+  return fwrite(data, 1, size, file);
 }
 
 static bool seq_disk_cache_read_header(FILE *file, DiskCacheHeader *header)
@@ -534,12 +713,11 @@ static int seq_disk_cache_add_header_entry(SeqCacheKey *key, ImBuf *ibuf, DiskCa
 
   /* Store colorspace name of ibuf. */
   const char *colorspace_name;
+  header->entry[i].size_raw = seq_disk_cache_imbuf_data_size(ibuf);
   if (ibuf->rect) {
-    header->entry[i].size_raw = ibuf->x * ibuf->y * ibuf->channels;
     colorspace_name = IMB_colormanagement_get_rect_colorspace(ibuf);
   }
   else {
-    header->entry[i].size_raw = ibuf->x * ibuf->y * ibuf->channels * 4;
     colorspace_name = IMB_colormanagement_get_float_colorspace(ibuf);
   }
   BLI_strncpy(
@@ -561,6 +739,20 @@ static int seq_disk_cache_get_header_entry(SeqCacheKey *key, DiskCacheHeader *he
 
 bool seq_disk_cache_write_file(SeqDiskCache *disk_cache, SeqCacheKey *key, ImBuf *ibuf)
 {
+  const void *data = seq_disk_cache_imbuf_data(ibuf);
+  size_t data_size = seq_disk_cache_imbuf_data_size(ibuf);
+
+  /* Compress image before locking the cache, so other threads can read and write meanwhile. */
+  void *compressed_data = NULL;
+  const int level = seq_disk_cache_compression_level();
+  if (level != 0) {
+    compressed_data = seq_disk_cache_compress(data, data_size, level, &data_size);
+    if (compressed_data == NULL) {
+      return false;
+    }
+    data = compressed_data;
+  }
+
   BLI_mutex_lock(&disk_cache->read_write_mutex);
 
   char path[FILE_MAX];
@@ -573,6 +765,7 @@ bool seq_disk_cache_write_file(SeqDiskCache *disk_cache, SeqCacheKey *key, ImBuf
     file = BLI_fopen(path, "wb+");
     if (!file) {
       BLI_mutex_unlock(&disk_cache->read_write_mutex);
+      MEM_SAFE_FREE(compressed_data);
       return false;
     }
     seq_disk_cache_add_file_to_list(disk_cache, path);
@@ -587,14 +780,16 @@ bool seq_disk_cache_write_file(SeqDiskCache *disk_cache, SeqCacheKey *key, ImBuf
     fclose(file);
     seq_disk_cache_delete_file(disk_cache, cache_file);
     BLI_mutex_unlock(&disk_cache->read_write_mutex);
+    MEM_SAFE_FREE(compressed_data);
     return false;
   }
   int entry_index = seq_disk_cache_add_header_entry(key, ibuf, &header);
 
-  size_t bytes_written = deflate_imbuf_to_file(
-      ibuf, file, seq_disk_cache_compression_level(), &header.entry[entry_index]);
+  size_t bytes_written = seq_disk_cache_write_data(
+      file, data, &header.entry[entry_index], data_size);
+  MEM_SAFE_FREE(compressed_data);
 
-  if (bytes_written != 0) {
+  if (bytes_written == data_size) {
     /* Last step is writing header, as image data can be overwritten,
      * but missing data would cause problems.
      */
@@ -607,6 +802,7 @@ bool seq_disk_cache_write_file(SeqDiskCache *disk_cache, SeqCacheKey *key, ImBuf
     return true;
   }
 
+  fclose(file);
   BLI_mutex_unlock(&disk_cache->read_write_mutex);
   return false;
 }
@@ -662,7 +858,8 @@ ImBuf *seq_disk_cache_read_file(SeqDiskCache *disk_cache, SeqCacheKey *key)
     return NULL;
   }
 
-  size_t bytes_read = inflate_file_to_imbuf(ibuf, file, &header.entry[entry_index]);
+  size_t bytes_read = seq_disk_cache_read_data(
+      file, &header.entry[entry_index], seq_disk_cache_imbuf_data(ibuf));
 
   /* Sanity check. */
   if (bytes_read != expected_size) {
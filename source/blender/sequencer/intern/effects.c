@@ -34,6 +34,7 @@
 #include "BLI_math.h" /* windows needs for M_PI */
 #include "BLI_path_util.h"
 #include "BLI_rect.h"
+#include "BLI_simd.h"
 #include "BLI_string.h"
 #include "BLI_threads.h"
 #include "BLI_utildefines.h"
@@ -48,6 +49,7 @@
 #include "BKE_fcurve.h"
 #include "BKE_lib_id.h"
 #include "BKE_main.h"
+#include "BKE_packedFile.h"
 
 #include "IMB_colormanagement.h"
 #include "IMB_imbuf.h"
@@ -291,72 +293,73 @@ static void do_alphaover_effect_byte(float facf0,
   }
 }
 
-static void do_alphaover_effect_float(
-    float facf0, float facf1, int x, int y, float *rect1, float *rect2, float *out)
+static void do_alphaover_effect_float_row(
+    const float fac, int x, const float *rt1, const float *rt2, float *rt)
 {
-  float fac2, mfac, fac, fac4;
-  int xo;
-  float *rt1, *rt2, *rt;
+  /* rt = rt1 over rt2  (alpha from rt1) */
+  if (fac <= 0.0f) {
+    memcpy(rt, rt2, sizeof(float[4]) * x);
+    return;
+  }
 
-  xo = x;
-  rt1 = rect1;
-  rt2 = rect2;
-  rt = out;
+#ifdef BLI_HAVE_SSE2
+  const __m128 fac_v = _mm_set1_ps(fac);
+  const __m128 one_v = _mm_set1_ps(1.0f);
+  const __m128 zero_v = _mm_setzero_ps();
+  while (x--) {
+    const __m128 rt1_v = _mm_loadu_ps(rt1);
+    const __m128 rt2_v = _mm_loadu_ps(rt2);
+    const __m128 alpha_v = _mm_shuffle_ps(rt1_v, rt1_v, _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128 mfac_v = _mm_sub_ps(one_v, _mm_mul_ps(fac_v, alpha_v));
+    const __m128 blend_v = _mm_add_ps(_mm_mul_ps(fac_v, rt1_v), _mm_mul_ps(mfac_v, rt2_v));
+    /* Use rt1 as-is where it is fully opaque. */
+    const __m128 opaque_v = _mm_cmple_ps(mfac_v, zero_v);
+    _mm_storeu_ps(rt, _mm_or_ps(_mm_and_ps(opaque_v, rt1_v), _mm_andnot_ps(opaque_v, blend_v)));
+    rt1 += 4;
+    rt2 += 4;
+    rt += 4;
+  }
+#else
+  while (x--) {
+    const float mfac = 1.0f - (fac * rt1[3]);
+
+    if (mfac <= 0.0f) {
+      memcpy(rt, rt1, sizeof(float[4]));
+    }
+    else {
+      rt[0] = fac * rt1[0] + mfac * rt2[0];
+      rt[1] = fac * rt1[1] + mfac * rt2[1];
+      rt[2] = fac * rt1[2] + mfac * rt2[2];
+      rt[3] = fac * rt1[3] + mfac * rt2[3];
+    }
+    rt1 += 4;
+    rt2 += 4;
+    rt += 4;
+  }
+#endif
+}
 
-  fac2 = facf0;
-  fac4 = facf1;
+static void do_alphaover_effect_float(
+    float facf0, float facf1, int x, int y, float *rect1, float *rect2, float *out)
+{
+  float *rt1 = rect1, *rt2 = rect2, *rt = out;
+  const int stride = x * 4;
 
   while (y--) {
-    x = xo;
-    while (x--) {
-      /* rt = rt1 over rt2  (alpha from rt1) */
-
-      fac = fac2;
-      mfac = 1.0f - (fac2 * rt1[3]);
-
-      if (fac <= 0.0f) {
-        memcpy(rt, rt2, sizeof(float[4]));
-      }
-      else if (mfac <= 0) {
-        memcpy(rt, rt1, sizeof(float[4]));
-      }
-      else {
-        rt[0] = fac * rt1[0] + mfac * rt2[0];
-        rt[1] = fac * rt1[1] + mfac * rt2[1];
-        rt[2] = fac * rt1[2] + mfac * rt2[2];
-        rt[3] = fac * rt1[3] + mfac * rt2[3];
-      }
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
+    do_alphaover_effect_float_row(facf0, x, rt1, rt2, rt);
+    rt1 += stride;
+    rt2 += stride;
+    rt += stride;
 
     if (y == 0) {
       break;
     }
     y--;
 
-    x = xo;
-    while (x--) {
-      fac = fac4;
-      mfac = 1.0f - (fac4 * rt1[3]);
-
-      if (fac <= 0.0f) {
-        memcpy(rt, rt2, sizeof(float[4]));
-      }
-      else if (mfac <= 0.0f) {
-        memcpy(rt, rt1, sizeof(float[4]));
-      }
-      else {
-        rt[0] = fac * rt1[0] + mfac * rt2[0];
-        rt[1] = fac * rt1[1] + mfac * rt2[1];
-        rt[2] = fac * rt1[2] + mfac * rt2[2];
-        rt[3] = fac * rt1[3] + mfac * rt2[3];
-      }
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
+    do_alphaover_effect_float_row(facf1, x, rt1, rt2, rt);
+    rt1 += stride;
+    rt2 += stride;
+    rt += stride;
   }
 }
 
@@ -599,6 +602,44 @@ static void do_alphaunder_effect(const SeqRenderData *context,
 
 /*********************** Cross *************************/
 
+static void do_cross_effect_byte_row(
+    const int fac1, const int fac2, int x, const uchar *rt1, const uchar *rt2, uchar *rt)
+{
+#ifdef BLI_HAVE_SSE2
+  /* The weighted sum of 8 bit values fits in unsigned 16 bit, since `fac1 + fac2 == 256`. */
+  const __m128i fac1_v = _mm_set1_epi16((short)fac1);
+  const __m128i fac2_v = _mm_set1_epi16((short)fac2);
+  const __m128i zero_v = _mm_setzero_si128();
+  for (; x >= 4; x -= 4) {
+    const __m128i rt1_v = _mm_loadu_si128((const __m128i *)rt1);
+    const __m128i rt2_v = _mm_loadu_si128((const __m128i *)rt2);
+    const __m128i lo_v = _mm_srli_epi16(
+        _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(rt1_v, zero_v), fac1_v),
+                      _mm_mullo_epi16(_mm_unpacklo_epi8(rt2_v, zero_v), fac2_v)),
+        8);
+    const __m128i hi_v = _mm_srli_epi16(
+        _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(rt1_v, zero_v), fac1_v),
+                      _mm_mullo_epi16(_mm_unpackhi_epi8(rt2_v, zero_v), fac2_v)),
+        8);
+    _mm_storeu_si128((__m128i *)rt, _mm_packus_epi16(lo_v, hi_v));
+    rt1 += 16;
+    rt2 += 16;
+    rt += 16;
+  }
+#endif
+
+  while (x--) {
+    rt[0] = (fac1 * rt1[0] + fac2 * rt2[0]) >> 8;
+    rt[1] = (fac1 * rt1[1] + fac2 * rt2[1]) >> 8;
+    rt[2] = (fac1 * rt1[2] + fac2 * rt2[2]) >> 8;
+    rt[3] = (fac1 * rt1[3] + fac2 * rt2[3]) >> 8;
+
+    rt1 += 4;
+    rt2 += 4;
+    rt += 4;
+  }
+}
+
 static void do_cross_effect_byte(float facf0,
                                  float facf1,
                                  int x,
@@ -607,98 +648,86 @@ static void do_cross_effect_byte(float facf0,
                                  unsigned char *rect2,
                                  unsigned char *out)
 {
-  int fac1, fac2, fac3, fac4;
-  int xo;
-  unsigned char *rt1, *rt2, *rt;
-
-  xo = x;
-  rt1 = rect1;
-  rt2 = rect2;
-  rt = out;
+  unsigned char *rt1 = rect1, *rt2 = rect2, *rt = out;
+  const int stride = x * 4;
 
-  fac2 = (int)(256.0f * facf0);
-  fac1 = 256 - fac2;
-  fac4 = (int)(256.0f * facf1);
-  fac3 = 256 - fac4;
+  const int fac2 = (int)(256.0f * facf0);
+  const int fac1 = 256 - fac2;
+  const int fac4 = (int)(256.0f * facf1);
+  const int fac3 = 256 - fac4;
 
   while (y--) {
-    x = xo;
-    while (x--) {
-      rt[0] = (fac1 * rt1[0] + fac2 * rt2[0]) >> 8;
-      rt[1] = (fac1 * rt1[1] + fac2 * rt2[1]) >> 8;
-      rt[2] = (fac1 * rt1[2] + fac2 * rt2[2]) >> 8;
-      rt[3] = (fac1 * rt1[3] + fac2 * rt2[3]) >> 8;
-
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
+    do_cross_effect_byte_row(fac1, fac2, x, rt1, rt2, rt);
+    rt1 += stride;
+    rt2 += stride;
+    rt += stride;
 
     if (y == 0) {
       break;
     }
     y--;
 
-    x = xo;
-    while (x--) {
-      rt[0] = (fac3 * rt1[0] + fac4 * rt2[0]) >> 8;
-      rt[1] = (fac3 * rt1[1] + fac4 * rt2[1]) >> 8;
-      rt[2] = (fac3 * rt1[2] + fac4 * rt2[2]) >> 8;
-      rt[3] = (fac3 * rt1[3] + fac4 * rt2[3]) >> 8;
+    do_cross_effect_byte_row(fac3, fac4, x, rt1, rt2, rt);
+    rt1 += stride;
+    rt2 += stride;
+    rt += stride;
+  }
+}
 
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
+static void do_cross_effect_float_row(
+    const float fac1, const float fac2, int x, const float *rt1, const float *rt2, float *rt)
+{
+#ifdef BLI_HAVE_SSE2
+  const __m128 fac1_v = _mm_set1_ps(fac1);
+  const __m128 fac2_v = _mm_set1_ps(fac2);
+  while (x--) {
+    _mm_storeu_ps(rt,
+                  _mm_add_ps(_mm_mul_ps(fac1_v, _mm_loadu_ps(rt1)),
+                             _mm_mul_ps(fac2_v, _mm_loadu_ps(rt2))));
+    rt1 += 4;
+    rt2 += 4;
+    rt += 4;
   }
+#else
+  while (x--) {
+    rt[0] = fac1 * rt1[0] + fac2 * rt2[0];
+    rt[1] = fac1 * rt1[1] + fac2 * rt2[1];
+    rt[2] = fac1 * rt1[2] + fac2 * rt2[2];
+    rt[3] = fac1 * rt1[3] + fac2 * rt2[3];
+
+    rt1 += 4;
+    rt2 += 4;
+    rt += 4;
+  }
+#endif
 }
 
 static void do_cross_effect_float(
     float facf0, float facf1, int x, int y, float *rect1, float *rect2, float *out)
 {
-  float fac1, fac2, fac3, fac4;
-  int xo;
-  float *rt1, *rt2, *rt;
+  float *rt1 = rect1, *rt2 = rect2, *rt = out;
+  const int stride = x * 4;
 
-  xo = x;
-  rt1 = rect1;
-  rt2 = rect2;
-  rt = out;
-
-  fac2 = facf0;
-  fac1 = 1.0f - fac2;
-  fac4 = facf1;
-  fac3 = 1.0f - fac4;
+  const float fac2 = facf0;
+  const float fac1 = 1.0f - fac2;
+  const float fac4 = facf1;
+  const float fac3 = 1.0f - fac4;
 
   while (y--) {
-    x = xo;
-    while (x--) {
-      rt[0] = fac1 * rt1[0] + fac2 * rt2[0];
-      rt[1] = fac1 * rt1[1] + fac2 * rt2[1];
-      rt[2] = fac1 * rt1[2] + fac2 * rt2[2];
-      rt[3] = fac1 * rt1[3] + fac2 * rt2[3];
-
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
+    do_cross_effect_float_row(fac1, fac2, x, rt1, rt2, rt);
+    rt1 += stride;
+    rt2 += stride;
+    rt += stride;
 
     if (y == 0) {
       break;
     }
     y--;
 
-    x = xo;
-    while (x--) {
-      rt[0] = fac3 * rt1[0] + fac4 * rt2[0];
-      rt[1] = fac3 * rt1[1] + fac4 * rt2[1];
-      rt[2] = fac3 * rt1[2] + fac4 * rt2[2];
-      rt[3] = fac3 * rt1[3] + fac4 * rt2[3];
-
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
+    do_cross_effect_float_row(fac3, fac4, x, rt1, rt2, rt);
+    rt1 += stride;
+    rt2 += stride;
+    rt += stride;
   }
 }
 
@@ -1086,52 +1115,73 @@ static void do_add_effect_byte(float facf0,
   }
 }
 
-static void do_add_effect_float(
-    float facf0, float facf1, int x, int y, float *rect1, float *rect2, float *out)
+#ifdef BLI_HAVE_SSE2
+/** Broadcast the alpha channel of a premultiplied RGBA pixel. */
+BLI_INLINE __m128 effect_sse_alpha(const __m128 rgba)
 {
-  int xo;
-  float fac1, fac3;
-  float *rt1, *rt2, *rt;
+  return _mm_shuffle_ps(rgba, rgba, _MM_SHUFFLE(3, 3, 3, 3));
+}
 
-  xo = x;
-  rt1 = rect1;
-  rt2 = rect2;
-  rt = out;
+/** Use the RGB channels of \a rgb and the alpha channel of \a alpha. */
+BLI_INLINE __m128 effect_sse_rgb_with_alpha(const __m128 rgb, const __m128 alpha)
+{
+  const __m128 alpha_mask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+  return _mm_or_ps(_mm_andnot_ps(alpha_mask, rgb), _mm_and_ps(alpha_mask, alpha));
+}
+#endif
 
-  fac1 = facf0;
-  fac3 = facf1;
+static void do_add_effect_float_row(
+    const float fac, int x, const float *rt1, const float *rt2, float *rt)
+{
+#ifdef BLI_HAVE_SSE2
+  const __m128 one_v = _mm_set1_ps(1.0f);
+  const __m128 mfac_v = _mm_set1_ps(1.0f - fac);
+  while (x--) {
+    const __m128 rt1_v = _mm_loadu_ps(rt1);
+    const __m128 rt2_v = _mm_loadu_ps(rt2);
+    const __m128 m_v = _mm_mul_ps(_mm_sub_ps(one_v, _mm_mul_ps(effect_sse_alpha(rt1_v), mfac_v)),
+                                  effect_sse_alpha(rt2_v));
+    _mm_storeu_ps(rt, effect_sse_rgb_with_alpha(_mm_add_ps(rt1_v, _mm_mul_ps(m_v, rt2_v)), rt1_v));
+    rt1 += 4;
+    rt2 += 4;
+    rt += 4;
+  }
+#else
+  while (x--) {
+    const float m = (1.0f - (rt1[3] * (1.0f - fac))) * rt2[3];
+    rt[0] = rt1[0] + m * rt2[0];
+    rt[1] = rt1[1] + m * rt2[1];
+    rt[2] = rt1[2] + m * rt2[2];
+    rt[3] = rt1[3];
 
-  while (y--) {
-    x = xo;
-    while (x--) {
-      const float m = (1.0f - (rt1[3] * (1.0f - fac1))) * rt2[3];
-      rt[0] = rt1[0] + m * rt2[0];
-      rt[1] = rt1[1] + m * rt2[1];
-      rt[2] = rt1[2] + m * rt2[2];
-      rt[3] = rt1[3];
+    rt1 += 4;
+    rt2 += 4;
+    rt += 4;
+  }
+#endif
+}
 
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
+static void do_add_effect_float(
+    float facf0, float facf1, int x, int y, float *rect1, float *rect2, float *out)
+{
+  float *rt1 = rect1, *rt2 = rect2, *rt = out;
+  const int stride = x * 4;
+
+  while (y--) {
+    do_add_effect_float_row(facf0, x, rt1, rt2, rt);
+    rt1 += stride;
+    rt2 += stride;
+    rt += stride;
 
     if (y == 0) {
       break;
     }
     y--;
 
-    x = xo;
-    while (x--) {
-      const float m = (1.0f - (rt1[3] * (1.0f - fac3))) * rt2[3];
-      rt[0] = rt1[0] + m * rt2[0];
-      rt[1] = rt1[1] + m * rt2[1];
-      rt[2] = rt1[2] + m * rt2[2];
-      rt[3] = rt1[3];
-
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
+    do_add_effect_float_row(facf1, x, rt1, rt2, rt);
+    rt1 += stride;
+    rt2 += stride;
+    rt += stride;
   }
 }
 
@@ -1220,53 +1270,62 @@ static void do_sub_effect_byte(float facf0,
   }
 }
 
-static void do_sub_effect_float(
-    float UNUSED(facf0), float facf1, int x, int y, float *rect1, float *rect2, float *out)
+static void do_sub_effect_float_row(
+    const float fac, int x, const float *rt1, const float *rt2, float *rt)
 {
-  int xo;
-  float /* fac1, */ fac3_inv;
-  float *rt1, *rt2, *rt;
+#ifdef BLI_HAVE_SSE2
+  const __m128 zero_v = _mm_setzero_ps();
+  const __m128 one_v = _mm_set1_ps(1.0f);
+  const __m128 mfac_v = _mm_set1_ps(1.0f - fac);
+  while (x--) {
+    const __m128 rt1_v = _mm_loadu_ps(rt1);
+    const __m128 rt2_v = _mm_loadu_ps(rt2);
+    const __m128 m_v = _mm_mul_ps(_mm_sub_ps(one_v, _mm_mul_ps(effect_sse_alpha(rt1_v), mfac_v)),
+                                  effect_sse_alpha(rt2_v));
+    const __m128 sub_v = _mm_max_ps(_mm_sub_ps(rt1_v, _mm_mul_ps(m_v, rt2_v)), zero_v);
+    _mm_storeu_ps(rt, effect_sse_rgb_with_alpha(sub_v, rt1_v));
+    rt1 += 4;
+    rt2 += 4;
+    rt += 4;
+  }
+#else
+  const float fac_inv = 1.0f - fac;
+  while (x--) {
+    const float m = (1.0f - (rt1[3] * fac_inv)) * rt2[3];
+    rt[0] = max_ff(rt1[0] - m * rt2[0], 0.0f);
+    rt[1] = max_ff(rt1[1] - m * rt2[1], 0.0f);
+    rt[2] = max_ff(rt1[2] - m * rt2[2], 0.0f);
+    rt[3] = rt1[3];
 
-  xo = x;
-  rt1 = rect1;
-  rt2 = rect2;
-  rt = out;
+    rt1 += 4;
+    rt2 += 4;
+    rt += 4;
+  }
+#endif
+}
 
-  /* UNUSED */
-  // fac1 = facf0;
-  fac3_inv = 1.0f - facf1;
+static void do_sub_effect_float(
+    float UNUSED(facf0), float facf1, int x, int y, float *rect1, float *rect2, float *out)
+{
+  float *rt1 = rect1, *rt2 = rect2, *rt = out;
+  const int stride = x * 4;
 
+  /* NOTE: only the second field factor is used, for both fields. */
   while (y--) {
-    x = xo;
-    while (x--) {
-      const float m = (1.0f - (rt1[3] * fac3_inv)) * rt2[3];
-      rt[0] = max_ff(rt1[0] - m * rt2[0], 0.0f);
-      rt[1] = max_ff(rt1[1] - m * rt2[1], 0.0f);
-      rt[2] = max_ff(rt1[2] - m * rt2[2], 0.0f);
-      rt[3] = rt1[3];
-
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
+    do_sub_effect_float_row(facf1, x, rt1, rt2, rt);
+    rt1 += stride;
+    rt2 += stride;
+    rt += stride;
 
     if (y == 0) {
       break;
     }
     y--;
 
-    x = xo;
-    while (x--) {
-      const float m = (1.0f - (rt1[3] * fac3_inv)) * rt2[3];
-      rt[0] = max_ff(rt1[0] - m * rt2[0], 0.0f);
-      rt[1] = max_ff(rt1[1] - m * rt2[1], 0.0f);
-      rt[2] = max_ff(rt1[2] - m * rt2[2], 0.0f);
-      rt[3] = rt1[3];
-
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
+    do_sub_effect_float_row(facf1, x, rt1, rt2, rt);
+    rt1 += stride;
+    rt2 += stride;
+    rt += stride;
   }
 }
 
@@ -1469,53 +1528,59 @@ static void do_mul_effect_byte(float facf0,
   }
 }
 
-static void do_mul_effect_float(
-    float facf0, float facf1, int x, int y, float *rect1, float *rect2, float *out)
+static void do_mul_effect_float_row(
+    const float fac, int x, const float *rt1, const float *rt2, float *rt)
 {
-  int xo;
-  float fac1, fac3;
-  float *rt1, *rt2, *rt;
-
-  xo = x;
-  rt1 = rect1;
-  rt2 = rect2;
-  rt = out;
-
-  fac1 = facf0;
-  fac3 = facf1;
-
   /* Formula:
    * `fac * (a * b) + (1 - fac) * a => fac * a * (b - 1) + a`. */
+#ifdef BLI_HAVE_SSE2
+  const __m128 one_v = _mm_set1_ps(1.0f);
+  const __m128 fac_v = _mm_set1_ps(fac);
+  while (x--) {
+    const __m128 rt1_v = _mm_loadu_ps(rt1);
+    const __m128 rt2_v = _mm_loadu_ps(rt2);
+    _mm_storeu_ps(
+        rt,
+        _mm_add_ps(rt1_v, _mm_mul_ps(_mm_mul_ps(fac_v, rt1_v), _mm_sub_ps(rt2_v, one_v))));
+    rt1 += 4;
+    rt2 += 4;
+    rt += 4;
+  }
+#else
+  while (x--) {
+    rt[0] = rt1[0] + fac * rt1[0] * (rt2[0] - 1.0f);
+    rt[1] = rt1[1] + fac * rt1[1] * (rt2[1] - 1.0f);
+    rt[2] = rt1[2] + fac * rt1[2] * (rt2[2] - 1.0f);
+    rt[3] = rt1[3] + fac * rt1[3] * (rt2[3] - 1.0f);
+
+    rt1 += 4;
+    rt2 += 4;
+    rt += 4;
+  }
+#endif
+}
 
-  while (y--) {
-    x = xo;
-    while (x--) {
-      rt[0] = rt1[0] + fac1 * rt1[0] * (rt2[0] - 1.0f);
-      rt[1] = rt1[1] + fac1 * rt1[1] * (rt2[1] - 1.0f);
-      rt[2] = rt1[2] + fac1 * rt1[2] * (rt2[2] - 1.0f);
-      rt[3] = rt1[3] + fac1 * rt1[3] * (rt2[3] - 1.0f);
+static void do_mul_effect_float(
+    float facf0, float facf1, int x, int y, float *rect1, float *rect2, float *out)
+{
+  float *rt1 = rect1, *rt2 = rect2, *rt = out;
+  const int stride = x * 4;
 
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
+  while (y--) {
+    do_mul_effect_float_row(facf0, x, rt1, rt2, rt);
+    rt1 += stride;
+    rt2 += stride;
+    rt += stride;
 
     if (y == 0) {
       break;
     }
     y--;
 
-    x = xo;
-    while (x--) {
-      rt[0] = rt1[0] + fac3 * rt1[0] * (rt2[0] - 1.0f);
-      rt[1] = rt1[1] + fac3 * rt1[1] * (rt2[1] - 1.0f);
-      rt[2] = rt1[2] + fac3 * rt1[2] * (rt2[2] - 1.0f);
-      rt[3] = rt1[3] + fac3 * rt1[3] * (rt2[3] - 1.0f);
-
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
+    do_mul_effect_float_row(facf1, x, rt1, rt2, rt);
+    rt1 += stride;
+    rt2 += stride;
+    rt += stride;
   }
 }
 
@@ -3786,7 +3851,7 @@ void SEQ_effect_text_font_load(TextVars *data, const bool do_id_user)
     id_us_plus(&vfont->id);
   }
 
-  if (vfont->packedfile != NULL) {
+  if (vfont->packedfile != NULL && BKE_packedfile_ensure_data(vfont->packedfile)) {
     PackedFile *pf = vfont->packedfile;
     /* Create a name that's unique between library data-blocks to avoid loading
      * a font per strip which will load fonts many times. */
@@ -3847,6 +3912,9 @@ static int early_out_text(Sequence *seq, float UNUSED(facf0), float UNUSED(facf1
   return EARLY_NO_INPUT;
 }
 
+/* Fonts and their buffer drawing state are shared, prefetch workers render frames concurrently. */
+static ThreadMutex text_render_mutex = BLI_MUTEX_INITIALIZER;
+
 static ImBuf *do_text_effect(const SeqRenderData *context,
                              Sequence *seq,
                              float UNUSED(timeline_frame),
@@ -3867,6 +3935,8 @@ static ImBuf *do_text_effect(const SeqRenderData *context,
   int y_ofs, x, y;
   double proxy_size_comp;
 
+  BLI_mutex_lock(&text_render_mutex);
+
   if (data->text_blf_id == SEQ_FONT_NOT_LOADED) {
     data->text_blf_id = -1;
 
@@ -3965,6 +4035,8 @@ static ImBuf *do_text_effect(const SeqRenderData *context,
 
   BLF_disable(font, font_flags);
 
+  BLI_mutex_unlock(&text_render_mutex);
+
   return out;
 }
 
@@ -22,6 +22,7 @@
 
 #include <memory.h>
 #include <stddef.h>
+#include <stdlib.h>
 #include <time.h>
 
 #include "MEM_guardedalloc.h"
@@ -45,6 +46,8 @@
 #include "BLI_path_util.h"
 #include "BLI_threads.h"
 
+#include "PIL_time.h"
+
 #include "BKE_main.h"
 #include "BKE_scene.h"
 
@@ -75,14 +78,21 @@
  * Only permanent (is_temp_cache = 0) cache entries are linked.
  * Putting #SEQ_CACHE_STORE_FINAL_OUT will reset linking
  *
- * Only entire frame can be freed to release resources for new entries (recycling).
- * Once again, this is to reduce number of iterations, but also more controllable than removing
- * entries one by one in reverse order to their creation.
+ * Recycling: Entries are freed to release resources for new entries. Each entry stores render
+ * cost, which is the time it took to render the image, including its inputs that were not
+ * cached (see #SeqRenderData.render_start_time). Entries are scored
+ * by cost, memory size and distance from playhead, frames that were already played are weighted
+ * as being further away. Entry with lowest score is freed first, so cheap raw images far from
+ * playhead go before expensive composites near it. Freed entries are unlinked from their chain.
  *
  * User can exclude caching of some images. Such entries will have is_temp_cache set.
  */
 
 #define THUMB_CACHE_LIMIT 5000
+/* Cost of entries that were not rendered, such as images read from disk cache. */
+#define SEQ_CACHE_COST_MIN 0.01f
+/* Frames before playhead are considered this many times further away than frames after it. */
+#define SEQ_CACHE_PLAYED_DISTANCE_FACTOR 2.0f
 
 typedef struct SeqCache {
   Main *bmain;
@@ -90,9 +100,12 @@ typedef struct SeqCache {
   ThreadMutex iterator_mutex;
   struct BLI_mempool *keys_pool;
   struct BLI_mempool *items_pool;
-  struct SeqCacheKey *last_key;
+  /* Last key put into cache by each rendering task. */
+  struct SeqCacheKey *last_key[SEQ_TASK_NUM];
   struct SeqDiskCache *disk_cache;
   int thumbnail_count;
+  /* Running #SeqCacheStripStats of each strip, so they don't require iterating the cache. */
+  struct GHash *strip_stats;
 } SeqCache;
 
 typedef struct SeqCacheItem {
@@ -195,9 +208,49 @@ static size_t seq_cache_get_mem_total(void)
   return ((size_t)U.memcachelimit) * 1024 * 1024;
 }
 
+/* Count a stored image in the statistics of its strip. Temporary entries are not counted. */
+static void seq_cache_strip_stats_add(SeqCacheKey *key, ImBuf *ibuf)
+{
+  if (key->is_temp_cache || key->type == SEQ_CACHE_STORE_THUMBNAIL || ibuf == NULL) {
+    return;
+  }
+
+  SeqCache *cache = key->cache_owner;
+  void **stats_p;
+  if (!BLI_ghash_ensure_p(cache->strip_stats, key->seq, &stats_p)) {
+    *stats_p = MEM_callocN(sizeof(SeqCacheStripStats), "SeqCacheStripStats");
+  }
+  SeqCacheStripStats *stats = *stats_p;
+
+  key->is_in_strip_stats = true;
+  key->strip_stats_memory_size = IMB_get_size_in_memory(ibuf);
+  stats->entries_num++;
+  stats->memory_size += key->strip_stats_memory_size;
+  stats->cost_total += key->cost;
+}
+
+static void seq_cache_strip_stats_remove(SeqCacheKey *key)
+{
+  if (!key->is_in_strip_stats) {
+    return;
+  }
+
+  SeqCache *cache = key->cache_owner;
+  SeqCacheStripStats *stats = BLI_ghash_lookup(cache->strip_stats, key->seq);
+
+  key->is_in_strip_stats = false;
+  stats->entries_num--;
+  stats->memory_size -= key->strip_stats_memory_size;
+  stats->cost_total -= key->cost;
+  if (stats->entries_num == 0) {
+    BLI_ghash_remove(cache->strip_stats, key->seq, NULL, MEM_freeN);
+  }
+}
+
 static void seq_cache_keyfree(void *val)
 {
   SeqCacheKey *key = val;
+  seq_cache_strip_stats_remove(key);
   BLI_mempool_free(key->cache_owner->keys_pool, key);
 }
 
@@ -236,35 +289,39 @@ static void seq_cache_put_ex(Scene *scene, SeqCacheKey *key, ImBuf *ibuf)
   item->cache_owner = cache;
   item->ibuf = ibuf;
 
+  /* Each task renders its own frame, so entries are linked per task. */
+  SeqCacheKey **last_key = &cache->last_key[key->task_id];
+
   const int stored_types_flag = get_stored_types_flag(scene, key);
 
   /* Item stored for later use. */
   if (stored_types_flag & key->type) {
     key->is_temp_cache = false;
-    key->link_prev = cache->last_key;
+    key->link_prev = *last_key;
   }
 
   /* Store pointer to last cached key. */
-  SeqCacheKey *temp_last_key = cache->last_key;
+  SeqCacheKey *temp_last_key = *last_key;
 
   if (BLI_ghash_reinsert(cache->hash, key, item, seq_cache_keyfree, seq_cache_valfree)) {
     IMB_refImBuf(ibuf);
 
     if (!key->is_temp_cache || key->type != SEQ_CACHE_STORE_THUMBNAIL) {
-      cache->last_key = key;
+      *last_key = key;
     }
   }
+  seq_cache_strip_stats_add(key, ibuf);
 
   /* Set last_key's reference to this key so we can look up chain backwards.
-   * Item is already put in cache, so cache->last_key points to current key.
+   * Item is already put in cache, so last_key points to current key.
    */
   if (!key->is_temp_cache && temp_last_key) {
-    temp_last_key->link_next = cache->last_key;
+    temp_last_key->link_next = *last_key;
   }
 
   /* Reset linking. */
   if (key->type == SEQ_CACHE_STORE_FINAL_OUT) {
-    cache->last_key = NULL;
+    *last_key = NULL;
   }
 }
 
@@ -291,69 +348,6 @@ static void seq_cache_relink_keys(SeqCacheKey *link_next, SeqCacheKey *link_prev
   }
 }
 
-/* Choose a key out of 2 candidates(leftmost and rightmost items)
- * to recycle based on currently used strategy */
-static SeqCacheKey *seq_cache_choose_key(Scene *scene, SeqCacheKey *lkey, SeqCacheKey *rkey)
-{
-  SeqCacheKey *finalkey = NULL;
-
-  /* Ideally, cache would not need to check the state of prefetching task
-   * that is tricky to do however, because prefetch would need to know,
-   * if a key, that is about to be created would be removed by itself.
-   *
-   * This can happen because only FINAL_OUT item insertion will trigger recycling
-   * but that is also the point, where prefetch can be suspended.
-   *
-   * We could use temp cache as a shield and later make it a non-temporary entry,
-   * but it is not worth of increasing system complexity.
-   */
-  if (scene->ed->cache_flag & SEQ_CACHE_PREFETCH_ENABLE && seq_prefetch_job_is_running(scene)) {
-    int pfjob_start, pfjob_end;
-    seq_prefetch_get_time_range(scene, &pfjob_start, &pfjob_end);
-
-    if (lkey) {
-      if (lkey->timeline_frame < pfjob_start || lkey->timeline_frame > pfjob_end) {
-        return lkey;
-      }
-    }
-
-    if (rkey) {
-      if (rkey->timeline_frame < pfjob_start || rkey->timeline_frame > pfjob_end) {
-        return rkey;
-      }
-    }
-
-    return NULL;
-  }
-
-  if (rkey && lkey) {
-    if (lkey->timeline_frame > rkey->timeline_frame) {
-      SeqCacheKey *swapkey = lkey;
-      lkey = rkey;
-      rkey = swapkey;
-    }
-
-    int l_diff = scene->r.cfra - lkey->timeline_frame;
-    int r_diff = rkey->timeline_frame - scene->r.cfra;
-
-    if (l_diff > r_diff) {
-      finalkey = lkey;
-    }
-    else {
-      finalkey = rkey;
-    }
-  }
-  else {
-    if (lkey) {
-      finalkey = lkey;
-    }
-    else {
-      finalkey = rkey;
-    }
-  }
-  return finalkey;
-}
-
 static void seq_cache_recycle_linked(Scene *scene, SeqCacheKey *base)
 {
   SeqCache *cache = seq_cache_get_from_scene(scene);
@@ -397,22 +391,85 @@ static void seq_cache_recycle_linked(Scene *scene, SeqCacheKey *base)
   }
 }
 
-static SeqCacheKey *seq_cache_get_item_for_removal(Scene *scene)
+/* Estimate how valuable it is to keep an entry. Entries that took long time to render are kept,
+ * while large entries and entries far from playhead are freed first. */
+static float seq_cache_key_retention_score(Scene *scene,
+                                           SeqCacheKey *key,
+                                           const size_t size_in_bytes)
+{
+  const float cost = max_ff(key->cost, SEQ_CACHE_COST_MIN);
+  const float size = (float)size_in_bytes / (1024.0f * 1024.0f);
+  float distance = key->timeline_frame - scene->r.cfra;
+  if (distance < 0.0f) {
+    distance = -distance * SEQ_CACHE_PLAYED_DISTANCE_FACTOR;
+  }
+
+  return cost / (max_ff(size, 1e-3f) * (1.0f + distance));
+}
+
+static bool seq_cache_key_is_last_linked(SeqCache *cache, SeqCacheKey *key)
+{
+  for (int i = 0; i < SEQ_TASK_NUM; i++) {
+    if (cache->last_key[i] == key) {
+      return true;
+    }
+  }
+  return false;
+}
+
+typedef struct SeqCacheRemovalCandidate {
+  SeqCacheKey *key;
+  float score;
+  size_t size;
+} SeqCacheRemovalCandidate;
+
+static int seq_cache_removal_candidate_cmp(const void *a_, const void *b_)
+{
+  const SeqCacheRemovalCandidate *a = a_;
+  const SeqCacheRemovalCandidate *b = b_;
+  if (a->score < b->score) {
+    return -1;
+  }
+  if (a->score > b->score) {
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * Gather all entries that can be freed, sorted by retention score, lowest first.
+ * The returned array must be freed by the caller.
+ */
+static SeqCacheRemovalCandidate *seq_cache_get_items_for_removal(Scene *scene, int *r_len)
 {
   SeqCache *cache = seq_cache_get_from_scene(scene);
-  SeqCacheKey *finalkey = NULL;
-  /* Leftmost key. */
-  SeqCacheKey *lkey = NULL;
-  /* Rightmost key. */
-  SeqCacheKey *rkey = NULL;
-  SeqCacheKey *key = NULL;
+
+  /* Ideally, cache would not need to check the state of prefetching task
+   * that is tricky to do however, because prefetch would need to know,
+   * if a key, that is about to be created would be removed by itself.
+   *
+   * This can happen because only FINAL_OUT item insertion will trigger recycling
+   * but that is also the point, where prefetch can be suspended.
+   *
+   * We could use temp cache as a shield and later make it a non-temporary entry,
+   * but it is not worth of increasing system complexity.
+   */
+  const bool use_prefetch_range = (scene->ed->cache_flag & SEQ_CACHE_PREFETCH_ENABLE) &&
+                                  seq_prefetch_job_is_running(scene);
+  int pfjob_start = 0, pfjob_end = 0;
+  if (use_prefetch_range) {
+    seq_prefetch_get_time_range(scene, &pfjob_start, &pfjob_end);
+  }
+
+  SeqCacheRemovalCandidate *candidates = MEM_malloc_arrayN(
+      BLI_ghash_len(cache->hash), sizeof(*candidates), __func__);
+  int candidates_len = 0;
 
   GHashIterator gh_iter;
   BLI_ghashIterator_init(&gh_iter, cache->hash);
-  int total_count = 0;
 
   while (!BLI_ghashIterator_done(&gh_iter)) {
-    key = BLI_ghashIterator_getKey(&gh_iter);
+    SeqCacheKey *key = BLI_ghashIterator_getKey(&gh_iter);
     SeqCacheItem *item = BLI_ghashIterator_getValue(&gh_iter);
     BLI_ghashIterator_step(&gh_iter);
 
@@ -421,41 +478,43 @@ static SeqCacheKey *seq_cache_get_item_for_removal(Scene *scene)
       seq_cache_recycle_linked(scene, key);
       /* Can not continue iterating after linked remove. */
       BLI_ghashIterator_init(&gh_iter, cache->hash);
+      candidates_len = 0;
       continue;
     }
 
-    if (key->is_temp_cache || key->link_next != NULL) {
+    /* Thumbnails have their own limit. Keys of frames that are being rendered can't be freed,
+     * the chain would be linked to them. */
+    if (key->is_temp_cache || key->type == SEQ_CACHE_STORE_THUMBNAIL ||
+        seq_cache_key_is_last_linked(cache, key)) {
       continue;
     }
 
-    total_count++;
-
-    if (lkey) {
-      if (key->timeline_frame < lkey->timeline_frame) {
-        lkey = key;
-      }
-    }
-    else {
-      lkey = key;
-    }
-    if (rkey) {
-      if (key->timeline_frame > rkey->timeline_frame) {
-        rkey = key;
-      }
-    }
-    else {
-      rkey = key;
+    if (use_prefetch_range && key->timeline_frame >= pfjob_start &&
+        key->timeline_frame <= pfjob_end) {
+      continue;
     }
+
+    SeqCacheRemovalCandidate *candidate = &candidates[candidates_len++];
+    candidate->key = key;
+    candidate->size = IMB_get_size_in_memory(item->ibuf);
+    candidate->score = seq_cache_key_retention_score(scene, key, candidate->size);
   }
 
-  finalkey = seq_cache_choose_key(scene, lkey, rkey);
+  qsort(candidates, candidates_len, sizeof(*candidates), seq_cache_removal_candidate_cmp);
 
-  return finalkey;
+  *r_len = candidates_len;
+  return candidates;
 }
 
-/* Find only "base" keys.
- * Sources(other types) for a frame must be freed all at once.
- */
+static void seq_cache_remove_key(SeqCache *cache, SeqCacheKey *key)
+{
+  if (key->link_next || key->link_prev) {
+    seq_cache_relink_keys(key->link_next, key->link_prev);
+  }
+  BLI_ghash_remove(cache->hash, key, seq_cache_keyfree, seq_cache_valfree);
+}
+
+/* Free entries with lowest retention score until cache is within its limit. */
 bool seq_cache_recycle_item(Scene *scene)
 {
   SeqCache *cache = seq_cache_get_from_scene(scene);
@@ -466,15 +525,26 @@ bool seq_cache_recycle_item(Scene *scene)
   seq_cache_lock(scene);
 
   while (seq_cache_is_full()) {
-    SeqCacheKey *finalkey = seq_cache_get_item_for_removal(scene);
+    const size_t size_over_limit = MEM_get_memory_in_use() - seq_cache_get_mem_total();
 
-    if (finalkey) {
-      seq_cache_recycle_linked(scene, finalkey);
-    }
-    else {
+    int candidates_len;
+    SeqCacheRemovalCandidate *candidates = seq_cache_get_items_for_removal(scene,
+                                                                          &candidates_len);
+    if (candidates_len == 0) {
+      MEM_freeN(candidates);
       seq_cache_unlock(scene);
       return false;
     }
+
+    /* Free as many entries as needed to get within the limit at once, instead of scanning all
+     * entries again for every freed one. Images still used elsewhere are not freed, so the limit
+     * is checked again afterwards. */
+    size_t size_freed = 0;
+    for (int i = 0; i < candidates_len && size_freed < size_over_limit; i++) {
+      size_freed += candidates[i].size;
+      seq_cache_remove_key(cache, candidates[i].key);
+    }
+    MEM_freeN(candidates);
   }
   seq_cache_unlock(scene);
   return true;
@@ -488,11 +558,14 @@ static void seq_cache_set_temp_cache_linked(Scene *scene, SeqCacheKey *base)
     return;
   }
 
+  seq_cache_lock(scene);
+
   SeqCacheKey *next = base->link_next;
 
   while (base) {
     SeqCacheKey *prev = base->link_prev;
     base->is_temp_cache = true;
+    seq_cache_strip_stats_remove(base);
     base = prev;
   }
 
@@ -500,8 +573,11 @@ static void seq_cache_set_temp_cache_linked(Scene *scene, SeqCacheKey *base)
   while (base) {
     next = base->link_next;
     base->is_temp_cache = true;
+    seq_cache_strip_stats_remove(base);
     base = next;
   }
+
+  seq_cache_unlock(scene);
 }
 
 static void seq_cache_create(Main *bmain, Scene *scene)
@@ -512,9 +588,10 @@ static void seq_cache_create(Main *bmain, Scene *scene)
     cache->keys_pool = BLI_mempool_create(sizeof(SeqCacheKey), 0, 64, BLI_MEMPOOL_NOP);
     cache->items_pool = BLI_mempool_create(sizeof(SeqCacheItem), 0, 64, BLI_MEMPOOL_NOP);
     cache->hash = BLI_ghash_new(seq_cache_hashhash, seq_cache_hashcmp, "SeqCache hash");
-    cache->last_key = NULL;
+    memset(cache->last_key, 0, sizeof(cache->last_key));
     cache->bmain = bmain;
     cache->thumbnail_count = 0;
+    cache->strip_stats = BLI_ghash_ptr_new("SeqCache strip stats");
     BLI_mutex_init(&cache->iterator_mutex);
     scene->ed->cache = cache;
 
@@ -541,6 +618,9 @@ static void seq_cache_populate_key(SeqCacheKey *key,
   key->link_next = NULL;
   key->is_temp_cache = true;
   key->task_id = context->task_id;
+  key->cost = 0.0f;
+  key->is_in_strip_stats = false;
+  key->strip_stats_memory_size = 0;
 }
 
 static SeqCacheKey *seq_cache_allocate_key(SeqCache *cache,
@@ -554,6 +634,17 @@ static SeqCacheKey *seq_cache_allocate_key(SeqCache *cache,
   return key;
 }
 
+/* Render cost in frame durations, measured since the image started rendering. */
+static float seq_cache_render_cost_get(Scene *scene, const double start_time)
+{
+  if (start_time == 0.0) {
+    return 0.0f;
+  }
+
+  const double fps = (double)scene->r.frs_sec / (double)scene->r.frs_sec_base;
+  return (float)((PIL_check_seconds_timer() - start_time) * fps);
+}
+
 /* ***************************** API ****************************** */
 
 void seq_cache_free_temp_cache(Scene *scene, short id, int timeline_frame)
@@ -592,6 +683,7 @@ void seq_cache_destruct(Scene *scene)
   }
 
   BLI_ghash_free(cache->hash, seq_cache_keyfree, seq_cache_valfree);
+  BLI_ghash_free(cache->strip_stats, NULL, MEM_freeN);
   BLI_mempool_destroy(cache->keys_pool);
   BLI_mempool_destroy(cache->items_pool);
   BLI_mutex_end(&cache->iterator_mutex);
@@ -629,7 +721,7 @@ void SEQ_cache_cleanup(Scene *scene)
     BLI_ghashIterator_step(&gh_iter);
     BLI_ghash_remove(cache->hash, key, seq_cache_keyfree, seq_cache_valfree);
   }
-  cache->last_key = NULL;
+  memset(cache->last_key, 0, sizeof(cache->last_key));
   cache->thumbnail_count = 0;
   seq_cache_unlock(scene);
 }
@@ -694,7 +786,7 @@ void seq_cache_cleanup_sequence(Scene *scene,
       BLI_ghash_remove(cache->hash, key, seq_cache_keyfree, seq_cache_valfree);
     }
   }
-  cache->last_key = NULL;
+  memset(cache->last_key, 0, sizeof(cache->last_key));
   seq_cache_unlock(scene);
 }
 
@@ -735,7 +827,7 @@ void seq_cache_thumbnail_cleanup(Scene *scene, rctf *view_area_safe)
       cache->thumbnail_count--;
     }
   }
-  cache->last_key = NULL;
+  memset(cache->last_key, 0, sizeof(cache->last_key));
 }
 
 struct ImBuf *seq_cache_get(const SeqRenderData *context,
@@ -794,8 +886,12 @@ struct ImBuf *seq_cache_get(const SeqRenderData *context,
 
     /* Store read image in RAM. Only recycle item for final type. */
     if (key.type != SEQ_CACHE_STORE_FINAL_OUT || seq_cache_recycle_item(scene)) {
-      SeqCacheKey *new_key = seq_cache_allocate_key(cache, context, seq, timeline_frame, type);
-      seq_cache_put_ex(scene, new_key, ibuf);
+      seq_cache_lock(scene);
+      if (!BLI_ghash_haskey(cache->hash, &key)) {
+        SeqCacheKey *new_key = seq_cache_allocate_key(cache, context, seq, timeline_frame, type);
+        seq_cache_put_ex(scene, new_key, ibuf);
+      }
+      seq_cache_unlock(scene);
     }
   }
 
@@ -822,8 +918,9 @@ bool seq_cache_put_if_possible(
     return true;
   }
 
-  seq_cache_set_temp_cache_linked(scene, scene->ed->cache->last_key);
-  scene->ed->cache->last_key = NULL;
+  SeqCacheKey **last_key = &scene->ed->cache->last_key[context->task_id];
+  seq_cache_set_temp_cache_linked(scene, *last_key);
+  *last_key = NULL;
   return false;
 }
 
@@ -866,6 +963,7 @@ void seq_cache_put(
   }
 
   Scene *scene = context->scene;
+  const double render_start_time = context->render_start_time;
 
   if (context->is_prefetch_render) {
     context = seq_prefetch_get_original_context(context);
@@ -888,6 +986,16 @@ void seq_cache_put(
   seq_cache_lock(scene);
   SeqCache *cache = seq_cache_get_from_scene(scene);
   SeqCacheKey *key = seq_cache_allocate_key(cache, context, seq, timeline_frame, type);
+  key->cost = seq_cache_render_cost_get(scene, render_start_time);
+
+  /* Another task (prefetch worker or main thread) may have stored the same image since the
+   * check above. Reinserting would free a key that can be linked by other entries. */
+  if (BLI_ghash_haskey(cache->hash, key)) {
+    BLI_mempool_free(cache->keys_pool, key);
+    seq_cache_unlock(scene);
+    return;
+  }
+
   seq_cache_put_ex(scene, key, i);
   seq_cache_unlock(scene);
 
@@ -903,6 +1011,23 @@ void seq_cache_put(
   }
 }
 
+void SEQ_cache_strip_stats_get(Scene *scene, Sequence *seq, SeqCacheStripStats *r_stats)
+{
+  memset(r_stats, 0, sizeof(*r_stats));
+
+  SeqCache *cache = seq_cache_get_from_scene(scene);
+  if (!cache) {
+    return;
+  }
+
+  seq_cache_lock(scene);
+  const SeqCacheStripStats *stats = BLI_ghash_lookup(cache->strip_stats, seq);
+  if (stats) {
+    *r_stats = *stats;
+  }
+  seq_cache_unlock(scene);
+}
+
 void SEQ_cache_iterate(
     struct Scene *scene,
     void *userdata,
@@ -927,7 +1052,7 @@ void SEQ_cache_iterate(
     interrupt = callback_iter(userdata, key->seq, key->timeline_frame, key->type);
   }
 
-  cache->last_key = NULL;
+  memset(cache->last_key, 0, sizeof(cache->last_key));
   seq_cache_unlock(scene);
 }
 
@@ -49,6 +49,10 @@ typedef struct SeqCacheKey {
   /* ID of task for assigning temp cache entries to particular task(thread, etc.) */
   eSeqTaskId task_id;
   int type;
+  /* Set while the entry is counted in the statistics of its strip with the size below, see
+   * #SEQ_cache_strip_stats_get. */
+  bool is_in_strip_stats;
+  size_t strip_stats_memory_size;
 } SeqCacheKey;
 
 struct ImBuf *seq_cache_get(const struct SeqRenderData *context,
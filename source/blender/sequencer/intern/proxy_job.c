@@ -28,6 +28,8 @@
 
 #include "BLI_blenlib.h"
 #include "BLI_ghash.h"
+#include "BLI_math_base.h"
+#include "BLI_threads.h"
 #include "BLI_timecode.h"
 
 #include "DNA_scene_types.h"
@@ -48,6 +50,8 @@
 
 #include "RNA_define.h"
 
+#include "PIL_time.h"
+
 static void proxy_freejob(void *pjv)
 {
   ProxyJob *pj = pjv;
@@ -57,22 +61,112 @@ static void proxy_freejob(void *pjv)
   MEM_freeN(pj);
 }
 
+/* Every strip build runs a decoder and an encoder per proxy size, each of them threaded by
+ * FFmpeg, so only a few strips are built at once. */
+#define SEQ_PROXY_THREADS_PER_STRIP 4
+#define SEQ_PROXY_WORKERS_MAX 8
+
+typedef struct ProxyBuildState {
+  ThreadMutex mutex;
+  LinkData *next_link;
+  short *stop;
+  int num_workers_running;
+  int num_finished;
+} ProxyBuildState;
+
+typedef struct ProxyBuildWorker {
+  ProxyBuildState *state;
+  /* Progress of the strip currently built by this worker. */
+  float progress;
+  short do_update;
+} ProxyBuildWorker;
+
+static void *proxy_build_thread(void *data)
+{
+  ProxyBuildWorker *worker = data;
+  ProxyBuildState *state = worker->state;
+
+  while (!*state->stop) {
+    BLI_mutex_lock(&state->mutex);
+    LinkData *link = state->next_link;
+    if (link) {
+      state->next_link = link->next;
+    }
+    BLI_mutex_unlock(&state->mutex);
+
+    if (link == NULL) {
+      break;
+    }
+
+    SEQ_proxy_rebuild(link->data, state->stop, &worker->do_update, &worker->progress);
+
+    BLI_mutex_lock(&state->mutex);
+    worker->progress = 0.0f;
+    state->num_finished++;
+    BLI_mutex_unlock(&state->mutex);
+  }
+
+  BLI_mutex_lock(&state->mutex);
+  state->num_workers_running--;
+  BLI_mutex_unlock(&state->mutex);
+
+  return NULL;
+}
+
 /* Only this runs inside thread. */
 static void proxy_startjob(void *pjv, short *stop, short *do_update, float *progress)
 {
   ProxyJob *pj = pjv;
-  LinkData *link;
+  const int num_contexts = BLI_listbase_count(&pj->queue);
 
-  for (link = pj->queue.first; link; link = link->next) {
-    struct SeqIndexBuildContext *context = link->data;
+  if (num_contexts == 0) {
+    return;
+  }
+
+  const int num_workers = min_ii(
+      num_contexts,
+      clamp_i(BLI_system_thread_count() / SEQ_PROXY_THREADS_PER_STRIP, 1, SEQ_PROXY_WORKERS_MAX));
 
-    SEQ_proxy_rebuild(context, stop, do_update, progress);
+  ProxyBuildState state = {0};
+  ProxyBuildWorker workers[SEQ_PROXY_WORKERS_MAX] = {{0}};
+  ListBase threads;
+
+  BLI_mutex_init(&state.mutex);
+  state.next_link = pj->queue.first;
+  state.stop = stop;
+  state.num_workers_running = num_workers;
+
+  BLI_threadpool_init(&threads, proxy_build_thread, num_workers);
+  for (int i = 0; i < num_workers; i++) {
+    workers[i].state = &state;
+    BLI_threadpool_insert(&threads, &workers[i]);
+  }
 
-    if (*stop) {
-      pj->stop = 1;
-      fprintf(stderr, "Canceling proxy rebuild on users request...\n");
+  /* Report the combined progress of all strips until the workers are done. */
+  while (true) {
+    BLI_mutex_lock(&state.mutex);
+    const bool is_running = state.num_workers_running > 0;
+    float progress_total = state.num_finished;
+    for (int i = 0; i < num_workers; i++) {
+      progress_total += workers[i].progress;
+    }
+    BLI_mutex_unlock(&state.mutex);
+
+    *progress = min_ff(progress_total / num_contexts, 1.0f);
+    *do_update = true;
+
+    if (!is_running) {
       break;
     }
+    PIL_sleep_ms(50);
+  }
+
+  BLI_threadpool_end(&threads);
+  BLI_mutex_end(&state.mutex);
+
+  if (*stop) {
+    pj->stop = 1;
+    fprintf(stderr, "Canceling proxy rebuild on users request...\n");
   }
 }
 
@@ -34,10 +34,14 @@
 #include "DNA_sequence_types.h"
 #include "DNA_space_types.h"
 
+#include "BLI_ghash.h"
 #include "BLI_linklist.h"
 #include "BLI_listbase.h"
 #include "BLI_path_util.h"
 #include "BLI_rect.h"
+#include "BLI_task.h"
+
+#include "PIL_time.h"
 
 #include "BKE_anim_data.h"
 #include "BKE_animsys.h"
@@ -91,7 +95,33 @@ static ImBuf *seq_render_strip_stack(const SeqRenderData *context,
                                      float timeline_frame,
                                      int chanshown);
 
+/* Prefetch workers render frames concurrently, each with its own copy of the scene. They share
+ * `seq_render_rwlock` for reading, while other renders lock it for writing. `seq_render_mutex` is
+ * held by writers for whole render and by readers only while acquiring the lock, so the main
+ * thread is not starved by workers that keep the lock shared. */
 static ThreadMutex seq_render_mutex = BLI_MUTEX_INITIALIZER;
+static ThreadRWMutex seq_render_rwlock = BLI_RWLOCK_INITIALIZER;
+
+static void seq_render_lock(const SeqRenderData *context)
+{
+  BLI_mutex_lock(&seq_render_mutex);
+  if (context->is_prefetch_render) {
+    BLI_rw_mutex_lock(&seq_render_rwlock, THREAD_LOCK_READ);
+    BLI_mutex_unlock(&seq_render_mutex);
+  }
+  else {
+    BLI_rw_mutex_lock(&seq_render_rwlock, THREAD_LOCK_WRITE);
+  }
+}
+
+static void seq_render_unlock(const SeqRenderData *context)
+{
+  BLI_rw_mutex_unlock(&seq_render_rwlock);
+  if (!context->is_prefetch_render) {
+    BLI_mutex_unlock(&seq_render_mutex);
+  }
+}
+
 SequencerDrawView sequencer_view3d_fn = NULL; /* NULL in background mode */
 
 /* -------------------------------------------------------------------- */
@@ -237,6 +267,7 @@ void SEQ_render_new_render_data(Main *bmain,
   r_context->gpu_offscreen = NULL;
   r_context->task_id = SEQ_TASK_MAIN_RENDER;
   r_context->is_prefetch_render = false;
+  r_context->render_start_time = 0.0;
 }
 
 void seq_render_state_init(SeqRenderState *state)
@@ -1675,6 +1706,11 @@ ImBuf *seq_render_strip(const SeqRenderData *context,
     return ibuf;
   }
 
+  /* Images of this strip are stored in cache with the time it took to render them. */
+  SeqRenderData local_context = *context;
+  local_context.render_start_time = PIL_check_seconds_timer();
+  context = &local_context;
+
   /* Proxies are not stored in cache. */
   if (!SEQ_can_use_proxy(
           context, seq, SEQ_rendersize_to_proxysize(context->preview_render_size))) {
@@ -1764,6 +1800,222 @@ static ImBuf *seq_render_strip_stack_apply_effect(
   return out;
 }
 
+/**
+ * Strips which can be rendered in parallel with other strips, as long as they don't share any
+ * strip, see #seq_render_strip_dependencies_add.
+ *
+ * Scene strips, masks, movie clips and effects using other strips in a more indirect way
+ * (adjustment layers, multi-cam, speed) or using global state (text, gamma cross) are always
+ * rendered from the calling thread.
+ */
+static bool seq_render_strip_is_thread_safe(const Sequence *seq)
+{
+  LISTBASE_FOREACH (const SequenceModifierData *, smd, &seq->modifiers) {
+    if (smd->mask_id != NULL) {
+      return false;
+    }
+    if (smd->mask_sequence != NULL && !seq_render_strip_is_thread_safe(smd->mask_sequence)) {
+      return false;
+    }
+  }
+
+  switch (seq->type) {
+    case SEQ_TYPE_IMAGE:
+    case SEQ_TYPE_MOVIE:
+      return true;
+    case SEQ_TYPE_META:
+      LISTBASE_FOREACH (const Sequence *, seq_meta, &seq->seqbase) {
+        if (!seq_render_strip_is_thread_safe(seq_meta)) {
+          return false;
+        }
+      }
+      return true;
+    case SEQ_TYPE_CROSS:
+    case SEQ_TYPE_ADD:
+    case SEQ_TYPE_SUB:
+    case SEQ_TYPE_ALPHAOVER:
+    case SEQ_TYPE_ALPHAUNDER:
+    case SEQ_TYPE_MUL:
+    case SEQ_TYPE_OVERDROP:
+    case SEQ_TYPE_WIPE:
+    case SEQ_TYPE_GLOW:
+    case SEQ_TYPE_TRANSFORM:
+    case SEQ_TYPE_COLOR:
+    case SEQ_TYPE_GAUSSIAN_BLUR:
+    case SEQ_TYPE_COLORMIX:
+      return ((seq->seq1 == NULL || seq_render_strip_is_thread_safe(seq->seq1)) &&
+              (seq->seq2 == NULL || seq_render_strip_is_thread_safe(seq->seq2)) &&
+              (seq->seq3 == NULL || seq_render_strip_is_thread_safe(seq->seq3)));
+  }
+  return false;
+}
+
+/**
+ * Add all strips used when rendering \a seq to \a dependencies.
+ * \return false if some strip was already part of \a dependencies.
+ */
+static bool seq_render_strip_dependencies_add(const Sequence *seq, GSet *dependencies)
+{
+  bool is_unique = BLI_gset_add(dependencies, (void *)seq);
+
+  LISTBASE_FOREACH (const SequenceModifierData *, smd, &seq->modifiers) {
+    if (smd->mask_sequence != NULL) {
+      is_unique &= seq_render_strip_dependencies_add(smd->mask_sequence, dependencies);
+    }
+  }
+  LISTBASE_FOREACH (const Sequence *, seq_meta, &seq->seqbase) {
+    is_unique &= seq_render_strip_dependencies_add(seq_meta, dependencies);
+  }
+  const Sequence *inputs[3] = {seq->seq1, seq->seq2, seq->seq3};
+  for (int i = 0; i < ARRAY_SIZE(inputs); i++) {
+    /* Effects commonly use the same strip for multiple inputs, that is fine. */
+    if (inputs[i] != NULL && !BLI_gset_haskey(dependencies, inputs[i])) {
+      is_unique &= seq_render_strip_dependencies_add(inputs[i], dependencies);
+    }
+  }
+  return is_unique;
+}
+
+/**
+ * Adjustment layers and multi-cam strips render other channels of the stack they are in, which
+ * are not known from the strip itself.
+ */
+static bool seq_render_strip_uses_channels(const Sequence *seq)
+{
+  if (ELEM(seq->type, SEQ_TYPE_ADJUSTMENT, SEQ_TYPE_MULTICAM)) {
+    return true;
+  }
+  LISTBASE_FOREACH (const SequenceModifierData *, smd, &seq->modifiers) {
+    if (smd->mask_sequence != NULL && seq_render_strip_uses_channels(smd->mask_sequence)) {
+      return true;
+    }
+  }
+  const Sequence *inputs[3] = {seq->seq1, seq->seq2, seq->seq3};
+  for (int i = 0; i < ARRAY_SIZE(inputs); i++) {
+    if (inputs[i] != NULL && seq_render_strip_uses_channels(inputs[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+typedef struct RenderStripStackInputsData {
+  const SeqRenderData *context;
+  SeqRenderState *state;
+  float timeline_frame;
+} RenderStripStackInputsData;
+
+typedef struct RenderStripStackInputTask {
+  Sequence *seq;
+  ImBuf **r_ibuf;
+} RenderStripStackInputTask;
+
+static void seq_render_strip_stack_input_task(TaskPool *__restrict pool, void *taskdata)
+{
+  const RenderStripStackInputsData *data = BLI_task_pool_user_data(pool);
+  RenderStripStackInputTask *task = taskdata;
+  *task->r_ibuf = seq_render_strip(data->context, data->state, task->seq, data->timeline_frame);
+}
+
+/**
+ * Render all strips of the stack which are tagged in \a render_needed, independent strips are
+ * rendered in parallel.
+ */
+static void seq_render_strip_stack_inputs(const SeqRenderData *context,
+                                          SeqRenderState *state,
+                                          Sequence **seq_arr,
+                                          const bool *render_needed,
+                                          const int count,
+                                          float timeline_frame,
+                                          ImBuf **r_ibufs)
+{
+  RenderStripStackInputsData data = {context, state, timeline_frame};
+  TaskPool *task_pool = NULL;
+  bool render_in_task[MAXSEQ + 1] = {false};
+  bool render_after_tasks[MAXSEQ + 1] = {false};
+
+  int render_needed_num = 0;
+  bool use_parallel = true;
+  for (int i = 0; i < count; i++) {
+    if (render_needed[i]) {
+      render_needed_num++;
+      /* Strips of the stack used by other strips can't be known in advance, render serially. */
+      if (seq_render_strip_uses_channels(seq_arr[i])) {
+        use_parallel = false;
+      }
+    }
+  }
+
+  if (render_needed_num > 1 && use_parallel) {
+    task_pool = BLI_task_pool_create(&data, TASK_PRIORITY_HIGH);
+    /* All strips used by the strips rendered so far, from a task or from this thread. */
+    GSet *dependencies = BLI_gset_ptr_new(__func__);
+
+    /* Strips rendered from this thread run at the same time as the tasks,
+     * so the tasks must not use any of their strips either. */
+    for (int i = 0; i < count; i++) {
+      if (render_needed[i] && !seq_render_strip_is_thread_safe(seq_arr[i])) {
+        seq_render_strip_dependencies_add(seq_arr[i], dependencies);
+      }
+    }
+
+    for (int i = 0; i < count; i++) {
+      if (!render_needed[i] || !seq_render_strip_is_thread_safe(seq_arr[i])) {
+        continue;
+      }
+      GSet *seq_dependencies = BLI_gset_ptr_new(__func__);
+      seq_render_strip_dependencies_add(seq_arr[i], seq_dependencies);
+
+      bool is_independent = true;
+      GSET_FOREACH_BEGIN (Sequence *, seq, seq_dependencies) {
+        if (BLI_gset_haskey(dependencies, seq)) {
+          is_independent = false;
+          break;
+        }
+      }
+      GSET_FOREACH_END();
+
+      GSET_FOREACH_BEGIN (Sequence *, seq, seq_dependencies) {
+        BLI_gset_add(dependencies, seq);
+      }
+      GSET_FOREACH_END();
+      BLI_gset_free(seq_dependencies, NULL);
+
+      if (is_independent) {
+        render_in_task[i] = true;
+        RenderStripStackInputTask *task = MEM_mallocN(sizeof(*task), __func__);
+        task->seq = seq_arr[i];
+        task->r_ibuf = &r_ibufs[i];
+        BLI_task_pool_push(task_pool, seq_render_strip_stack_input_task, task, true, NULL);
+      }
+      else {
+        /* Shares strips with a task (or a strip rendered from this thread). */
+        render_after_tasks[i] = true;
+      }
+    }
+
+    BLI_gset_free(dependencies, NULL);
+  }
+
+  /* Render the remaining strips from this thread, while the tasks run. */
+  for (int i = 0; i < count; i++) {
+    if (render_needed[i] && !render_in_task[i] && !render_after_tasks[i]) {
+      r_ibufs[i] = seq_render_strip(context, state, seq_arr[i], timeline_frame);
+    }
+  }
+
+  if (task_pool != NULL) {
+    BLI_task_pool_work_and_wait(task_pool);
+    BLI_task_pool_free(task_pool);
+  }
+
+  for (int i = 0; i < count; i++) {
+    if (render_after_tasks[i]) {
+      r_ibufs[i] = seq_render_strip(context, state, seq_arr[i], timeline_frame);
+    }
+  }
+}
+
 static ImBuf *seq_render_strip_stack(const SeqRenderData *context,
                                      SeqRenderState *state,
                                      ListBase *seqbasep,
@@ -1771,6 +2023,8 @@ static ImBuf *seq_render_strip_stack(const SeqRenderData *context,
                                      int chanshown)
 {
   Sequence *seq_arr[MAXSEQ + 1];
+  ImBuf *ibufs[MAXSEQ + 1] = {NULL};
+  bool render_needed[MAXSEQ + 1] = {false};
   int count;
   int i;
   ImBuf *out = NULL;
@@ -1781,8 +2035,8 @@ static ImBuf *seq_render_strip_stack(const SeqRenderData *context,
     return NULL;
   }
 
+  /* Find the lowest strip contributing to the result. */
   for (i = count - 1; i >= 0; i--) {
-    int early_out;
     Sequence *seq = seq_arr[i];
 
     out = seq_cache_get(context, seq, timeline_frame, SEQ_CACHE_STORE_COMPOSITE);
@@ -1790,39 +2044,46 @@ static ImBuf *seq_render_strip_stack(const SeqRenderData *context,
     if (out) {
       break;
     }
-    if (seq->blend_mode == SEQ_BLEND_REPLACE) {
-      out = seq_render_strip(context, state, seq, timeline_frame);
+    if (seq->blend_mode == SEQ_BLEND_REPLACE ||
+        ELEM(seq_get_early_out_for_blend_mode(seq), EARLY_NO_INPUT, EARLY_USE_INPUT_2)) {
+      render_needed[i] = true;
       break;
     }
+  }
 
-    early_out = seq_get_early_out_for_blend_mode(seq);
+  /* Nothing opaque found, blend the lowest strip over an empty image. */
+  const bool use_empty_base = (i < 0);
+  if (use_empty_base) {
+    i = 0;
+    render_needed[i] = seq_get_early_out_for_blend_mode(seq_arr[i]) == EARLY_DO_EFFECT;
+  }
 
-    switch (early_out) {
-      case EARLY_NO_INPUT:
-      case EARLY_USE_INPUT_2:
-        out = seq_render_strip(context, state, seq, timeline_frame);
-        break;
-      case EARLY_USE_INPUT_1:
-        if (i == 0) {
-          out = IMB_allocImBuf(context->rectx, context->recty, 32, IB_rect);
-        }
-        break;
-      case EARLY_DO_EFFECT:
-        if (i == 0) {
-          ImBuf *ibuf1 = IMB_allocImBuf(context->rectx, context->recty, 32, IB_rect);
-          ImBuf *ibuf2 = seq_render_strip(context, state, seq, timeline_frame);
+  for (int j = i + 1; j < count; j++) {
+    render_needed[j] = seq_get_early_out_for_blend_mode(seq_arr[j]) == EARLY_DO_EFFECT;
+  }
 
-          out = seq_render_strip_stack_apply_effect(context, seq, timeline_frame, ibuf1, ibuf2);
+  /* All strips are rendered first, so that independent ones can be rendered in parallel. */
+  seq_render_strip_stack_inputs(
+      context, state, seq_arr, render_needed, count, timeline_frame, ibufs);
 
-          seq_cache_put(context, seq_arr[i], timeline_frame, SEQ_CACHE_STORE_COMPOSITE, out);
+  if (out == NULL) {
+    Sequence *seq = seq_arr[i];
+    if (!use_empty_base) {
+      out = ibufs[i];
+    }
+    else if (render_needed[i]) {
+      ImBuf *ibuf1 = IMB_allocImBuf(context->rectx, context->recty, 32, IB_rect);
+      ImBuf *ibuf2 = ibufs[i];
 
-          IMB_freeImBuf(ibuf1);
-          IMB_freeImBuf(ibuf2);
-        }
-        break;
+      out = seq_render_strip_stack_apply_effect(context, seq, timeline_frame, ibuf1, ibuf2);
+
+      seq_cache_put(context, seq, timeline_frame, SEQ_CACHE_STORE_COMPOSITE, out);
+
+      IMB_freeImBuf(ibuf1);
+      IMB_freeImBuf(ibuf2);
     }
-    if (out) {
-      break;
+    else {
+      out = IMB_allocImBuf(context->rectx, context->recty, 32, IB_rect);
     }
   }
 
@@ -1830,9 +2091,9 @@ static ImBuf *seq_render_strip_stack(const SeqRenderData *context,
   for (; i < count; i++) {
     Sequence *seq = seq_arr[i];
 
-    if (seq_get_early_out_for_blend_mode(seq) == EARLY_DO_EFFECT) {
+    if (render_needed[i]) {
       ImBuf *ibuf1 = out;
-      ImBuf *ibuf2 = seq_render_strip(context, state, seq, timeline_frame);
+      ImBuf *ibuf2 = ibufs[i];
 
       out = seq_render_strip_stack_apply_effect(context, seq, timeline_frame, ibuf1, ibuf2);
 
@@ -1887,17 +2148,20 @@ ImBuf *SEQ_render_give_ibuf(const SeqRenderData *context, float timeline_frame,
   SEQ_relations_free_all_anim_ibufs(context->scene, timeline_frame);
 
   if (count && !out) {
-    BLI_mutex_lock(&seq_render_mutex);
-    out = seq_render_strip_stack(context, &state, seqbasep, timeline_frame, chanshown);
+    seq_render_lock(context);
+    SeqRenderData local_context = *context;
+    local_context.render_start_time = PIL_check_seconds_timer();
+    out = seq_render_strip_stack(&local_context, &state, seqbasep, timeline_frame, chanshown);
 
     if (context->is_prefetch_render) {
-      seq_cache_put(context, seq_arr[count - 1], timeline_frame, SEQ_CACHE_STORE_FINAL_OUT, out);
+      seq_cache_put(
+          &local_context, seq_arr[count - 1], timeline_frame, SEQ_CACHE_STORE_FINAL_OUT, out);
     }
     else {
       seq_cache_put_if_possible(
-          context, seq_arr[count - 1], timeline_frame, SEQ_CACHE_STORE_FINAL_OUT, out);
+          &local_context, seq_arr[count - 1], timeline_frame, SEQ_CACHE_STORE_FINAL_OUT, out);
     }
-    BLI_mutex_unlock(&seq_render_mutex);
+    seq_render_unlock(context);
   }
 
   seq_prefetch_start(context, timeline_frame);
@@ -690,7 +690,7 @@ void SEQ_add_reload_new_file(Main *bmain, Scene *scene, Sequence *seq, const boo
 
             seq_multiview_name(scene, i, prefix, ext, str, FILE_MAX);
             anim = openanim(str,
-                            IB_rect | ((seq->flag & SEQ_FILTERY) ? IB_animdeinterlace : 0),
+                            seq_anim_open_flags(seq),
                             seq->streamindex,
                             seq->strip->colorspace_settings.name);
 
@@ -708,7 +708,7 @@ void SEQ_add_reload_new_file(Main *bmain, Scene *scene, Sequence *seq, const boo
       if (is_multiview_loaded == false) {
         struct anim *anim;
         anim = openanim(path,
-                        IB_rect | ((seq->flag & SEQ_FILTERY) ? IB_animdeinterlace : 0),
+                        seq_anim_open_flags(seq),
                         seq->streamindex,
                         seq->strip->colorspace_settings.name);
         if (anim) {
@@ -271,6 +271,19 @@ ListBase *SEQ_get_seqbase_from_sequence(Sequence *seq, int *r_offset)
   return seqbase;
 }
 
+/**
+ * Flags movie strips open their animations with. Strips are played back sequentially most of the
+ * time, so the movie decodes following frames in the background.
+ */
+int seq_anim_open_flags(const Sequence *seq)
+{
+  int flags = IB_rect | IB_animdecodeahead;
+  if (seq->flag & SEQ_FILTERY) {
+    flags |= IB_animdeinterlace;
+  }
+  return flags;
+}
+
 void seq_open_anim_file(Scene *scene, Sequence *seq, bool openfile)
 {
   char dir[FILE_MAX];
@@ -332,14 +345,13 @@ void seq_open_anim_file(Scene *scene, Sequence *seq, bool openfile)
 
         if (openfile) {
           sanim->anim = openanim(str,
-                                 IB_rect | ((seq->flag & SEQ_FILTERY) ? IB_animdeinterlace : 0),
+                                 seq_anim_open_flags(seq),
                                  seq->streamindex,
                                  seq->strip->colorspace_settings.name);
         }
         else {
           sanim->anim = openanim_noload(str,
-                                        IB_rect |
-                                            ((seq->flag & SEQ_FILTERY) ? IB_animdeinterlace : 0),
+                                        seq_anim_open_flags(seq),
                                         seq->streamindex,
                                         seq->strip->colorspace_settings.name);
         }
@@ -351,14 +363,13 @@ void seq_open_anim_file(Scene *scene, Sequence *seq, bool openfile)
         else {
           if (openfile) {
             sanim->anim = openanim(name,
-                                   IB_rect | ((seq->flag & SEQ_FILTERY) ? IB_animdeinterlace : 0),
+                                   seq_anim_open_flags(seq),
                                    seq->streamindex,
                                    seq->strip->colorspace_settings.name);
           }
           else {
             sanim->anim = openanim_noload(name,
-                                          IB_rect |
-                                              ((seq->flag & SEQ_FILTERY) ? IB_animdeinterlace : 0),
+                                          seq_anim_open_flags(seq),
                                           seq->streamindex,
                                           seq->strip->colorspace_settings.name);
           }
@@ -383,13 +394,13 @@ void seq_open_anim_file(Scene *scene, Sequence *seq, bool openfile)
 
     if (openfile) {
       sanim->anim = openanim(name,
-                             IB_rect | ((seq->flag & SEQ_FILTERY) ? IB_animdeinterlace : 0),
+                             seq_anim_open_flags(seq),
                              seq->streamindex,
                              seq->strip->colorspace_settings.name);
     }
     else {
       sanim->anim = openanim_noload(name,
-                                    IB_rect | ((seq->flag & SEQ_FILTERY) ? IB_animdeinterlace : 0),
+                                    seq_anim_open_flags(seq),
                                     seq->streamindex,
                                     seq->strip->colorspace_settings.name);
     }
@@ -31,6 +31,7 @@ struct Scene;
 struct ListBase;
 
 bool sequencer_seq_generates_image(struct Sequence *seq);
+int seq_anim_open_flags(const struct Sequence *seq);
 void seq_open_anim_file(struct Scene *scene, struct Sequence *seq, bool openfile);
 Sequence *SEQ_get_meta_by_seqbase(struct ListBase *seqbase_main, struct ListBase *meta_seqbase);
 
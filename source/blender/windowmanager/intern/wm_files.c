@@ -919,8 +919,9 @@ bool WM_file_read(bContext *C, const char *filepath, ReportList *reports)
         .is_startup = false,
         /* Loading preferences when the user intended to load a regular file is a security
          * risk, because the excluded path list is also loaded. Further it's just confusing
-         * if a user loads a file and various preferences change. */
-        .skip_flags = BLO_READ_SKIP_USERDEF,
+         * if a user loads a file and various preferences change.
+         * In background mode (e.g. rendering) packed files are only read when needed. */
+        .skip_flags = BLO_READ_SKIP_USERDEF | (G.background ? BLO_READ_LAZY_DATA : 0),
     };
 
     BlendFileReadReport bf_reports = {.reports = reports,
@@ -1936,6 +1937,20 @@ static void wm_autosave_location(char *filepath)
   BLI_join_dirfile(filepath, FILE_MAX, BKE_tempdir_base(), path);
 }
 
+/**
+ * Information about the last auto-save written from undo memory,
+ * so following auto-saves only need to write the data that changed.
+ */
+static MemFileWriteCache *wm_autosave_write_cache = NULL;
+
+static void wm_autosave_write_cache_free(void)
+{
+  if (wm_autosave_write_cache != NULL) {
+    BLO_memfile_write_cache_free(wm_autosave_write_cache);
+    wm_autosave_write_cache = NULL;
+  }
+}
+
 static void wm_autosave_write(Main *bmain, wmWindowManager *wm)
 {
   char filepath[FILE_MAX];
@@ -1946,9 +1961,11 @@ static void wm_autosave_write(Main *bmain, wmWindowManager *wm)
   const bool use_memfile = (U.uiflag & USER_GLOBALUNDO) != 0;
   MemFile *memfile = use_memfile ? ED_undosys_stack_memfile_get_active(wm->undo_stack) : NULL;
   if (memfile != NULL) {
-    BLO_memfile_write_file(memfile, filepath);
+    BLO_memfile_write_file_incremental(memfile, filepath, &wm_autosave_write_cache);
   }
   else {
+    wm_autosave_write_cache_free();
+
     if (use_memfile) {
       /* This is very unlikely, alert developers of this unexpected case. */
       CLOG_WARN(&LOG, "undo-data not found for writing, fallback to regular file write!");
@@ -2022,6 +2039,8 @@ void wm_autosave_delete(void)
 {
   char filename[FILE_MAX];
 
+  wm_autosave_write_cache_free();
+
   wm_autosave_location(filename);
 
   if (BLI_exists(filename)) {
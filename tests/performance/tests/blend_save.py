@@ -0,0 +1,100 @@
+# Apache License, Version 2.0
+
+import api
+import os
+import sys
+
+
+def _peak_memory():
+    # Peak resident memory of the process in megabytes, None where unsupported.
+    try:
+        import resource
+    except ImportError:
+        return None
+    peak_memory = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    # Kilobytes on Linux, bytes on macOS.
+    if sys.platform == 'darwin':
+        peak_memory /= 1024
+    return peak_memory / 1024
+
+
+def _run_undo(result):
+    import bpy
+    import time
+
+    # Undo needs a window and screen, which are kept in background mode but not in the context.
+    window = bpy.context.window_manager.windows[0]
+    context = {'window': window, 'screen': window.screen}
+
+    # First undo step writes all data, the next one only data that changed.
+    start_time = time.time()
+    bpy.ops.ed.undo_push(context, message="Benchmark")
+    result['undo_push'] = time.time() - start_time
+
+    start_time = time.time()
+    bpy.ops.ed.undo_push(context, message="Benchmark Unchanged")
+    result['undo_push_unchanged'] = time.time() - start_time
+
+    start_time = time.time()
+    bpy.ops.ed.undo(context)
+    result['undo'] = time.time() - start_time
+
+
+def _run(args):
+    import bpy
+    import tempfile
+    import time
+
+    bpy.ops.wm.open_mainfile(filepath=args['filepath'])
+
+    with tempfile.TemporaryDirectory() as tempdir:
+        filepath = os.path.join(tempdir, "save.blend")
+
+        # Save once to ensure the output file exists.
+        bpy.ops.wm.save_as_mainfile(filepath=filepath, compress=args['compress'], copy=True)
+
+        # Measure saving the second time.
+        peak_memory = _peak_memory()
+        start_time = time.time()
+        bpy.ops.wm.save_as_mainfile(filepath=filepath, compress=args['compress'], copy=True)
+        elapsed_time = time.time() - start_time
+        file_size = os.path.getsize(filepath)
+
+    # Throughput is of the written file, so compressed files have lower numbers.
+    result = {'time': elapsed_time,
+              'throughput': file_size / (1024 * 1024) / max(elapsed_time, 1e-6)}
+
+    # The process peak includes loading the file, so only the increase caused by saving is
+    # reported, zero when saving stays below the peak reached when loading.
+    if peak_memory is not None:
+        result['peak_memory_increase'] = _peak_memory() - peak_memory
+
+    # Undo steps are never compressed.
+    if not args['compress']:
+        _run_undo(result)
+
+    return result
+
+
+class BlendSaveTest(api.Test):
+    def __init__(self, filepath, compress):
+        self.filepath = filepath
+        self.compress = compress
+
+    def name(self):
+        return self.filepath.stem + ("_compressed" if self.compress else "")
+
+    def category(self):
+        return "blend_save"
+
+    def run(self, env, device_id):
+        args = {'filepath': str(self.filepath), 'compress': self.compress}
+        result, _ = env.run_in_blender(_run, args)
+        return result
+
+
+def generate(env):
+    filepaths = env.find_blend_files('*/*')
+    return [BlendSaveTest(filepath, compress)
+            for filepath in filepaths
+            for compress in (False, True)]
@@ -0,0 +1,77 @@
+# Apache License, Version 2.0
+
+import api
+import os
+
+
+def _run(args):
+    import bpy
+    import time
+
+    modifiers = []
+    for ob in bpy.context.scene.objects:
+        for md in ob.modifiers:
+            if md.type == 'NODES':
+                md.use_results_cache = args['use_results_cache']
+                modifiers.append((ob, md))
+
+    def evaluate():
+        for ob, _ in modifiers:
+            ob.update_tag(refresh={'DATA'})
+        bpy.context.view_layer.update()
+
+    # Evaluate once to exclude the creation of the dependency graph.
+    evaluate()
+
+    start_time = time.time()
+    elapsed_time = 0.0
+    num_evaluations = 0
+
+    while elapsed_time < 10.0:
+        evaluate()
+        num_evaluations += 1
+        elapsed_time = time.time() - start_time
+
+    time_per_evaluation = elapsed_time / num_evaluations
+
+    # Write a trace of the last evaluation for every modifier, so that slow nodes can be found.
+    trace_prefix = args['trace_prefix']
+    for ob, md in modifiers:
+        name = bpy.path.clean_name(ob.name + "_" + md.name)
+        filepath = f"{trace_prefix}_{name}.json"
+        try:
+            md.write_execution_trace(filepath=filepath)
+        except RuntimeError:
+            # Nothing was logged for this modifier.
+            pass
+
+    result = {'time': time_per_evaluation}
+    return result
+
+
+class GeometryNodesTest(api.Test):
+    def __init__(self, filepath, use_results_cache):
+        self.filepath = filepath
+        self.use_results_cache = use_results_cache
+
+    def name(self):
+        return self.filepath.stem + ("_cached" if self.use_results_cache else "")
+
+    def category(self):
+        return "geometry_nodes"
+
+    def run(self, env, device_id):
+        # Reevaluating without changes measures the overhead of looking up the cached results.
+        trace_prefix = str(env.log_file.parent / env.log_file.stem)
+        if self.use_results_cache:
+            trace_prefix += "_cached"
+        args = {'trace_prefix': trace_prefix, 'use_results_cache': self.use_results_cache}
+        result, _ = env.run_in_blender(_run, args, [self.filepath])
+        return result
+
+
+def generate(env):
+    filepaths = env.find_blend_files('geometry_nodes/*')
+    return [GeometryNodesTest(filepath, use_results_cache)
+            for filepath in filepaths
+            for use_results_cache in (False, True)]